@@ -5,6 +5,20 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 CONFIG += c++17
 RC_FILE = app.rc
 
+# 以 CONFIG+=pext 建置時，滑動棋子攻擊查詢改用 BMI2 PEXT 指令（需 Intel Haswell / AMD Zen 3 以後的 CPU）
+# 未指定時使用可攜的 magic 乘法
+pext {
+    DEFINES += QT_CHESS_USE_PEXT
+    gcc|clang: QMAKE_CXXFLAGS += -mbmi2
+    msvc: QMAKE_CXXFLAGS += /arch:AVX2
+}
+
+# 以 CONFIG+=syzygy 建置時啟用殘局庫走棋與勝負判定
+# 須先以 qt_chess_perft --tablebase-check 對真實的 .rtbw / .rtbz 檔案驗證通過，未指定時該功能關閉
+syzygy {
+    DEFINES += QT_CHESS_USE_SYZYGY
+}
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
@@ -12,9 +26,18 @@ RC_FILE = app.rc
 SOURCES += \
     src/main.cpp \
     src/qt_chess.cpp \
+    src/bitboard.cpp \
     src/chesspiece.cpp \
     src/chessboard.cpp \
+    src/transpositiontable.cpp \
+    src/searchengine.cpp \
+    src/timemanager.cpp \
+    src/uciinfo.cpp \
     src/chessengine.cpp \
+    src/enginepool.cpp \
+    src/gameannotator.cpp \
+    src/openingbook.cpp \
+    src/tablebase.cpp \
     src/soundsettingsdialog.cpp \
     src/pieceiconsettingsdialog.cpp \
     src/boardcolorsettingsdialog.cpp \
@@ -24,9 +47,21 @@ SOURCES += \
 
 HEADERS += \
     src/qt_chess.h \
+    src/bitboard.h \
     src/chesspiece.h \
+    src/chessmove.h \
+    src/zobrist.h \
     src/chessboard.h \
+    src/transpositiontable.h \
+    src/searchengine.h \
+    src/timemanager.h \
+    src/uciinfo.h \
     src/chessengine.h \
+    src/difficulty.h \
+    src/enginepool.h \
+    src/gameannotator.h \
+    src/openingbook.h \
+    src/tablebase.h \
     src/soundsettingsdialog.h \
     src/pieceiconsettingsdialog.h \
     src/boardcolorsettingsdialog.h \
@@ -41,6 +76,31 @@ FORMS += \
 RESOURCES += \
     resources.qrc
 
+# 無介面的 perft 工具（tools/perft，只依賴 QtCore）
+#   make qt_chess_perft   建置工具
+#   make perft_check      建置並執行內建的標準 perft 測試組
+PERFT_BUILD_DIR = $$OUT_PWD/perft
+mkpath($$PERFT_BUILD_DIR)
+qt_chess_perft.target = qt_chess_perft
+qt_chess_perft.CONFIG = phony
+qt_chess_perft.commands = cd $$shell_quote($$shell_path($$PERFT_BUILD_DIR)) && \
+    $(QMAKE) $$shell_quote($$shell_path($$PWD/tools/perft/qt_chess_perft.pro)) && $(MAKE)
+perft_check.target = perft_check
+perft_check.CONFIG = phony
+perft_check.depends = qt_chess_perft
+perft_check.commands = $$shell_quote($$shell_path($$PERFT_BUILD_DIR/qt_chess_perft)) --suite
+QMAKE_EXTRA_TARGETS += qt_chess_perft perft_check
+
+# 無介面的對戰工具（tools/match，只依賴 QtCore）
+#   make qt_chess_match   建置工具，用法見 BUILDING.md
+MATCH_BUILD_DIR = $$OUT_PWD/match
+mkpath($$MATCH_BUILD_DIR)
+qt_chess_match.target = qt_chess_match
+qt_chess_match.CONFIG = phony
+qt_chess_match.commands = cd $$shell_quote($$shell_path($$MATCH_BUILD_DIR)) && \
+    $(QMAKE) $$shell_quote($$shell_path($$PWD/tools/match/qt_chess_match.pro)) && $(MAKE)
+QMAKE_EXTRA_TARGETS += qt_chess_match
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
@@ -0,0 +1,175 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <array>
+#include "chesspiece.h"
+
+// 編譯器已啟用 BMI2（例如 -march=native）時自動使用 PEXT，可用 QT_CHESS_NO_PEXT 關閉
+#if !defined(QT_CHESS_USE_PEXT) && !defined(QT_CHESS_NO_PEXT) && defined(__BMI2__)
+#define QT_CHESS_USE_PEXT
+#endif
+
+#ifdef QT_CHESS_USE_PEXT
+#include <immintrin.h>
+#endif
+
+// ===== 位元棋盤（Bitboard）=====
+// 每個 64 位元整數代表一組格子：第 n 位元對應格子 n = row * 8 + col
+// row 0 是第 8 橫列（黑方底線），col 0 是 a 直行，與 QPoint(x=col, y=row) 一致
+
+using Bitboard = quint64;
+
+namespace Bitboards {
+    constexpr Bitboard EMPTY = 0ULL;
+    constexpr Bitboard FILE_A = 0x0101010101010101ULL;
+    constexpr Bitboard FILE_B = FILE_A << 1;
+    constexpr Bitboard FILE_G = FILE_A << 6;
+    constexpr Bitboard FILE_H = FILE_A << 7;
+    constexpr Bitboard ROW_0 = 0x00000000000000FFULL;  // 第 8 橫列
+    constexpr Bitboard ROW_7 = ROW_0 << 56;            // 第 1 橫列
+    constexpr Bitboard EVEN_SQUARES = 0xAA55AA55AA55AA55ULL;  // (row + col) 為偶數的格子
+
+    constexpr int NO_SQUARE = -1;
+
+    // 格子索引轉換
+    constexpr int squareIndex(int row, int col) { return row * 8 + col; }
+    constexpr int rowOf(int square) { return square >> 3; }
+    constexpr int colOf(int square) { return square & 7; }
+    constexpr Bitboard squareMask(int square) { return Bitboard(1) << square; }
+    constexpr bool isOnBoard(int row, int col) { return row >= 0 && row < 8 && col >= 0 && col < 8; }
+
+    // 位元運算
+    inline int lsb(Bitboard b) { return static_cast<int>(qCountTrailingZeroBits(b)); }
+    inline int popCount(Bitboard b) { return static_cast<int>(qPopulationCount(b)); }
+    inline int popLsb(Bitboard& b) {
+        int square = lsb(b);
+        b &= b - 1;
+        return square;
+    }
+
+    // 棋子陣列索引：白方 0-5，黑方 6-11（兵、車、馬、象、后、王）
+    constexpr int PIECE_KINDS = 12;
+    constexpr int colorIndex(PieceColor color) { return color == PieceColor::Black ? 1 : 0; }
+    constexpr int typeIndex(PieceType type) { return static_cast<int>(type) - 1; }
+    constexpr int pieceIndex(PieceType type, PieceColor color) {
+        return colorIndex(color) * 6 + typeIndex(type);
+    }
+
+    // 方向位移（north = 朝第 8 橫列，即 row 減少）
+    constexpr Bitboard shiftNorth(Bitboard b) { return b >> 8; }
+    constexpr Bitboard shiftSouth(Bitboard b) { return b << 8; }
+    constexpr Bitboard shiftEast(Bitboard b) { return (b << 1) & ~FILE_A; }
+    constexpr Bitboard shiftWest(Bitboard b) { return (b >> 1) & ~FILE_H; }
+
+    // 非滑動棋子的攻擊遮罩計算（僅供編譯期建表使用）
+    constexpr Bitboard knightAttackMask(int square) {
+        Bitboard b = squareMask(square);
+        Bitboard east1 = (b << 1) & ~FILE_A;
+        Bitboard west1 = (b >> 1) & ~FILE_H;
+        Bitboard east2 = (b << 2) & ~(FILE_A | FILE_B);
+        Bitboard west2 = (b >> 2) & ~(FILE_G | FILE_H);
+        Bitboard h1 = east1 | west1;
+        Bitboard h2 = east2 | west2;
+        return (h1 << 16) | (h1 >> 16) | (h2 << 8) | (h2 >> 8);
+    }
+
+    constexpr Bitboard kingAttackMask(int square) {
+        Bitboard b = squareMask(square);
+        Bitboard row = b | shiftEast(b) | shiftWest(b);
+        return (row | shiftNorth(row) | shiftSouth(row)) & ~b;
+    }
+
+    // 兵的斜向攻擊（白兵朝 row 減少的方向前進）
+    constexpr Bitboard pawnAttackMask(int square, PieceColor color) {
+        Bitboard b = squareMask(square);
+        Bitboard forward = (color == PieceColor::White) ? shiftNorth(b) : shiftSouth(b);
+        return shiftEast(forward) | shiftWest(forward);
+    }
+
+    using AttackTable = std::array<Bitboard, 64>;
+
+    constexpr AttackTable generateKnightTable() {
+        AttackTable table{};
+        for (int square = 0; square < 64; ++square) table[square] = knightAttackMask(square);
+        return table;
+    }
+
+    constexpr AttackTable generateKingTable() {
+        AttackTable table{};
+        for (int square = 0; square < 64; ++square) table[square] = kingAttackMask(square);
+        return table;
+    }
+
+    constexpr std::array<AttackTable, 2> generatePawnTables() {
+        std::array<AttackTable, 2> tables{};
+        for (int square = 0; square < 64; ++square) {
+            tables[0][square] = pawnAttackMask(square, PieceColor::White);
+            tables[1][square] = pawnAttackMask(square, PieceColor::Black);
+        }
+        return tables;
+    }
+
+    // 編譯期產生的攻擊表：非滑動棋子的攻擊查詢只需一次表格讀取
+    inline constexpr AttackTable KNIGHT_ATTACKS = generateKnightTable();
+    inline constexpr AttackTable KING_ATTACKS = generateKingTable();
+    inline constexpr std::array<AttackTable, 2> PAWN_ATTACKS = generatePawnTables();  // [colorIndex][square]
+
+    static_assert(KNIGHT_ATTACKS[0] == ((Bitboard(1) << 10) | (Bitboard(1) << 17)), "a8 馬的攻擊範圍應為 c7 與 b6");
+    static_assert(KING_ATTACKS[63] == ((Bitboard(1) << 54) | (Bitboard(1) << 55) | (Bitboard(1) << 62)), "h1 王的攻擊範圍應為 g2、h2 與 g1");
+    static_assert(PAWN_ATTACKS[0][squareIndex(6, 0)] == squareMask(squareIndex(5, 1)), "a2 白兵只攻擊 b3");
+
+    constexpr Bitboard knightAttacks(int square) { return KNIGHT_ATTACKS[square]; }
+    constexpr Bitboard kingAttacks(int square) { return KING_ATTACKS[square]; }
+    constexpr Bitboard pawnAttacks(int square, PieceColor color) { return PAWN_ATTACKS[colorIndex(color)][square]; }
+
+    // ===== 滑動棋子的攻擊範圍（magic bitboard）=====
+    // 每格預先建立「遮罩內所有阻擋組合 → 攻擊範圍」的查詢表，查詢時把佔用遮罩映射成表格索引：
+    // - 預設使用 magic 乘法：((occupied & mask) * magic) >> shift
+    // - 以 CONFIG+=pext 建置（或編譯器已啟用 BMI2）時改用 PEXT 指令直接擷取遮罩位元
+    // 查詢表由 initSliderAttacks() 在啟動時建立一次（ChessBoard 建構時也會確保已初始化）
+    struct SliderMagic {
+        Bitboard mask;           // 不含邊緣格的射線遮罩（邊緣格是否有棋子不影響攻擊範圍）
+        Bitboard magic;
+        const Bitboard* attacks; // 指向此格在共用查詢表中的起點
+        int shift;
+    };
+
+    extern SliderMagic ROOK_MAGICS[64];
+    extern SliderMagic BISHOP_MAGICS[64];
+
+    void initSliderAttacks();
+
+    inline quint64 sliderIndex(const SliderMagic& entry, Bitboard occupied) {
+#ifdef QT_CHESS_USE_PEXT
+        return _pext_u64(occupied, entry.mask);
+#else
+        return ((occupied & entry.mask) * entry.magic) >> entry.shift;
+#endif
+    }
+
+    inline Bitboard rookAttacks(int square, Bitboard occupied) {
+        const SliderMagic& entry = ROOK_MAGICS[square];
+        return entry.attacks[sliderIndex(entry, occupied)];
+    }
+
+    inline Bitboard bishopAttacks(int square, Bitboard occupied) {
+        const SliderMagic& entry = BISHOP_MAGICS[square];
+        return entry.attacks[sliderIndex(entry, occupied)];
+    }
+
+    inline Bitboard queenAttacks(int square, Bitboard occupied) {
+        return rookAttacks(square, occupied) | bishopAttacks(square, occupied);
+    }
+
+    // 兩格之間的格子（不含兩端）與通過兩格的整條直線（含兩端）；不在同一直線/斜線上時為 EMPTY
+    // 與滑動棋子查詢表一起由 initSliderAttacks() 建立，用於釘住與擋將判斷
+    extern Bitboard BETWEEN[64][64];
+    extern Bitboard LINE[64][64];
+
+    inline Bitboard between(int a, int b) { return BETWEEN[a][b]; }
+    inline Bitboard line(int a, int b) { return LINE[a][b]; }
+}
+
+#endif // BITBOARD_H
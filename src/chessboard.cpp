@@ -1,166 +1,547 @@
 #include "chessboard.h"
 #include <QRandomGenerator>
 #include <algorithm>
+#include <iterator>
 
 ChessBoard::ChessBoard()
-    : m_board(8, std::vector<ChessPiece>(8)), m_currentPlayer(PieceColor::White), m_enPassantTarget(-1, -1), m_gameResult(GameResult::InProgress), m_bombModeEnabled(false), m_lastMoveTriggeredMine(false)
+    : m_currentPlayer(PieceColor::White), m_enPassantTarget(-1, -1), m_gameResult(GameResult::InProgress), m_bombModeEnabled(false), m_lastMoveTriggeredMine(false), m_halfmoveClock(0), m_fullmoveNumber(1), m_castlingRights(NoCastling), m_hash(0), m_stateKey(0)
 {
+    Bitboards::initSliderAttacks();
+    
+    // 預先保留容量，使 makeMove/unmakeMove 在一般對局長度內不需配置記憶體
+    m_undoStack.reserve(1024);
+    m_keyHistory.reserve(1024);
+    m_capturedWhite.reserve(32);
+    m_capturedBlack.reserve(32);
+    clearBoard();
     initializeBoard();
 }
 
 void ChessBoard::initializeBoard() {
     // 初始化空棋盤
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            m_board[row][col] = ChessPiece(PieceType::None, PieceColor::None);
-        }
-    }
+    clearBoard();
     
-    // 設置黑色棋子（第 0 和 1 行）
-    m_board[0][0] = ChessPiece(PieceType::Rook, PieceColor::Black);
-    m_board[0][1] = ChessPiece(PieceType::Knight, PieceColor::Black);
-    m_board[0][2] = ChessPiece(PieceType::Bishop, PieceColor::Black);
-    m_board[0][3] = ChessPiece(PieceType::Queen, PieceColor::Black);
-    m_board[0][4] = ChessPiece(PieceType::King, PieceColor::Black);
-    m_board[0][5] = ChessPiece(PieceType::Bishop, PieceColor::Black);
-    m_board[0][6] = ChessPiece(PieceType::Knight, PieceColor::Black);
-    m_board[0][7] = ChessPiece(PieceType::Rook, PieceColor::Black);
+    // 底線棋子的排列順序
+    static const PieceType backRank[8] = {
+        PieceType::Rook, PieceType::Knight, PieceType::Bishop, PieceType::Queen,
+        PieceType::King, PieceType::Bishop, PieceType::Knight, PieceType::Rook
+    };
     
+    // 設置黑色棋子（第 0 和 1 行）與白色棋子（第 6 和 7 行）
     for (int col = 0; col < 8; ++col) {
-        m_board[1][col] = ChessPiece(PieceType::Pawn, PieceColor::Black);
+        putPiece(Bitboards::squareIndex(0, col), ChessPiece(backRank[col], PieceColor::Black));
+        putPiece(Bitboards::squareIndex(1, col), ChessPiece(PieceType::Pawn, PieceColor::Black));
+        putPiece(Bitboards::squareIndex(6, col), ChessPiece(PieceType::Pawn, PieceColor::White));
+        putPiece(Bitboards::squareIndex(7, col), ChessPiece(backRank[col], PieceColor::White));
     }
     
-    // 設置白色棋子（第 6 和 7 行）
-    for (int col = 0; col < 8; ++col) {
-        m_board[6][col] = ChessPiece(PieceType::Pawn, PieceColor::White);
-    }
-    
-    m_board[7][0] = ChessPiece(PieceType::Rook, PieceColor::White);
-    m_board[7][1] = ChessPiece(PieceType::Knight, PieceColor::White);
-    m_board[7][2] = ChessPiece(PieceType::Bishop, PieceColor::White);
-    m_board[7][3] = ChessPiece(PieceType::Queen, PieceColor::White);
-    m_board[7][4] = ChessPiece(PieceType::King, PieceColor::White);
-    m_board[7][5] = ChessPiece(PieceType::Bishop, PieceColor::White);
-    m_board[7][6] = ChessPiece(PieceType::Knight, PieceColor::White);
-    m_board[7][7] = ChessPiece(PieceType::Rook, PieceColor::White);
-    
     m_currentPlayer = PieceColor::White;
     m_enPassantTarget = QPoint(-1, -1);
-    m_moveHistory.clear();
+    clearMoveHistory();
+    m_undoStack.clear();
+    m_halfmoveClock = 0;
+    m_fullmoveNumber = 1;
+    m_castlingRights = WhiteKingSide | WhiteQueenSide | BlackKingSide | BlackQueenSide;
+    m_gameResult = GameResult::InProgress;
+    clearCapturedPieces();
+    
+    // 清除地雷（clearBoard 已重置雜湊，地雷鍵不需個別移除）
+    m_minePositions.clear();
+    
+    refreshStateKey();
+    resetKeyHistory();
+}
+
+bool ChessBoard::setFromFEN(QStringView fen) {
+    // 先解析到堆疊上的暫存區，所有欄位都正確後才套用，因此錯誤時棋盤保持不變
+    ChessPiece placement[64];
+    const int length = static_cast<int>(fen.size());
+    int pos = 0;
+    auto skipSpaces = [&]() {
+        while (pos < length && fen[pos] == QLatin1Char(' ')) ++pos;
+    };
+    auto atFieldEnd = [&]() { return pos >= length || fen[pos] == QLatin1Char(' '); };
+    
+    // 1. 棋子配置（第 8 橫列到第 1 橫列，對應 row 0 到 row 7）
+    skipSpaces();
+    int row = 0;
+    int col = 0;
+    while (!atFieldEnd()) {
+        char c = fen[pos++].toLatin1();
+        if (c == '/') {
+            if (col != 8 || row == 7) return false;
+            ++row;
+            col = 0;
+        } else if (c >= '1' && c <= '8') {
+            col += c - '0';
+            if (col > 8) return false;
+        } else {
+            PieceType type;
+            switch (c | 0x20) {  // 轉為小寫
+                case 'p': type = PieceType::Pawn;   break;
+                case 'n': type = PieceType::Knight; break;
+                case 'b': type = PieceType::Bishop; break;
+                case 'r': type = PieceType::Rook;   break;
+                case 'q': type = PieceType::Queen;  break;
+                case 'k': type = PieceType::King;   break;
+                default:  return false;
+            }
+            if (col >= 8) return false;
+            PieceColor color = (c >= 'A' && c <= 'Z') ? PieceColor::White : PieceColor::Black;
+            placement[Bitboards::squareIndex(row, col++)] = ChessPiece(type, color);
+        }
+    }
+    if (row != 7 || col != 8) return false;
+    
+    // 2. 行棋方
+    skipSpaces();
+    if (pos >= length) return false;
+    char side = fen[pos++].toLatin1();
+    if ((side != 'w' && side != 'b') || !atFieldEnd()) return false;
+    PieceColor player = (side == 'w') ? PieceColor::White : PieceColor::Black;
+    
+    // 3. 王車易位權（省略時視為 -）
+    quint8 rights = NoCastling;
+    skipSpaces();
+    if (pos < length && fen[pos] == QLatin1Char('-')) {
+        ++pos;
+    } else {
+        while (!atFieldEnd()) {
+            switch (fen[pos++].toLatin1()) {
+                case 'K': rights |= WhiteKingSide;  break;
+                case 'Q': rights |= WhiteQueenSide; break;
+                case 'k': rights |= BlackKingSide;  break;
+                case 'q': rights |= BlackQueenSide; break;
+                default:  return false;
+            }
+        }
+    }
+    if (!atFieldEnd()) return false;
+    
+    // 4. 吃過路兵目標格（省略時視為 -）
+    QPoint enPassant(-1, -1);
+    skipSpaces();
+    if (pos < length && fen[pos] == QLatin1Char('-')) {
+        ++pos;
+    } else if (pos < length) {
+        if (pos + 1 >= length) return false;
+        char file = fen[pos].toLatin1();
+        char rank = fen[pos + 1].toLatin1();
+        pos += 2;
+        if (file < 'a' || file > 'h' || (rank != '3' && rank != '6')) return false;
+        // 只保留與行棋方一致的目標格（白方行棋時在第 6 橫列，黑方行棋時在第 3 橫列）
+        if ((player == PieceColor::White) == (rank == '6')) {
+            enPassant = QPoint(file - 'a', '8' - rank);
+        }
+    }
+    if (!atFieldEnd()) return false;
+    
+    // 5、6. 半回合計數與回合數（省略時為 0 與 1）
+    auto parseNumber = [&](int& value) {
+        skipSpaces();
+        if (pos >= length) return true;
+        int number = 0;
+        int digits = 0;
+        while (pos < length && fen[pos].isDigit() && digits < 6) {
+            number = number * 10 + fen[pos++].digitValue();
+            ++digits;
+        }
+        if (digits == 0 || !atFieldEnd()) return false;
+        value = number;
+        return true;
+    };
+    int halfmoveClock = 0;
+    int fullmoveNumber = 1;
+    if (!parseNumber(halfmoveClock) || !parseNumber(fullmoveNumber)) return false;
+    skipSpaces();
+    if (pos != length) return false;
+    
+    // 套用局面
+    clearBoard();
+    for (int square = 0; square < 64; ++square) {
+        ChessPiece piece = placement[square];
+        if (piece.getType() == PieceType::None) continue;
+        // 兵只有在起始橫列才能走兩格；國王與車的 hasMoved 在下方依易位權設定
+        if (piece.getType() == PieceType::Pawn) {
+            int startRow = (piece.getColor() == PieceColor::White) ? 6 : 1;
+            piece.setMoved(Bitboards::rowOf(square) != startRow);
+        } else {
+            piece.setMoved(piece.getType() == PieceType::King || piece.getType() == PieceType::Rook);
+        }
+        putPiece(square, piece);
+    }
+    
+    // 只保留國王與車確實在原位的易位權，並讓對應棋子的 hasMoved 與易位權一致
+    m_castlingRights = rights & placementCastlingRights();
+    auto markUnmoved = [this](int row, int col) {
+        m_board[Bitboards::squareIndex(row, col)].setMoved(false);
+    };
+    if (m_castlingRights & (WhiteKingSide | WhiteQueenSide)) markUnmoved(7, 4);
+    if (m_castlingRights & WhiteKingSide) markUnmoved(7, 7);
+    if (m_castlingRights & WhiteQueenSide) markUnmoved(7, 0);
+    if (m_castlingRights & (BlackKingSide | BlackQueenSide)) markUnmoved(0, 4);
+    if (m_castlingRights & BlackKingSide) markUnmoved(0, 7);
+    if (m_castlingRights & BlackQueenSide) markUnmoved(0, 0);
+    
+    m_currentPlayer = PieceColor::White;  // clearBoard 後的雜湊對應白方行棋
+    if (player == PieceColor::Black) switchPlayer();
+    m_enPassantTarget = enPassant;
+    m_halfmoveClock = halfmoveClock;
+    m_fullmoveNumber = std::max(1, fullmoveNumber);
     m_gameResult = GameResult::InProgress;
+    m_lastMoveTriggeredMine = false;
+    clearMoveHistory();
+    m_undoStack.clear();
     clearCapturedPieces();
     
-    // 清除地雷
+    // 清除地雷（clearBoard 已重置雜湊，地雷鍵不需個別移除）
     m_minePositions.clear();
+    
+    refreshStateKey();
+    resetKeyHistory();
+    return true;
 }
 
 const ChessPiece& ChessBoard::getPiece(int row, int col) const {
     // 邊界檢查以防止陣列越界訪問
-    if (row < 0 || row >= 8 || col < 0 || col >= 8) {
+    if (!Bitboards::isOnBoard(row, col)) {
         static const ChessPiece empty(PieceType::None, PieceColor::None);
         return empty;
     }
-    return m_board[row][col];
+    return m_board[Bitboards::squareIndex(row, col)];
 }
 
-ChessPiece& ChessBoard::getPiece(int row, int col) {
-    // 邊界檢查以防止陣列越界訪問
-    if (row < 0 || row >= 8 || col < 0 || col >= 8) {
-        static ChessPiece empty(PieceType::None, PieceColor::None);
-        return empty;
+void ChessBoard::setPiece(int row, int col, const ChessPiece& piece) {
+    if (Bitboards::isOnBoard(row, col)) {
+        int square = Bitboards::squareIndex(row, col);
+        removePiece(square);
+        putPiece(square, piece);
+        m_castlingRights &= placementCastlingRights();  // 國王或車離開原位時失去易位權
+        refreshStateKey();
+        syncKeyHistory();
+        // 外部修改棋盤（重力、傳送、恢復狀態等）後，撤銷記錄不再對應目前局面
+        m_undoStack.clear();
     }
-    return m_board[row][col];
 }
 
-void ChessBoard::setPiece(int row, int col, const ChessPiece& piece) {
-    if (row >= 0 && row < 8 && col >= 0 && col < 8) {
-        m_board[row][col] = piece;
+void ChessBoard::setCurrentPlayer(PieceColor player) {
+    if (player != m_currentPlayer) {
+        switchPlayer();
+        refreshStateKey();  // 吃過路兵鍵取決於行棋方能否吃過路兵
+        syncKeyHistory();
     }
 }
 
-QPoint ChessBoard::findKing(PieceColor color) const {
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            const ChessPiece& piece = m_board[row][col];
-            if (piece.getType() == PieceType::King && piece.getColor() == color) {
-                return QPoint(col, row);
-            }
+void ChessBoard::setEnPassantTarget(const QPoint& target) {
+    m_enPassantTarget = target;
+    refreshStateKey();
+    syncKeyHistory();
+}
+
+void ChessBoard::putPiece(int square, const ChessPiece& piece) {
+    // 呼叫者需確保目標格為空
+    if (piece.getType() == PieceType::None || piece.getColor() == PieceColor::None) {
+        m_board[square] = ChessPiece(PieceType::None, PieceColor::None);
+        return;
+    }
+    
+    m_board[square] = piece;
+    Bitboard mask = Bitboards::squareMask(square);
+    int index = Bitboards::pieceIndex(piece.getType(), piece.getColor());
+    m_pieceBitboards[index] |= mask;
+    m_hash ^= Zobrist::KEYS.pieces[index][square];
+    int color = Bitboards::colorIndex(piece.getColor());
+    m_colorBitboards[color] |= mask;
+    m_occupied |= mask;
+    m_checkInfoValid[0] = m_checkInfoValid[1] = false;
+    
+    PieceList& list = m_pieceLists[color];
+    m_pieceListIndex[square] = static_cast<qint8>(list.count);
+    list.squares[list.count++] = static_cast<qint8>(square);
+    if (piece.getType() == PieceType::King && m_kingSquare[color] == Bitboards::NO_SQUARE) {
+        m_kingSquare[color] = static_cast<qint8>(square);
+    }
+}
+
+void ChessBoard::removePiece(int square) {
+    const ChessPiece& piece = m_board[square];
+    if (piece.getType() != PieceType::None) {
+        Bitboard mask = ~Bitboards::squareMask(square);
+        int index = Bitboards::pieceIndex(piece.getType(), piece.getColor());
+        m_pieceBitboards[index] &= mask;
+        m_hash ^= Zobrist::KEYS.pieces[index][square];
+        int color = Bitboards::colorIndex(piece.getColor());
+        m_colorBitboards[color] &= mask;
+        m_occupied &= mask;
+        m_checkInfoValid[0] = m_checkInfoValid[1] = false;
+        
+        // 以清單最後一項遞補被移除的位置
+        PieceList& list = m_pieceLists[color];
+        int slot = m_pieceListIndex[square];
+        int last = list.squares[--list.count];
+        list.squares[slot] = static_cast<qint8>(last);
+        m_pieceListIndex[last] = static_cast<qint8>(slot);
+        if (m_kingSquare[color] == square) {
+            // 一般對局只有一個國王；setPiece 造成多個國王時改用剩下的任一個
+            Bitboard kings = m_pieceBitboards[index];
+            m_kingSquare[color] = kings ? static_cast<qint8>(Bitboards::lsb(kings)) : qint8(Bitboards::NO_SQUARE);
         }
     }
-    return QPoint(-1, -1);
+    m_board[square] = ChessPiece(PieceType::None, PieceColor::None);
+}
+
+void ChessBoard::clearBoard() {
+    for (int square = 0; square < 64; ++square) {
+        m_board[square] = ChessPiece(PieceType::None, PieceColor::None);
+    }
+    for (int i = 0; i < Bitboards::PIECE_KINDS; ++i) {
+        m_pieceBitboards[i] = Bitboards::EMPTY;
+    }
+    m_colorBitboards[0] = m_colorBitboards[1] = Bitboards::EMPTY;
+    m_occupied = Bitboards::EMPTY;
+    m_checkInfoValid[0] = m_checkInfoValid[1] = false;
+    m_kingSquare[0] = m_kingSquare[1] = Bitboards::NO_SQUARE;
+    m_pieceLists[0].count = m_pieceLists[1].count = 0;
+    // 雜湊歸零（不含行棋方鍵，呼叫者隨後直接將行棋方設為白方）
+    m_hash = 0;
+    m_stateKey = 0;
+    m_castlingRights = NoCastling;
+}
+
+quint8 ChessBoard::placementCastlingRights() const {
+    // 國王與對應的車都在原位時才可能保有易位權
+    auto placed = [this](int square, PieceType type, PieceColor color) {
+        const ChessPiece& piece = m_board[square];
+        return piece.getType() == type && piece.getColor() == color;
+    };
+    
+    quint8 rights = NoCastling;
+    if (placed(Bitboards::squareIndex(7, 4), PieceType::King, PieceColor::White)) {
+        if (placed(Bitboards::squareIndex(7, 7), PieceType::Rook, PieceColor::White)) rights |= WhiteKingSide;
+        if (placed(Bitboards::squareIndex(7, 0), PieceType::Rook, PieceColor::White)) rights |= WhiteQueenSide;
+    }
+    if (placed(Bitboards::squareIndex(0, 4), PieceType::King, PieceColor::Black)) {
+        if (placed(Bitboards::squareIndex(0, 7), PieceType::Rook, PieceColor::Black)) rights |= BlackKingSide;
+        if (placed(Bitboards::squareIndex(0, 0), PieceType::Rook, PieceColor::Black)) rights |= BlackQueenSide;
+    }
+    return rights;
+}
+
+void ChessBoard::setCastlingRights(quint8 rights) {
+    m_castlingRights = rights & placementCastlingRights();
+    refreshStateKey();
+    syncKeyHistory();
+}
+
+quint64 ChessBoard::stateKey() const {
+    quint64 key = Zobrist::KEYS.castling[m_castlingRights];
+    
+    // 只有行棋方確實有兵能吃過路兵時才計入，使無法吃過路兵的相同局面得到相同的鍵
+    if (m_enPassantTarget.x() >= 0) {
+        PieceColor opponentColor = (m_currentPlayer == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+        int square = Bitboards::squareIndex(m_enPassantTarget.y(), m_enPassantTarget.x());
+        if (Bitboards::pawnAttacks(square, opponentColor) & pieceBitboard(PieceType::Pawn, m_currentPlayer)) {
+            key ^= Zobrist::KEYS.enPassant[m_enPassantTarget.x()];
+        }
+    }
+    return key;
+}
+
+void ChessBoard::refreshStateKey() {
+    m_hash ^= m_stateKey;
+    m_stateKey = stateKey();
+    m_hash ^= m_stateKey;
+}
+
+void ChessBoard::toggleMineKey(const QPoint& pos) {
+    m_hash ^= Zobrist::KEYS.mines[Bitboards::squareIndex(pos.y(), pos.x())];
+}
+
+void ChessBoard::pushKeyHistory() {
+    m_keyHistory.push_back(m_hash);
+    ++m_repetitionBuckets[m_hash % REPETITION_BUCKETS];
+}
+
+void ChessBoard::popKeyHistory() {
+    if (m_keyHistory.empty()) return;
+    --m_repetitionBuckets[m_keyHistory.back() % REPETITION_BUCKETS];
+    m_keyHistory.pop_back();
+}
+
+void ChessBoard::syncKeyHistory() {
+    // 棋盤被外部修改（重力、傳送、設定地雷等）時，以新的鍵取代目前局面的記錄
+    popKeyHistory();
+    pushKeyHistory();
+}
+
+void ChessBoard::resetKeyHistory() {
+    m_keyHistory.clear();
+    std::fill(std::begin(m_repetitionBuckets), std::end(m_repetitionBuckets), 0);
+    pushKeyHistory();
+}
+
+int ChessBoard::repetitionCount() const {
+    // 桶內只有目前局面本身：必定未重複
+    if (m_repetitionBuckets[m_hash % REPETITION_BUCKETS] < 2) return 1;
+    
+    // 只需比對上次吃子或兵移動之後、同一方行棋的局面
+    int last = static_cast<int>(m_keyHistory.size()) - 1;
+    int oldest = std::max(0, last - m_halfmoveClock);
+    int count = 1;
+    for (int i = last - 2; i >= oldest; i -= 2) {
+        if (m_keyHistory[i] == m_hash) ++count;
+    }
+    return count;
+}
+
+quint64 ChessBoard::computeHash() const {
+    quint64 key = (m_currentPlayer == PieceColor::Black) ? Zobrist::KEYS.blackToMove : 0;
+    for (int index = 0; index < Bitboards::PIECE_KINDS; ++index) {
+        Bitboard pieces = m_pieceBitboards[index];
+        while (pieces) {
+            key ^= Zobrist::KEYS.pieces[index][Bitboards::popLsb(pieces)];
+        }
+    }
+    for (const QPoint& mine : m_minePositions) {
+        key ^= Zobrist::KEYS.mines[Bitboards::squareIndex(mine.y(), mine.x())];
+    }
+    return key ^ stateKey();
+}
+
+Bitboard ChessBoard::pieceBitboard(PieceType type, PieceColor color) const {
+    if (type == PieceType::None || color == PieceColor::None) return Bitboards::EMPTY;
+    return m_pieceBitboards[Bitboards::pieceIndex(type, color)];
+}
+
+Bitboard ChessBoard::colorBitboard(PieceColor color) const {
+    if (color == PieceColor::None) return Bitboards::EMPTY;
+    return m_colorBitboards[Bitboards::colorIndex(color)];
+}
+
+Bitboard ChessBoard::attackersTo(int square, PieceColor attackerColor, Bitboard occupied) const {
+    const Bitboard* pieces = &m_pieceBitboards[Bitboards::colorIndex(attackerColor) * 6];
+    PieceColor defenderColor = (attackerColor == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+    
+    Bitboard pawns   = pieces[Bitboards::typeIndex(PieceType::Pawn)];
+    Bitboard knights = pieces[Bitboards::typeIndex(PieceType::Knight)];
+    Bitboard kings   = pieces[Bitboards::typeIndex(PieceType::King)];
+    Bitboard queens  = pieces[Bitboards::typeIndex(PieceType::Queen)];
+    Bitboard rooksQueens   = pieces[Bitboards::typeIndex(PieceType::Rook)] | queens;
+    Bitboard bishopsQueens = pieces[Bitboards::typeIndex(PieceType::Bishop)] | queens;
+    
+    // 兵的攻擊是對稱的：從目標格以對方顏色的斜向攻擊找出攻擊者
+    return (Bitboards::pawnAttacks(square, defenderColor) & pawns)
+         | (Bitboards::knightAttacks(square) & knights)
+         | (Bitboards::kingAttacks(square) & kings)
+         | (Bitboards::rookAttacks(square, occupied) & rooksQueens)
+         | (Bitboards::bishopAttacks(square, occupied) & bishopsQueens);
+}
+
+bool ChessBoard::isSquareAttacked(int square, PieceColor attackerColor) const {
+    return attackersTo(square, attackerColor, m_occupied) != Bitboards::EMPTY;
+}
+
+QPoint ChessBoard::findKing(PieceColor color) const {
+    int square = kingSquare(color);
+    if (square == Bitboards::NO_SQUARE) return QPoint(-1, -1);
+    return QPoint(Bitboards::colOf(square), Bitboards::rowOf(square));
+}
+
+int ChessBoard::kingSquare(PieceColor color) const {
+    if (color == PieceColor::None) return Bitboards::NO_SQUARE;
+    return m_kingSquare[Bitboards::colorIndex(color)];
+}
+
+const PieceList& ChessBoard::pieceList(PieceColor color) const {
+    return m_pieceLists[Bitboards::colorIndex(color)];
 }
 
 bool ChessBoard::isInCheck(PieceColor color) const {
-    QPoint kingPos = findKing(color);
-    if (kingPos.x() < 0) return false;
+    if (color == PieceColor::None) return false;
+    return checkInfo(color).checkers != Bitboards::EMPTY;
+}
+
+const CheckInfo& ChessBoard::checkInfo(PieceColor color) const {
+    int index = Bitboards::colorIndex(color);
+    if (!m_checkInfoValid[index]) {
+        computeCheckInfo(color, m_checkInfo[index]);
+        m_checkInfoValid[index] = true;
+    }
+    return m_checkInfo[index];
+}
+
+void ChessBoard::computeCheckInfo(PieceColor color, CheckInfo& info) const {
+    int king = kingSquare(color);
+    if (king == Bitboards::NO_SQUARE) {
+        info.kingSquare = Bitboards::NO_SQUARE;
+        info.checkers = info.pinned = info.evasionMask = Bitboards::EMPTY;
+        return;
+    }
     
     PieceColor opponentColor = (color == PieceColor::White) ? PieceColor::Black : PieceColor::White;
-    
-    // 檢查是否有任何對手的棋子可以吃掉國王
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            const ChessPiece& piece = m_board[row][col];
-            if (piece.getColor() == opponentColor && piece.getType() != PieceType::None) {
-                if (piece.isValidMove(QPoint(col, row), kingPos, m_board, QPoint(-1, -1))) {
-                    return true;
-                }
-            }
+    info.kingSquare = king;
+    info.checkers = attackersTo(king, opponentColor, m_occupied);
+    
+    // 釘住：對方滑動棋子與國王之間恰好只有一個己方棋子
+    Bitboard queens = pieceBitboard(PieceType::Queen, opponentColor);
+    Bitboard snipers = (Bitboards::rookAttacks(king, Bitboards::EMPTY) & (pieceBitboard(PieceType::Rook, opponentColor) | queens))
+                     | (Bitboards::bishopAttacks(king, Bitboards::EMPTY) & (pieceBitboard(PieceType::Bishop, opponentColor) | queens));
+    Bitboard own = colorBitboard(color);
+    info.pinned = Bitboards::EMPTY;
+    while (snipers) {
+        int sniper = Bitboards::popLsb(snipers);
+        Bitboard blockers = Bitboards::between(king, sniper) & m_occupied;
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & own)) {
+            info.pinned |= blockers;
         }
     }
     
-    return false;
+    // 擋將遮罩：單將時可吃掉將軍者或擋在中間，雙將時只能移動國王
+    if (!info.checkers) {
+        info.evasionMask = ~Bitboards::EMPTY;
+    } else if (!(info.checkers & (info.checkers - 1))) {
+        int checker = Bitboards::lsb(info.checkers);
+        info.evasionMask = info.checkers | Bitboards::between(king, checker);
+    } else {
+        info.evasionMask = Bitboards::EMPTY;
+    }
 }
 
 bool ChessBoard::wouldBeInCheck(const QPoint& from, const QPoint& to, PieceColor color) const {
-    // 複製棋盤並模擬移動
-    std::vector<std::vector<ChessPiece>> tempBoard = m_board;
-    
-    // 在臨時棋盤上執行移動
-    // 注意：QPoint(x, y) 對應到 board[y][x]，因為 x=列，y=行
-    tempBoard[to.y()][to.x()] = tempBoard[from.y()][from.x()];
-    tempBoard[from.y()][from.x()] = ChessPiece(PieceType::None, PieceColor::None);
-    
-    // 在移動後找到國王的位置
-    QPoint kingPos(-1, -1);
-    if (tempBoard[to.y()][to.x()].getType() == PieceType::King) {
-        kingPos = to;
-    } else {
-        // 尋找國王
-        bool found = false;
-        for (int row = 0; row < 8 && !found; ++row) {
-            for (int col = 0; col < 8; ++col) {
-                const ChessPiece& piece = tempBoard[row][col];
-                if (piece.getType() == PieceType::King && piece.getColor() == color) {
-                    kingPos = QPoint(col, row);
-                    found = true;
-                    break;
-                }
-            }
-        }
+    // 在位元棋盤遮罩上模擬移動（不複製棋盤）
+    // 注意：QPoint(x, y) 對應到格子 y * 8 + x，因為 x=列，y=行
+    int fromSquare = Bitboards::squareIndex(from.y(), from.x());
+    int toSquare = Bitboards::squareIndex(to.y(), to.x());
+    Bitboard fromMask = Bitboards::squareMask(fromSquare);
+    Bitboard toMask = Bitboards::squareMask(toSquare);
+    const ChessPiece& piece = m_board[fromSquare];
+    
+    Bitboard occupied = (m_occupied & ~fromMask) | toMask;
+    Bitboard capturedMask = toMask;  // 被吃掉的棋子不再攻擊
+    
+    // 吃過路兵時，被吃的兵不在目標格上
+    if (piece.getType() == PieceType::Pawn && to == m_enPassantTarget &&
+        from.x() != to.x() && !(m_occupied & toMask)) {
+        Bitboard capturedPawnMask = Bitboards::squareMask(Bitboards::squareIndex(from.y(), to.x()));
+        occupied &= ~capturedPawnMask;
+        capturedMask |= capturedPawnMask;
     }
     
+    // 在移動後找到國王的位置
+    int king = (piece.getType() == PieceType::King) ? toSquare : kingSquare(color);
     // 如果找不到國王，認為它被將軍（防禦性程式設計）
-    if (kingPos.x() < 0) return true;
+    if (king == Bitboards::NO_SQUARE) return true;
     
     PieceColor opponentColor = (color == PieceColor::White) ? PieceColor::Black : PieceColor::White;
     
     // 檢查是否有任何對手的棋子可以吃掉國王
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            const ChessPiece& piece = tempBoard[row][col];
-            if (piece.getColor() == opponentColor && piece.getType() != PieceType::None) {
-                if (piece.isValidMove(QPoint(col, row), kingPos, tempBoard, QPoint(-1, -1))) {
-                    return true;
-                }
-            }
-        }
-    }
-    
-    return false;
+    return (attackersTo(king, opponentColor, occupied) & ~capturedMask) != Bitboards::EMPTY;
 }
 
 bool ChessBoard::isValidMove(const QPoint& from, const QPoint& to) const {
-    const ChessPiece& piece = m_board[from.y()][from.x()];
+    if (!Bitboards::isOnBoard(from.y(), from.x()) || !Bitboards::isOnBoard(to.y(), to.x())) return false;
+    
+    const ChessPiece& piece = m_board[Bitboards::squareIndex(from.y(), from.x())];
     
     // 檢查起始位置是否有棋子
     if (piece.getType() == PieceType::None) return false;
@@ -169,7 +550,7 @@ bool ChessBoard::isValidMove(const QPoint& from, const QPoint& to) const {
     if (piece.getColor() != m_currentPlayer) return false;
     
     // 不能吃掉對方的王（國王不能被吃）
-    const ChessPiece& targetPiece = m_board[to.y()][to.x()];
+    const ChessPiece& targetPiece = m_board[Bitboards::squareIndex(to.y(), to.x())];
     if (targetPiece.getType() == PieceType::King) {
         return false;
     }
@@ -180,10 +561,11 @@ bool ChessBoard::isValidMove(const QPoint& from, const QPoint& to) const {
     }
     
     // 檢查該棋子類型的移動是否有效
-    if (!piece.isValidMove(from, to, m_board, m_enPassantTarget)) return false;
+    if (!piece.isValidMove(from, to, *this, m_enPassantTarget)) return false;
     
-    // 檢查移動是否會使自己的國王被將軍
-    if (wouldBeInCheck(from, to, m_currentPlayer)) return false;
+    // 檢查移動是否會使自己的國王被將軍（以快取的將軍/釘住資訊判斷，不模擬移動）
+    Bitboard toMask = Bitboards::squareMask(Bitboards::squareIndex(to.y(), to.x()));
+    if (!(legalTargets(Bitboards::squareIndex(from.y(), from.x())) & toMask)) return false;
     
     return true;
 }
@@ -191,151 +573,378 @@ bool ChessBoard::isValidMove(const QPoint& from, const QPoint& to) const {
 bool ChessBoard::movePiece(const QPoint& from, const QPoint& to) {
     if (!isValidMove(from, to)) return false;
     
-    // 重置地雷觸發標誌
-    m_lastMoveTriggeredMine = false;
-    
-    ChessPiece& piece = m_board[from.y()][from.x()];
-    PieceType pieceType = piece.getType();
-    PieceColor pieceColor = piece.getColor();
+    Move move = createMove(from, to);
+    ChessPiece piece = getPiece(from.y(), from.x());  // 地雷可能炸掉棋子，先保存
+    quint8 disambiguation = disambiguationFlags(from, to);
+    makeMove(move);
     
-    // 檢查是否為吃子、王車易位或吃過路兵
-    bool isCapture = m_board[to.y()][to.x()].getType() != PieceType::None;
-    bool isCastling = (pieceType == PieceType::King && abs(to.x() - from.x()) == 2);
-    bool isEnPassant = (pieceType == PieceType::Pawn && to == m_enPassantTarget && m_enPassantTarget.x() >= 0);
+    // 記錄移動（recordMove 以棋子顏色判斷對手是否被將軍，與當前玩家無關）
+    recordMove(move, piece, disambiguation);
+    return true;
+}
+
+Move ChessBoard::createMove(const QPoint& from, const QPoint& to, PieceType promotionType) const {
+    int fromSquare = Bitboards::squareIndex(from.y(), from.x());
+    int toSquare = Bitboards::squareIndex(to.y(), to.x());
+    const ChessPiece& piece = m_board[fromSquare];
+    bool isCapture = m_board[toSquare].getType() != PieceType::None;
     
-    if (isEnPassant) {
-        isCapture = true;  // 吃過路兵也是吃子
+    if (piece.getType() == PieceType::King && abs(to.x() - from.x()) == 2) {
+        return Move(fromSquare, toSquare, to.x() > from.x() ? Move::KingCastle : Move::QueenCastle);
     }
     
-    // 追蹤被吃掉的棋子（在移動之前儲存）
-    if (isCapture && !isEnPassant) {
-        // 常規吃子：儲存目標位置的棋子
-        const ChessPiece& capturedPiece = m_board[to.y()][to.x()];
-        if (capturedPiece.getColor() == PieceColor::White) {
-            m_capturedWhite.push_back(capturedPiece);
-        } else if (capturedPiece.getColor() == PieceColor::Black) {
-            m_capturedBlack.push_back(capturedPiece);
+    if (piece.getType() == PieceType::Pawn) {
+        if (abs(to.y() - from.y()) == 2) {
+            return Move(fromSquare, toSquare, Move::DoublePawnPush);
         }
-    }
-    
-    // 處理王車易位
-    if (isCastling) {
-        // 王翼易位
-        if (to.x() > from.x()) {
-            // 將車從 h 列移到 f 列
-            ChessPiece& rook = m_board[from.y()][7];
-            m_board[from.y()][5] = rook;
-            m_board[from.y()][5].setMoved(true);
-            m_board[from.y()][7] = ChessPiece(PieceType::None, PieceColor::None);
+        if (!isCapture && to.x() != from.x()) {
+            return Move(fromSquare, toSquare, Move::EnPassant);
         }
-        // 后翼易位
-        else {
-            // 將車從 a 列移到 d 列
-            ChessPiece& rook = m_board[from.y()][0];
-            m_board[from.y()][3] = rook;
-            m_board[from.y()][3].setMoved(true);
-            m_board[from.y()][0] = ChessPiece(PieceType::None, PieceColor::None);
+        if (promotionType != PieceType::None) {
+            return Move(fromSquare, toSquare, Move::promotionFlags(promotionType, isCapture));
         }
     }
     
-    // 處理吃過路兵
-    if (isEnPassant) {
-        // 追蹤被吃掉的兵（吃過路兵時，被吃的兵在不同位置）
-        int capturedPawnRow = (pieceColor == PieceColor::White) ? to.y() + 1 : to.y() - 1;
-        const ChessPiece& capturedPawn = m_board[capturedPawnRow][to.x()];
-        if (capturedPawn.getColor() == PieceColor::White) {
-            m_capturedWhite.push_back(capturedPawn);
-        } else if (capturedPawn.getColor() == PieceColor::Black) {
-            m_capturedBlack.push_back(capturedPawn);
-        }
-        // 移除被吃掉的兵
-        m_board[capturedPawnRow][to.x()] = ChessPiece(PieceType::None, PieceColor::None);
+    return Move(fromSquare, toSquare, isCapture ? Move::Capture : Move::Quiet);
+}
+
+namespace {
+// 走法起訖格經過時需保留的易位權（e1/e8 與四個角落以外的格子不影響易位權）
+constexpr quint8 castlingRightsMask(int square) {
+    switch (square) {
+        case 60: return static_cast<quint8>(~(WhiteKingSide | WhiteQueenSide));  // e1
+        case 63: return static_cast<quint8>(~WhiteKingSide);                      // h1
+        case 56: return static_cast<quint8>(~WhiteQueenSide);                     // a1
+        case 4:  return static_cast<quint8>(~(BlackKingSide | BlackQueenSide));  // e8
+        case 7:  return static_cast<quint8>(~BlackKingSide);                      // h8
+        case 0:  return static_cast<quint8>(~BlackQueenSide);                     // a8
+        default: return 0xFF;
     }
+}
+}
+
+void ChessBoard::makeMove(Move move) {
+    int fromSquare = move.from();
+    int toSquare = move.to();
+    ChessPiece piece = m_board[fromSquare];
+    PieceColor pieceColor = piece.getColor();
     
-    // 在設置新的吃過路兵目標之前清除舊的
-    m_enPassantTarget = QPoint(-1, -1);
+    UndoRecord undo;
+    undo.move = move;
+    undo.movedPiece = piece;
+    undo.enPassantSquare = static_cast<qint8>(m_enPassantTarget.x() >= 0
+        ? Bitboards::squareIndex(m_enPassantTarget.y(), m_enPassantTarget.x())
+        : Bitboards::NO_SQUARE);
+    undo.mineIndex = -1;
+    undo.lastMoveTriggeredMine = m_lastMoveTriggeredMine;
+    undo.castlingRights = m_castlingRights;
+    undo.halfmoveClock = m_halfmoveClock;
+    undo.gameResult = m_gameResult;
+    
+    // 重置地雷觸發標誌
+    m_lastMoveTriggeredMine = false;
     
-    // 追蹤兵的雙格移動以便吃過路兵
-    if (pieceType == PieceType::Pawn && abs(to.y() - from.y()) == 2) {
-        // 將吃過路兵目標設置為兵跳過的格子（中間格子）
-        // 例如，如果白兵從第 6 行移到第 4 行，目標為第 5 行
-        int targetRow = (from.y() + to.y()) / 2;
-        m_enPassantTarget = QPoint(from.x(), targetRow);
+    // 吃子：吃過路兵時，被吃的兵與起始格同一行、與目標格同一列
+    int capturedSquare = move.isEnPassant()
+        ? Bitboards::squareIndex(Bitboards::rowOf(fromSquare), Bitboards::colOf(toSquare))
+        : toSquare;
+    undo.capturedPiece = m_board[capturedSquare];
+    if (undo.capturedPiece.getColor() == PieceColor::White) {
+        m_capturedWhite.push_back(undo.capturedPiece);
+    } else if (undo.capturedPiece.getColor() == PieceColor::Black) {
+        m_capturedBlack.push_back(undo.capturedPiece);
+    }
+    removePiece(capturedSquare);
+    
+    // 處理王車易位：王翼易位將車從 h 列移到 f 列；后翼易位將車從 a 列移到 d 列
+    if (move.isCastling()) {
+        int row = Bitboards::rowOf(fromSquare);
+        bool kingSide = (move.flags() == Move::KingCastle);
+        int rookFrom = Bitboards::squareIndex(row, kingSide ? 7 : 0);
+        ChessPiece rook = m_board[rookFrom];
+        rook.setMoved(true);
+        removePiece(rookFrom);
+        putPiece(Bitboards::squareIndex(row, kingSide ? 5 : 3), rook);
     }
     
-    // 執行移動
-    m_board[to.y()][to.x()] = piece;
-    m_board[to.y()][to.x()].setMoved(true);
-    m_board[from.y()][from.x()] = ChessPiece(PieceType::None, PieceColor::None);
+    // 執行移動（升變時直接放置升變後的棋子）
+    if (move.isPromotion()) {
+        piece = ChessPiece(move.promotionType(), pieceColor);
+    }
+    piece.setMoved(true);
+    removePiece(fromSquare);
+    putPiece(toSquare, piece);
+    
+    // 國王或車離開原位、或原位的車被吃掉時失去對應的易位權
+    m_castlingRights &= castlingRightsMask(fromSquare) & castlingRightsMask(toSquare);
+    
+    // 追蹤兵的雙格移動以便吃過路兵：目標為兵跳過的中間格子
+    if (move.flags() == Move::DoublePawnPush) {
+        int targetRow = (Bitboards::rowOf(fromSquare) + Bitboards::rowOf(toSquare)) / 2;
+        m_enPassantTarget = QPoint(Bitboards::colOf(fromSquare), targetRow);
+    } else {
+        m_enPassantTarget = QPoint(-1, -1);
+    }
+    
+    // 兵移動或吃子時重置半回合計數
+    if (undo.movedPiece.getType() == PieceType::Pawn || undo.capturedPiece.getType() != PieceType::None) {
+        m_halfmoveClock = 0;
+    } else {
+        ++m_halfmoveClock;
+    }
     
     // 檢查地雷爆炸
-    if (m_bombModeEnabled && isMineAt(to)) {
-        // 踩到地雷：棋子被摧毀（從棋盤上移除）
-        ChessPiece explodedPiece = m_board[to.y()][to.x()];
-        m_board[to.y()][to.x()] = ChessPiece(PieceType::None, PieceColor::None);
-        
-        // 將被炸毀的棋子加入被吃掉的棋子列表（用於顯示）
-        if (explodedPiece.getColor() == PieceColor::White) {
-            m_capturedWhite.push_back(explodedPiece);
-        } else if (explodedPiece.getColor() == PieceColor::Black) {
-            m_capturedBlack.push_back(explodedPiece);
-        }
-        
-        m_lastMoveTriggeredMine = true;
-        
-        // 地雷爆炸後移除該地雷
+    if (m_bombModeEnabled) {
+        QPoint to = move.toPoint();
         auto it = std::find(m_minePositions.begin(), m_minePositions.end(), to);
         if (it != m_minePositions.end()) {
-            m_minePositions.erase(it);
-        }
-        
-        // 如果國王被炸毀，遊戲立即結束，爆炸方輸
-        if (explodedPiece.getType() == PieceType::King) {
+            // 踩到地雷：棋子被摧毀（從棋盤上移除），並加入被吃掉的棋子列表（用於顯示）
+            ChessPiece explodedPiece = m_board[toSquare];
+            removePiece(toSquare);
             if (explodedPiece.getColor() == PieceColor::White) {
-                m_gameResult = GameResult::BlackWins;
-            } else {
-                m_gameResult = GameResult::WhiteWins;
+                m_capturedWhite.push_back(explodedPiece);
+            } else if (explodedPiece.getColor() == PieceColor::Black) {
+                m_capturedBlack.push_back(explodedPiece);
+            }
+            
+            m_lastMoveTriggeredMine = true;
+            
+            // 地雷爆炸後移除該地雷（記錄索引以便撤銷時放回原位）
+            undo.mineIndex = static_cast<qint8>(it - m_minePositions.begin());
+            m_minePositions.erase(it);
+            toggleMineKey(to);
+            
+            // 如果國王被炸毀，遊戲立即結束，爆炸方輸
+            if (explodedPiece.getType() == PieceType::King) {
+                m_gameResult = (explodedPiece.getColor() == PieceColor::White)
+                    ? GameResult::BlackWins : GameResult::WhiteWins;
             }
         }
     }
     
-    // 記錄移動（在切換玩家之前，因為 recordMove 需要檢查對手是否被將軍）
-    recordMove(from, to, isCapture, isCastling, isEnPassant);
+    if (pieceColor == PieceColor::Black) ++m_fullmoveNumber;
     
+    m_undoStack.push_back(undo);
     switchPlayer();
-    return true;
+    refreshStateKey();
+    pushKeyHistory();
+}
+
+void ChessBoard::unmakeMove() {
+    if (m_undoStack.empty()) return;
+    
+    const UndoRecord undo = m_undoStack.back();
+    m_undoStack.pop_back();
+    
+    Move move = undo.move;
+    int fromSquare = move.from();
+    int toSquare = move.to();
+    
+    popKeyHistory();
+    switchPlayer();
+    if (m_currentPlayer == PieceColor::Black) --m_fullmoveNumber;
+    
+    // 放回爆炸的地雷，並移除被炸毀的棋子記錄
+    if (undo.mineIndex >= 0) {
+        m_minePositions.insert(m_minePositions.begin() + undo.mineIndex, move.toPoint());
+        toggleMineKey(move.toPoint());
+        if (undo.movedPiece.getColor() == PieceColor::White) {
+            m_capturedWhite.pop_back();
+        } else {
+            m_capturedBlack.pop_back();
+        }
+    }
+    
+    // 將棋子移回起始格（使用移動前的棋子，可還原升變與 hasMoved 旗標）
+    removePiece(toSquare);
+    putPiece(fromSquare, undo.movedPiece);
+    
+    // 將易位的車移回原位
+    if (move.isCastling()) {
+        int row = Bitboards::rowOf(fromSquare);
+        bool kingSide = (move.flags() == Move::KingCastle);
+        int rookTo = Bitboards::squareIndex(row, kingSide ? 5 : 3);
+        ChessPiece rook = m_board[rookTo];
+        rook.setMoved(false);
+        removePiece(rookTo);
+        putPiece(Bitboards::squareIndex(row, kingSide ? 7 : 0), rook);
+    }
+    
+    // 放回被吃掉的棋子
+    if (undo.capturedPiece.getType() != PieceType::None) {
+        int capturedSquare = move.isEnPassant()
+            ? Bitboards::squareIndex(Bitboards::rowOf(fromSquare), Bitboards::colOf(toSquare))
+            : toSquare;
+        putPiece(capturedSquare, undo.capturedPiece);
+        if (undo.capturedPiece.getColor() == PieceColor::White) {
+            m_capturedWhite.pop_back();
+        } else {
+            m_capturedBlack.pop_back();
+        }
+    }
+    
+    m_enPassantTarget = (undo.enPassantSquare == Bitboards::NO_SQUARE)
+        ? QPoint(-1, -1)
+        : QPoint(Bitboards::colOf(undo.enPassantSquare), Bitboards::rowOf(undo.enPassantSquare));
+    m_halfmoveClock = undo.halfmoveClock;
+    m_castlingRights = undo.castlingRights;
+    m_gameResult = undo.gameResult;
+    m_lastMoveTriggeredMine = undo.lastMoveTriggeredMine;
+    refreshStateKey();
 }
 
 void ChessBoard::switchPlayer() {
     m_currentPlayer = (m_currentPlayer == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+    m_hash ^= Zobrist::KEYS.blackToMove;
 }
 
-bool ChessBoard::canPieceMove(const QPoint& pos) const {
-    const ChessPiece& piece = m_board[pos.y()][pos.x()];
-    if (piece.getType() == PieceType::None) return false;
+Bitboard ChessBoard::pseudoLegalTargets(int square) const {
+    // 棋子依移動規則可到達的格子（不含王車易位，尚未檢查是否讓己方國王被將軍）
+    const ChessPiece& piece = m_board[square];
+    PieceColor color = piece.getColor();
+    PieceColor opponentColor = (color == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+    Bitboard own = colorBitboard(color);
+    Bitboard enemyKing = pieceBitboard(PieceType::King, opponentColor);  // 國王不能被吃
+    
+    switch (piece.getType()) {
+        case PieceType::Pawn: {
+            Bitboard empty = ~m_occupied;
+            Bitboard fromMask = Bitboards::squareMask(square);
+            bool isWhite = (color == PieceColor::White);
+            Bitboard single = (isWhite ? Bitboards::shiftNorth(fromMask) : Bitboards::shiftSouth(fromMask)) & empty;
+            Bitboard targets = single;
+            
+            int startRow = isWhite ? 6 : 1;
+            if (single && !piece.hasMoved() && Bitboards::rowOf(square) == startRow) {
+                targets |= (isWhite ? Bitboards::shiftNorth(single) : Bitboards::shiftSouth(single)) & empty;
+            }
+            
+            Bitboard captureTargets = colorBitboard(opponentColor) & ~enemyKing;
+            int enPassantRow = isWhite ? 2 : 5;
+            if (m_enPassantTarget.x() >= 0 && m_enPassantTarget.y() == enPassantRow) {
+                captureTargets |= Bitboards::squareMask(Bitboards::squareIndex(m_enPassantTarget.y(), m_enPassantTarget.x()));
+            }
+            return targets | (Bitboards::pawnAttacks(square, color) & captureTargets);
+        }
+        case PieceType::Knight: return Bitboards::knightAttacks(square) & ~own & ~enemyKing;
+        case PieceType::Bishop: return Bitboards::bishopAttacks(square, m_occupied) & ~own & ~enemyKing;
+        case PieceType::Rook:   return Bitboards::rookAttacks(square, m_occupied) & ~own & ~enemyKing;
+        case PieceType::Queen:  return Bitboards::queenAttacks(square, m_occupied) & ~own & ~enemyKing;
+        case PieceType::King:   return Bitboards::kingAttacks(square) & ~own & ~enemyKing;
+        default: return Bitboards::EMPTY;
+    }
+}
+
+Bitboard ChessBoard::legalTargets(int square) const {
+    // 以將軍/釘住資訊過濾 pseudoLegalTargets（不含王車易位）
+    const ChessPiece& piece = m_board[square];
+    PieceColor color = piece.getColor();
+    if (color == PieceColor::None) return Bitboards::EMPTY;
     
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            QPoint to(col, row);
-            if (piece.isValidMove(pos, to, m_board, m_enPassantTarget)) {
-                if (!wouldBeInCheck(pos, to, piece.getColor())) {
-                    return true;
+    const CheckInfo& info = checkInfo(color);
+    if (info.kingSquare == Bitboards::NO_SQUARE) return Bitboards::EMPTY;  // 找不到國王時視為無合法走法
+    
+    PieceColor opponentColor = (color == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+    Bitboard targets = pseudoLegalTargets(square);
+    Bitboard fromMask = Bitboards::squareMask(square);
+    
+    // 國王：目標格不可被攻擊（移除國王本身，讓滑動棋子的攻擊穿過原位置）
+    if (piece.getType() == PieceType::King) {
+        Bitboard occupied = m_occupied & ~fromMask;
+        Bitboard legal = Bitboards::EMPTY;
+        while (targets) {
+            int to = Bitboards::popLsb(targets);
+            if (!attackersTo(to, opponentColor, occupied)) legal |= Bitboards::squareMask(to);
+        }
+        return legal;
+    }
+    
+    // 吃過路兵會同時移走兩個棋子，可能造成橫向的閃擊，維持以模擬判斷（少見）
+    Bitboard enPassant = Bitboards::EMPTY;
+    if (piece.getType() == PieceType::Pawn && m_enPassantTarget.x() >= 0) {
+        int target = Bitboards::squareIndex(m_enPassantTarget.y(), m_enPassantTarget.x());
+        enPassant = targets & Bitboards::squareMask(target) & ~m_occupied;
+        if (enPassant && wouldBeInCheck(QPoint(Bitboards::colOf(square), Bitboards::rowOf(square)),
+                                        m_enPassantTarget, color)) {
+            targets &= ~enPassant;
+            enPassant = Bitboards::EMPTY;
+        }
+    }
+    
+    Bitboard legal = targets & ~enPassant & info.evasionMask;
+    if (info.pinned & fromMask) {
+        legal &= Bitboards::line(info.kingSquare, square);  // 被釘住的棋子只能沿釘住的直線移動
+    }
+    return legal | enPassant;
+}
+
+void ChessBoard::generateLegalMoves(MoveList& moves, PieceColor color) const {
+    moves.clear();
+    if (color == PieceColor::None) color = m_currentPlayer;
+    
+    PieceColor opponentColor = (color == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+    Bitboard enemies = colorBitboard(opponentColor);
+    Bitboard pieces = colorBitboard(color);
+    quint8 colorRights = (color == PieceColor::White) ? (WhiteKingSide | WhiteQueenSide) : (BlackKingSide | BlackQueenSide);
+    
+    while (pieces) {
+        int from = Bitboards::popLsb(pieces);
+        QPoint fromPoint(Bitboards::colOf(from), Bitboards::rowOf(from));
+        const ChessPiece& piece = m_board[from];
+        bool isPawn = (piece.getType() == PieceType::Pawn);
+        
+        Bitboard targets = legalTargets(from);
+        while (targets) {
+            int to = Bitboards::popLsb(targets);
+            QPoint toPoint(Bitboards::colOf(to), Bitboards::rowOf(to));
+            
+            bool isCapture = (enemies & Bitboards::squareMask(to)) != 0;
+            int flags = isCapture ? Move::Capture : Move::Quiet;
+            
+            if (isPawn) {
+                int toRow = Bitboards::rowOf(to);
+                if (abs(toRow - fromPoint.y()) == 2) {
+                    flags = Move::DoublePawnPush;
+                } else if (!isCapture && toPoint.x() != fromPoint.x()) {
+                    flags = Move::EnPassant;
+                } else if (toRow == 0 || toRow == 7) {
+                    // 升變：每種升變類型各產生一步
+                    int promotionBase = isCapture ? Move::KnightPromotionCapture : Move::KnightPromotion;
+                    for (int promotion = 3; promotion >= 0; --promotion) {
+                        moves.add(Move(from, to, promotionBase + promotion));
+                    }
+                    continue;
+                }
+            }
+            
+            moves.add(Move(from, to, flags));
+        }
+        
+        // 王車易位（由 canCastle 驗證路徑與被攻擊的格子）
+        if (piece.getType() == PieceType::King && (m_castlingRights & colorRights)) {
+            for (int direction : { 2, -2 }) {
+                int toCol = fromPoint.x() + direction;
+                if (toCol < 0 || toCol >= 8) continue;
+                if (canCastle(fromPoint, QPoint(toCol, fromPoint.y()))) {
+                    int toSquare = Bitboards::squareIndex(fromPoint.y(), toCol);
+                    moves.add(Move(from, toSquare, direction > 0 ? Move::KingCastle : Move::QueenCastle));
                 }
             }
         }
     }
-    return false;
+}
+
+bool ChessBoard::canPieceMove(const QPoint& pos) const {
+    // 王車易位不需考慮：若可以易位，國王向同方向走一格也必定合法
+    return legalTargets(Bitboards::squareIndex(pos.y(), pos.x())) != Bitboards::EMPTY;
 }
 
 bool ChessBoard::hasAnyValidMoves(PieceColor color) const {
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            const ChessPiece& piece = m_board[row][col];
-            if (piece.getColor() == color && piece.getType() != PieceType::None) {
-                if (canPieceMove(QPoint(col, row))) {
-                    return true;
-                }
-            }
+    Bitboard pieces = colorBitboard(color);
+    while (pieces) {
+        int square = Bitboards::popLsb(pieces);
+        if (canPieceMove(QPoint(Bitboards::colOf(square), Bitboards::rowOf(square)))) {
+            return true;
         }
     }
     return false;
@@ -350,44 +959,43 @@ bool ChessBoard::isStalemate(PieceColor color) const {
 }
 
 bool ChessBoard::canCastle(const QPoint& from, const QPoint& to) const {
-    const ChessPiece& king = m_board[from.y()][from.x()];
+    const ChessPiece& king = getPiece(from.y(), from.x());
     
-    // 必須是未移動過的國王
-    if (king.getType() != PieceType::King || king.hasMoved()) return false;
+    if (king.getType() != PieceType::King) return false;
     
     // 必須正好水平移動 2 格
     if (abs(to.x() - from.x()) != 2 || to.y() != from.y()) return false;
     
+    // 必須保有該方向的易位權（易位權存在時，國王與車必定都在原位且未移動過）
+    bool white = (king.getColor() == PieceColor::White);
+    quint8 right = (to.x() > from.x()) ? (white ? WhiteKingSide : BlackKingSide)
+                                       : (white ? WhiteQueenSide : BlackQueenSide);
+    if (!(m_castlingRights & right)) return false;
+    
     // 國王不能處於被將軍狀態
     if (isInCheck(king.getColor())) return false;
     
     // 確定車的位置並檢查路徑
     int rookCol = (to.x() > from.x()) ? 7 : 0; // 王翼或后翼
-    const ChessPiece& rook = m_board[from.y()][rookCol];
-    
-    // 車必須存在且未移動過
-    if (rook.getType() != PieceType::Rook || rook.hasMoved()) return false;
     
     // 檢查國王和車之間的路徑是否暢通
     // 驗證國王當前位置和車之間的所有格子都是空的
     int direction = (to.x() > from.x()) ? 1 : -1;
     for (int col = from.x() + direction; col != rookCol; col += direction) {
-        if (m_board[from.y()][col].getType() != PieceType::None) return false;
+        if (m_occupied & Bitboards::squareMask(Bitboards::squareIndex(from.y(), col))) return false;
     }
     
-    // 檢查國王不會經過被將軍的格子
-    // 國王移動 2 格，所以檢查中間的格子
-    QPoint intermediate(from.x() + direction, from.y());
-    if (wouldBeInCheck(from, intermediate, king.getColor())) return false;
-    
-    // 檢查國王不會在目標位置被將軍
-    if (wouldBeInCheck(from, to, king.getColor())) return false;
+    // 檢查國王不會經過或停在被攻擊的格子（移除國王本身，讓滑動棋子的攻擊穿過原位置）
+    PieceColor opponentColor = (king.getColor() == PieceColor::White) ? PieceColor::Black : PieceColor::White;
+    Bitboard occupied = m_occupied & ~Bitboards::squareMask(Bitboards::squareIndex(from.y(), from.x()));
+    if (attackersTo(Bitboards::squareIndex(from.y(), from.x() + direction), opponentColor, occupied)) return false;
+    if (attackersTo(Bitboards::squareIndex(to.y(), to.x()), opponentColor, occupied)) return false;
     
     return true;
 }
 
 bool ChessBoard::needsPromotion(const QPoint& to) const {
-    const ChessPiece& piece = m_board[to.y()][to.x()];
+    const ChessPiece& piece = getPiece(to.y(), to.x());
     if (piece.getType() != PieceType::Pawn) return false;
     
     // 白兵到達第 0 行，黑兵到達第 7 行
@@ -398,68 +1006,60 @@ bool ChessBoard::needsPromotion(const QPoint& to) const {
 }
 
 void ChessBoard::promotePawn(const QPoint& pos, PieceType newType) {
-    ChessPiece& piece = m_board[pos.y()][pos.x()];
+    const ChessPiece& piece = getPiece(pos.y(), pos.x());
     if (piece.getType() != PieceType::Pawn) return;
     
     PieceColor color = piece.getColor();
-    m_board[pos.y()][pos.x()] = ChessPiece(newType, color);
-    m_board[pos.y()][pos.x()].setMoved(true);
+    ChessPiece promoted(newType, color);
+    promoted.setMoved(true);
+    int square = Bitboards::squareIndex(pos.y(), pos.x());
+    removePiece(square);
+    putPiece(square, promoted);
+    // 這一步的局面鍵已記錄的是升變前的兵，改為升變後的鍵，重複局面才能正確計數
+    refreshStateKey();
+    syncKeyHistory();
+    
+    // 將升變類型補記到最後一步的撤銷記錄（unmakeMove 會放回原本的兵）
+    if (!m_undoStack.empty() && m_undoStack.back().move.to() == square) {
+        Move& lastMove = m_undoStack.back().move;
+        lastMove = Move(lastMove.from(), lastMove.to(), Move::promotionFlags(newType, lastMove.isCapture()));
+    }
     
-    // 更新最後一個移動記錄以包含升變信息
-    if (!m_moveHistory.empty()) {
+    // 更新最後一個移動記錄以包含升變信息（升變後的棋子可能造成將軍，重新計算旗標）
+    if (!m_moveHistory.empty() && m_moveHistory.back().move.to() == square) {
         MoveRecord& lastMove = m_moveHistory.back();
-        lastMove.isPromotion = true;
-        lastMove.promotionType = newType;
-        lastMove.algebraicNotation = generateAlgebraicNotation(lastMove);
+        lastMove.move = Move(lastMove.move.from(), lastMove.move.to(),
+                             Move::promotionFlags(newType, lastMove.move.isCapture()));
+        lastMove.flags = (lastMove.flags & ~(MoveRecord::Check | MoveRecord::Checkmate)) | checkFlags(lastMove.pieceColor());
+        if (m_notationCache.size() >= m_moveHistory.size()) {
+            m_notationCache[m_moveHistory.size() - 1].clear();
+        }
     }
 }
 
 bool ChessBoard::isInsufficientMaterial() const {
-    // 計算棋盤上的棋子
-    int whiteKnights = 0, blackKnights = 0;
-    int whiteBishops = 0, blackBishops = 0;
-    int whiteBishopsOnEvenSquares = 0, whiteBishopsOnOddSquares = 0;
-    int blackBishopsOnEvenSquares = 0, blackBishopsOnOddSquares = 0;
-    bool hasWhiteKing = false, hasBlackKing = false;
-    bool hasOtherPieces = false;
-    
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            const ChessPiece& piece = m_board[row][col];
-            PieceType type = piece.getType();
-            PieceColor color = piece.getColor();
-            
-            if (type == PieceType::None) continue;
-            
-            if (type == PieceType::King) {
-                if (color == PieceColor::White) hasWhiteKing = true;
-                else hasBlackKing = true;
-            } else if (type == PieceType::Knight) {
-                if (color == PieceColor::White) whiteKnights++;
-                else blackKnights++;
-            } else if (type == PieceType::Bishop) {
-                bool isEvenSquare = (row + col) % 2 == 0;
-                if (color == PieceColor::White) {
-                    whiteBishops++;
-                    if (isEvenSquare) whiteBishopsOnEvenSquares++;
-                    else whiteBishopsOnOddSquares++;
-                } else {
-                    blackBishops++;
-                    if (isEvenSquare) blackBishopsOnEvenSquares++;
-                    else blackBishopsOnOddSquares++;
-                }
-            } else {
-                // 兵、車或后 - 材料足夠
-                hasOtherPieces = true;
-            }
-        }
-    }
-    
     // 安全檢查：雙方國王必須存在
-    if (!hasWhiteKing || !hasBlackKing) return false;
+    if (kingSquare(PieceColor::White) == Bitboards::NO_SQUARE ||
+        kingSquare(PieceColor::Black) == Bitboards::NO_SQUARE) {
+        return false;
+    }
     
     // 如果有兵、車或后，材料足夠
-    if (hasOtherPieces) return false;
+    Bitboard heavyOrPawns = Bitboards::EMPTY;
+    for (PieceColor color : { PieceColor::White, PieceColor::Black }) {
+        heavyOrPawns |= pieceBitboard(PieceType::Pawn, color)
+                      | pieceBitboard(PieceType::Rook, color)
+                      | pieceBitboard(PieceType::Queen, color);
+    }
+    if (heavyOrPawns) return false;
+    
+    // 計算棋盤上的輕子
+    Bitboard whiteBishopBoard = pieceBitboard(PieceType::Bishop, PieceColor::White);
+    Bitboard blackBishopBoard = pieceBitboard(PieceType::Bishop, PieceColor::Black);
+    int whiteKnights = Bitboards::popCount(pieceBitboard(PieceType::Knight, PieceColor::White));
+    int blackKnights = Bitboards::popCount(pieceBitboard(PieceType::Knight, PieceColor::Black));
+    int whiteBishops = Bitboards::popCount(whiteBishopBoard);
+    int blackBishops = Bitboards::popCount(blackBishopBoard);
     
     // 王對王
     if (whiteKnights == 0 && blackKnights == 0 && 
@@ -482,8 +1082,9 @@ bool ChessBoard::isInsufficientMaterial() const {
     // 王和象對王和象，且雙方象在同色格上
     if (whiteBishops == 1 && blackBishops == 1 && whiteKnights == 0 && blackKnights == 0) {
         // 兩個象必須在同色格上（都在偶數格或都在奇數格）
-        if ((whiteBishopsOnEvenSquares > 0 && blackBishopsOnEvenSquares > 0) ||
-            (whiteBishopsOnOddSquares > 0 && blackBishopsOnOddSquares > 0)) {
+        bool whiteOnEven = (whiteBishopBoard & Bitboards::EVEN_SQUARES) != 0;
+        bool blackOnEven = (blackBishopBoard & Bitboards::EVEN_SQUARES) != 0;
+        if (whiteOnEven == blackOnEven) {
             return true;
         }
     }
@@ -494,23 +1095,63 @@ bool ChessBoard::isInsufficientMaterial() const {
 // 棋譜記錄輔助函數實現
 void ChessBoard::clearMoveHistory() {
     m_moveHistory.clear();
+    m_notationCache.clear();
+    m_moveEvaluations.clear();
+}
+
+void ChessBoard::setMoveHistory(std::vector<MoveRecord> history, std::vector<MoveEvaluation> evaluations) {
+    m_moveHistory = std::move(history);
+    m_notationCache.clear();
+    m_moveEvaluations = std::move(evaluations);
+    if (m_moveEvaluations.size() > m_moveHistory.size()) {
+        m_moveEvaluations.resize(m_moveHistory.size());
+    }
+}
+
+std::vector<MoveRecord> ChessBoard::takeMoveHistory(std::vector<MoveEvaluation>* evaluations) {
+    std::vector<MoveRecord> history = std::move(m_moveHistory);
+    if (evaluations) {
+        *evaluations = std::move(m_moveEvaluations);
+    }
+    clearMoveHistory();
+    return history;
 }
 
-void ChessBoard::setMoveHistory(const std::vector<MoveRecord>& history) {
-    m_moveHistory = history;
+MoveEvaluation ChessBoard::getMoveEvaluation(int moveIndex) const {
+    if (moveIndex < 0 || moveIndex >= static_cast<int>(m_moveEvaluations.size())) {
+        return MoveEvaluation();
+    }
+    return m_moveEvaluations[moveIndex];
+}
+
+void ChessBoard::setMoveEvaluation(int moveIndex, const MoveEvaluation& evaluation) {
+    if (moveIndex < 0 || moveIndex >= static_cast<int>(m_moveHistory.size())) return;
+    if (m_moveEvaluations.size() <= static_cast<size_t>(moveIndex)) {
+        m_moveEvaluations.resize(moveIndex + 1);
+    }
+    m_moveEvaluations[moveIndex] = evaluation;
 }
 
 QString ChessBoard::getMoveNotation(int moveIndex) const {
     if (moveIndex < 0 || moveIndex >= static_cast<int>(m_moveHistory.size())) {
         return QString();
     }
-    return m_moveHistory[moveIndex].algebraicNotation;
+    // 記譜字串只由記錄本身決定，因此可延後產生並快取（每步只格式化一次）
+    if (m_notationCache.size() < m_moveHistory.size()) {
+        m_notationCache.resize(m_moveHistory.size());
+    }
+    QString& notation = m_notationCache[moveIndex];
+    if (notation.isEmpty()) {
+        notation = generateAlgebraicNotation(m_moveHistory[moveIndex]);
+    }
+    return notation;
 }
 
 QStringList ChessBoard::getAllMoveNotations() const {
     QStringList notations;
-    for (size_t i = 0; i < m_moveHistory.size(); ++i) {
-        notations.append(m_moveHistory[i].algebraicNotation);
+    notations.reserve(static_cast<int>(m_moveHistory.size()));
+    for (int i = 0; i < static_cast<int>(m_moveHistory.size()); ++i) {
+        notations.append(getMoveNotation(i));
     }
     return notations;
 }
@@ -536,133 +1177,98 @@ QString ChessBoard::squareToNotation(const QPoint& square) const {
     return QString("%1%2").arg(file).arg(rank);
 }
 
-bool ChessBoard::isAmbiguousMove(const QPoint& from, const QPoint& to) const {
-    // 檢查是否有多個同類型的棋子可以移動到同一目標
-    const ChessPiece& movingPiece = m_board[from.y()][from.x()];
+quint8 ChessBoard::disambiguationFlags(const QPoint& from, const QPoint& to) const {
+    // 檢查是否有其他同類型的己方棋子也能合法走到同一目標（在走棋前的局面判斷）
+    const ChessPiece& movingPiece = getPiece(from.y(), from.x());
     PieceType pieceType = movingPiece.getType();
-    PieceColor pieceColor = movingPiece.getColor();
     
-    // 兵、國王移動通常不會模糊
-    if (pieceType == PieceType::Pawn || pieceType == PieceType::King) {
-        return false;
+    // 兵、國王移動不會模糊
+    if (pieceType == PieceType::None || pieceType == PieceType::Pawn || pieceType == PieceType::King) {
+        return 0;
     }
     
-    // 檢查是否有其他相同類型和顏色的棋子可以移動到同一目標
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            QPoint otherPos(col, row);
-            if (otherPos == from) continue;
-            
-            const ChessPiece& piece = m_board[row][col];
-            if (piece.getType() == pieceType && piece.getColor() == pieceColor) {
-                // 檢查這個棋子是否也可以移動到目標
-                if (piece.isValidMove(otherPos, to, m_board, m_enPassantTarget) &&
-                    !wouldBeInCheck(otherPos, to, pieceColor)) {
-                    return true;
-                }
+    quint8 flags = 0;
+    Bitboard toMask = Bitboards::squareMask(Bitboards::squareIndex(to.y(), to.x()));
+    Bitboard others = pieceBitboard(pieceType, movingPiece.getColor()) & ~Bitboards::squareMask(Bitboards::squareIndex(from.y(), from.x()));
+    while (others) {
+        int square = Bitboards::popLsb(others);
+        if (legalTargets(square) & toMask) {
+            // 模糊時標註起始列；若在同一列，還需加上行號
+            flags |= MoveRecord::FileHint;
+            if (Bitboards::colOf(square) == from.x()) {
+                flags |= MoveRecord::RankHint;
             }
         }
     }
-    
-    return false;
+    return flags;
 }
 
-void ChessBoard::recordMove(const QPoint& from, const QPoint& to, bool isCapture, 
-                           bool isCastling, bool isEnPassant, bool isPromotion,
-                           PieceType promotionType) {
-    const ChessPiece& piece = m_board[to.y()][to.x()];
-    PieceColor opponentColor = (piece.getColor() == PieceColor::White) ? 
+quint8 ChessBoard::checkFlags(PieceColor moverColor) const {
+    PieceColor opponentColor = (moverColor == PieceColor::White) ? 
                                 PieceColor::Black : PieceColor::White;
-    
+    if (isCheckmate(opponentColor)) return MoveRecord::Check | MoveRecord::Checkmate;
+    if (isInCheck(opponentColor)) return MoveRecord::Check;
+    return 0;
+}
+
+void ChessBoard::recordMove(Move move, const ChessPiece& piece, quint8 disambiguation) {
     MoveRecord record;
-    record.from = from;
-    record.to = to;
-    record.pieceType = piece.getType();
-    record.pieceColor = piece.getColor();
-    record.isCapture = isCapture;
-    record.isCastling = isCastling;
-    record.isEnPassant = isEnPassant;
-    record.isPromotion = isPromotion;
-    record.promotionType = promotionType;
-    record.isCheck = isInCheck(opponentColor);
-    record.isCheckmate = isCheckmate(opponentColor);
-    record.algebraicNotation = generateAlgebraicNotation(record);
+    record.move = move;
+    record.piece = static_cast<quint8>(static_cast<int>(piece.getType()) |
+                                       (piece.getColor() == PieceColor::Black ? 0x8 : 0));
+    record.flags = disambiguation | checkFlags(piece.getColor());
     
     m_moveHistory.push_back(record);
 }
 
 QString ChessBoard::generateAlgebraicNotation(const MoveRecord& move) const {
     QString notation;
+    QPoint from = move.from();
+    QPoint to = move.to();
     
     // 王車易位的特殊記法
-    if (move.isCastling) {
+    if (move.isCastling()) {
         // 判斷是王翼還是后翼易位
-        if (move.to.x() > move.from.x()) {
+        if (to.x() > from.x()) {
             notation = "O-O";  // 王翼易位
         } else {
             notation = "O-O-O";  // 后翼易位
         }
     } else {
         // 棋子類型（兵不標註）
-        QString pieceNotation = pieceTypeToNotation(move.pieceType);
-        notation += pieceNotation;
+        notation += pieceTypeToNotation(move.pieceType());
         
-        // 處理消歧義
-        if (!pieceNotation.isEmpty() && isAmbiguousMove(move.from, move.to)) {
-            // 如果列不同，加上起始列
-            bool addFile = true;
-            bool addRank = false;
-            
-            // 檢查是否需要加上行
-            for (int row = 0; row < 8; ++row) {
-                for (int col = 0; col < 8; ++col) {
-                    QPoint otherPos(col, row);
-                    if (otherPos == move.from) continue;
-                    
-                    const ChessPiece& piece = m_board[row][col];
-                    if (piece.getType() == move.pieceType && piece.getColor() == move.pieceColor) {
-                        if (piece.isValidMove(otherPos, move.to, m_board, m_enPassantTarget) &&
-                            !wouldBeInCheck(otherPos, move.to, move.pieceColor)) {
-                            // 如果在同一列，需要加上行號
-                            if (col == move.from.x()) {
-                                addRank = true;
-                            }
-                        }
-                    }
-                }
-            }
-            
-            if (addFile) {
-                notation += QString(QChar('a' + move.from.x()));
-            }
-            if (addRank) {
-                notation += QString(QChar('8' - move.from.y()));
-            }
+        // 消歧義（走棋時已判定）
+        if (move.flags & MoveRecord::FileHint) {
+            notation += QChar('a' + from.x());
+        }
+        if (move.flags & MoveRecord::RankHint) {
+            notation += QChar('8' - from.y());
         }
         
         // 兵吃子需要標註起始列
-        if (move.pieceType == PieceType::Pawn && move.isCapture) {
-            notation += QString(QChar('a' + move.from.x()));
+        if (move.pieceType() == PieceType::Pawn && move.isCapture()) {
+            notation += QChar('a' + from.x());
         }
         
         // 吃子標記
-        if (move.isCapture) {
+        if (move.isCapture()) {
             notation += "x";
         }
         
         // 目標位置
-        notation += squareToNotation(move.to);
+        notation += squareToNotation(to);
         
         // 升變標記
-        if (move.isPromotion) {
-            notation += "=" + pieceTypeToNotation(move.promotionType);
+        if (move.isPromotion()) {
+            notation += "=" + pieceTypeToNotation(move.promotionType());
         }
     }
     
     // 將軍或將死標記
-    if (move.isCheckmate) {
+    if (move.isCheckmate()) {
         notation += "#";
-    } else if (move.isCheck) {
+    } else if (move.isCheck()) {
         notation += "+";
     }
     
@@ -707,7 +1313,7 @@ void ChessBoard::clearCapturedPieces() {
 void ChessBoard::enableBombMode(bool enable) {
     m_bombModeEnabled = enable;
     if (!enable) {
-        m_minePositions.clear();
+        setMinePositions(std::vector<QPoint>());
     }
     // 不再自動生成地雷位置
     // 線上模式: 必須透過 setMinePositions() 設定（從伺服器同步）
@@ -728,7 +1334,7 @@ bool ChessBoard::isMineAt(const QPoint& pos) const {
 }
 
 void ChessBoard::placeMines() {
-    m_minePositions = generateRandomMinePositions();
+    setMinePositions(generateRandomMinePositions());
 }
 
 std::vector<QPoint> ChessBoard::generateRandomMinePositions() {
@@ -762,5 +1368,9 @@ std::vector<QPoint> ChessBoard::generateRandomMinePositions() {
 }
 
 void ChessBoard::setMinePositions(const std::vector<QPoint>& positions) {
+    // 更新雜湊：移除舊地雷鍵、加入新地雷鍵
+    for (const QPoint& mine : m_minePositions) toggleMineKey(mine);
     m_minePositions = positions;
+    for (const QPoint& mine : m_minePositions) toggleMineKey(mine);
+    syncKeyHistory();
 }
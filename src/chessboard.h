@@ -2,10 +2,14 @@
 #define CHESSBOARD_H
 
 #include "chesspiece.h"
+#include "bitboard.h"
+#include "chessmove.h"
+#include "zobrist.h"
 #include <QPoint>
 #include <vector>
 #include <QString>
 #include <QStringList>
+#include <QStringView>
 
 enum class GameResult {
     InProgress,      // 遊戲進行中
@@ -18,19 +22,93 @@ enum class GameResult {
     BlackTimeout     // 黑方超時
 };
 
+// 王車易位權（位元旗標，可組合）
+enum CastlingRight : quint8 {
+    NoCastling     = 0,
+    WhiteKingSide  = 1,
+    WhiteQueenSide = 2,
+    BlackKingSide  = 4,
+    BlackQueenSide = 8
+};
+
+// 棋譜中的一步（4 位元組）：16 位元走法加上棋子與記譜旗標
+// 代數記譜字串不在此保存，由 ChessBoard::getMoveNotation() 依需要產生並快取
 struct MoveRecord {
-    QPoint from;
-    QPoint to;
-    PieceType pieceType;
-    PieceColor pieceColor;
-    bool isCapture;
-    bool isCastling;
-    bool isEnPassant;
-    bool isPromotion;
-    PieceType promotionType;
-    bool isCheck;
-    bool isCheckmate;
-    QString algebraicNotation;
+    enum NotationFlag : quint8 {
+        Check     = 1,   // 造成將軍
+        Checkmate = 2,   // 造成將死
+        FileHint  = 4,   // 消歧義：需標註起始直行
+        RankHint  = 8    // 消歧義：需標註起始橫列
+    };
+    
+    Move move;        // 起訖格、吃子、易位、吃過路兵與升變
+    quint8 piece;     // 移動的棋子：低 3 位元為 PieceType，0x8 表示黑方
+    quint8 flags;     // NotationFlag 組合
+    
+    QPoint from() const { return move.fromPoint(); }
+    QPoint to() const { return move.toPoint(); }
+    PieceType pieceType() const { return static_cast<PieceType>(piece & 0x7); }
+    PieceColor pieceColor() const {
+        if (pieceType() == PieceType::None) return PieceColor::None;
+        return (piece & 0x8) ? PieceColor::Black : PieceColor::White;
+    }
+    bool isCapture() const { return move.isCapture(); }
+    bool isCastling() const { return move.isCastling(); }
+    bool isEnPassant() const { return move.isEnPassant(); }
+    bool isPromotion() const { return move.isPromotion(); }
+    PieceType promotionType() const { return move.promotionType(); }
+    bool isCheck() const { return (flags & Check) != 0; }
+    bool isCheckmate() const { return (flags & Checkmate) != 0; }
+};
+static_assert(sizeof(MoveRecord) == 4, "MoveRecord should stay packed");
+
+// 賽後分析的結果（與棋譜同索引，另外保存使 MoveRecord 維持 4 位元組）
+// 分數以白方角度，單位與 SearchEngine 相同（將殺為 ±(MATE_SCORE - 層數)）
+struct MoveEvaluation {
+    enum Quality : quint8 {
+        Unclassified = 0,   // 前後局面尚未都分析完成
+        Good,
+        Inaccuracy,         // ?!
+        Mistake,            // ?
+        Blunder             // ??
+    };
+    
+    bool valid = false;     // 已分析走完這一步之後的局面
+    int score = 0;          // 走完這一步之後的局面分數
+    int depth = 0;
+    QString bestMove;       // 走這一步之前局面的最佳走法（UCI），空字串表示尚未分析
+    Quality quality = Unclassified;
+};
+
+// 將軍與釘住資訊（每個局面、每種顏色計算一次，棋盤改變前重複使用）
+struct CheckInfo {
+    int kingSquare;         // 國王所在格（沒有國王時為 NO_SQUARE）
+    Bitboard checkers;      // 正在將軍的對方棋子
+    Bitboard pinned;        // 被釘住的己方棋子（移動後會暴露國王）
+    Bitboard evasionMask;   // 非國王棋子可走的目標格：未被將軍時為全部，單將時為吃掉或阻擋將軍者，雙將時為空
+};
+
+// 單一顏色的棋子所在格清單（順序不固定，移除時以最後一項遞補，增刪皆為 O(1)）
+struct PieceList {
+    qint8 squares[64];
+    int count;
+    
+    const qint8* begin() const { return squares; }
+    const qint8* end() const { return squares + count; }
+    int size() const { return count; }
+};
+
+// 撤銷記錄：還原一步棋所需的全部狀態（固定大小，不含堆積配置）
+struct UndoRecord {
+    Move move;
+    ChessPiece movedPiece;      // 移動前的棋子（含 hasMoved，升變時為原本的兵）
+    ChessPiece capturedPiece;   // 被吃掉的棋子（吃過路兵時為被吃的兵）
+    qint8 enPassantSquare;      // 移動前的吃過路兵目標格（NO_SQUARE 表示無）
+    qint8 mineIndex;            // 被觸發地雷在 m_minePositions 中的索引（-1 表示未觸發）
+    bool lastMoveTriggeredMine; // 移動前的地雷觸發標誌
+    quint8 castlingRights;      // 移動前的王車易位權
+    int halfmoveClock;          // 移動前的半回合計數
+    GameResult gameResult;      // 移動前的遊戲結果
 };
 
 class ChessBoard {
@@ -38,15 +116,50 @@ public:
     ChessBoard();
     
     void initializeBoard();
-    const ChessPiece& getPiece(int row, int col) const;
-    ChessPiece& getPiece(int row, int col);
+    // 從 FEN 設定局面（棋子、行棋方、易位權、吃過路兵、半回合與回合數）
+    // 解析過程不配置記憶體；格式錯誤時回傳 false 且棋盤保持不變
+    bool setFromFEN(QStringView fen);
+    const ChessPiece& getPiece(int row, int col) const;  // 相容視圖（權威狀態為位元棋盤）
     void setPiece(int row, int col, const ChessPiece& piece);  // 安全地設置棋子
     
+    // 位元棋盤查詢
+    Bitboard pieceBitboard(PieceType type, PieceColor color) const;
+    Bitboard colorBitboard(PieceColor color) const;
+    Bitboard occupied() const { return m_occupied; }
+    Bitboard attackersTo(int square, PieceColor attackerColor, Bitboard occupied) const;
+    bool isSquareAttacked(int square, PieceColor attackerColor) const;
+    const CheckInfo& checkInfo(PieceColor color) const;  // 快取的將軍/釘住資訊
+    int kingSquare(PieceColor color) const;              // 快取的國王格（沒有國王時為 NO_SQUARE）
+    const PieceList& pieceList(PieceColor color) const;  // 該顏色所有棋子所在的格子
+    
     bool movePiece(const QPoint& from, const QPoint& to);
     bool isValidMove(const QPoint& from, const QPoint& to) const;
     
+    // 執行/撤銷走法（不驗證合法性、不記錄棋譜），供搜尋、合法性測試與回放導航使用
+    // makeMove 的走法須為目前局面的合法走法（例如來自 generateLegalMoves 或 createMove）
+    Move createMove(const QPoint& from, const QPoint& to, PieceType promotionType = PieceType::None) const;
+    void makeMove(Move move);
+    void unmakeMove();
+    int getUndoDepth() const { return static_cast<int>(m_undoStack.size()); }
+    int getHalfmoveClock() const { return m_halfmoveClock; }
+    int getFullmoveNumber() const { return m_fullmoveNumber; }
+    
+    // 和局規則：三次重複局面與五十步規則
+    int repetitionCount() const;  // 目前局面（含行棋方、易位權與吃過路兵）出現的次數
+    bool isThreefoldRepetition() const { return repetitionCount() >= 3; }
+    bool isFiftyMoveRule() const { return m_halfmoveClock >= 100; }
+    
+    // 一次產生所有合法走法（含王車易位、吃過路兵與升變），color 為 None 時使用當前玩家
+    void generateLegalMoves(MoveList& moves, PieceColor color = PieceColor::None) const;
+    
     PieceColor getCurrentPlayer() const { return m_currentPlayer; }
-    void setCurrentPlayer(PieceColor player) { m_currentPlayer = player; }
+    void setCurrentPlayer(PieceColor player);
+    
+    // 局面的 Zobrist 鍵（棋子、行棋方、王車易位權、吃過路兵與地雷格），隨每次棋盤修改增量更新
+    quint64 hash() const { return m_hash; }
+    quint64 computeHash() const;  // 從頭計算，用於驗證增量結果
+    quint8 castlingRights() const { return m_castlingRights; }  // CastlingRight 旗標組合
+    void setCastlingRights(quint8 rights);  // 只保留國王與車仍在原位的部分
     bool isInCheck(PieceColor color) const;
     bool isCheckmate(PieceColor color) const;
     bool isStalemate(PieceColor color) const;
@@ -54,6 +167,7 @@ public:
     
     QPoint findKing(PieceColor color) const;
     QPoint getEnPassantTarget() const { return m_enPassantTarget; }
+    void setEnPassantTarget(const QPoint& target);
     
     // 升變 - 如果需要兵升變則返回 true
     bool needsPromotion(const QPoint& to) const;
@@ -62,9 +176,14 @@ public:
     // 棋譜記錄
     const std::vector<MoveRecord>& getMoveHistory() const { return m_moveHistory; }
     void clearMoveHistory();
-    void setMoveHistory(const std::vector<MoveRecord>& history);
-    QString getMoveNotation(int moveIndex) const;
+    // 移出與放回棋譜（不複製）；evaluations 不為 nullptr 時一併移出賽後分析結果
+    void setMoveHistory(std::vector<MoveRecord> history, std::vector<MoveEvaluation> evaluations = {});
+    std::vector<MoveRecord> takeMoveHistory(std::vector<MoveEvaluation>* evaluations = nullptr);
+    QString getMoveNotation(int moveIndex) const;  // 第一次查詢時產生並快取
     QStringList getAllMoveNotations() const;
+    // 賽後分析結果：未分析的步回傳 valid 為 false 的預設值；清除棋譜時一併清除
+    MoveEvaluation getMoveEvaluation(int moveIndex) const;
+    void setMoveEvaluation(int moveIndex, const MoveEvaluation& evaluation);
     
     // 遊戲結果管理
     GameResult getGameResult() const { return m_gameResult; }
@@ -86,10 +205,15 @@ public:
     static std::vector<QPoint> generateRandomMinePositions();  // 生成隨機地雷位置（靜態工具方法）
     
 private:
-    std::vector<std::vector<ChessPiece>> m_board;
+    ChessPiece m_board[64];              // 每格的棋子（getPiece 的相容視圖，與位元棋盤同步）
+    Bitboard m_pieceBitboards[Bitboards::PIECE_KINDS];  // 12 個棋子位元棋盤（權威狀態）
+    Bitboard m_colorBitboards[2];        // 白方/黑方佔用遮罩
+    Bitboard m_occupied;                 // 所有棋子佔用遮罩
     PieceColor m_currentPlayer;
     QPoint m_enPassantTarget; // 可以進行吃過路兵的位置（如果沒有則為 -1, -1）
     std::vector<MoveRecord> m_moveHistory; // 棋步歷史記錄
+    mutable std::vector<QString> m_notationCache; // 代數記譜快取（與棋譜同索引，空字串表示尚未產生）
+    std::vector<MoveEvaluation> m_moveEvaluations; // 賽後分析結果（與棋譜同索引，可能比棋譜短）
     GameResult m_gameResult; // 遊戲結果
     std::vector<ChessPiece> m_capturedWhite; // 被吃掉的白色棋子
     std::vector<ChessPiece> m_capturedBlack; // 被吃掉的黑色棋子
@@ -98,22 +222,61 @@ private:
     bool m_bombModeEnabled; // 地雷模式是否啟用
     std::vector<QPoint> m_minePositions; // 地雷位置
     bool m_lastMoveTriggeredMine; // 上一步移動是否觸發了地雷
-
+    
+    // 撤銷堆疊（預先保留容量，make/unmake 過程中不會配置記憶體）
+    std::vector<UndoRecord> m_undoStack;
+    int m_halfmoveClock; // 自上次吃子或兵移動以來的半回合數
+    int m_fullmoveNumber; // 完整回合數（黑方走完後加一）
+    quint8 m_castlingRights; // 王車易位權（走棋時依起訖格清除，撤銷時還原）
+    
+    // 國王格與棋子清單（由 putPiece/removePiece 增量維護）
+    qint8 m_kingSquare[2];
+    PieceList m_pieceLists[2];
+    qint8 m_pieceListIndex[64];  // 每格棋子在其顏色清單中的位置
+    
+    // 將軍/釘住資訊快取（任何棋子變動時失效）
+    mutable CheckInfo m_checkInfo[2];
+    mutable bool m_checkInfoValid[2];
+    
+    // Zobrist 雜湊
+    quint64 m_hash;      // 目前局面的完整鍵
+    quint64 m_stateKey;  // m_hash 中王車易位權與吃過路兵部分（狀態改變時整段替換）
+    
+    // 局面鍵歷史（每一步後的鍵，索引 0 為起始局面）與依鍵分桶的出現次數
+    // 次數表讓多數局面以 O(1) 判定未重複，只有桶內次數達門檻時才回頭比對可逆走法範圍內的鍵
+    static constexpr int REPETITION_BUCKETS = 1024;
+    std::vector<quint64> m_keyHistory;
+    quint16 m_repetitionBuckets[REPETITION_BUCKETS];
+    
+    // 位元棋盤維護（所有棋盤修改都經由這兩個函數）
+    void putPiece(int square, const ChessPiece& piece);
+    void removePiece(int square);
+    void clearBoard();
+    quint8 placementCastlingRights() const;
+    void refreshStateKey();
+    quint64 stateKey() const;
+    void toggleMineKey(const QPoint& pos);
+    void pushKeyHistory();
+    void popKeyHistory();
+    void syncKeyHistory();
+    void resetKeyHistory();
     
     void switchPlayer();
+    Bitboard pseudoLegalTargets(int square) const;
+    Bitboard legalTargets(int square) const;
+    void computeCheckInfo(PieceColor color, CheckInfo& info) const;
     bool wouldBeInCheck(const QPoint& from, const QPoint& to, PieceColor color) const;
     bool hasAnyValidMoves(PieceColor color) const;
     bool canPieceMove(const QPoint& pos) const;
     bool canCastle(const QPoint& from, const QPoint& to) const;
     
     // 棋譜記錄輔助函數
-    void recordMove(const QPoint& from, const QPoint& to, bool isCapture, 
-                   bool isCastling, bool isEnPassant, bool isPromotion = false,
-                   PieceType promotionType = PieceType::None);
+    quint8 disambiguationFlags(const QPoint& from, const QPoint& to) const;  // 須在走棋前呼叫
+    void recordMove(Move move, const ChessPiece& piece, quint8 disambiguation);
+    quint8 checkFlags(PieceColor moverColor) const;
     QString generateAlgebraicNotation(const MoveRecord& move) const;
     QString pieceTypeToNotation(PieceType type) const;
     QString squareToNotation(const QPoint& square) const;
-    bool isAmbiguousMove(const QPoint& from, const QPoint& to) const;
 };
 
 #endif // CHESSBOARD_H
@@ -1,10 +1,15 @@
 #include "chessengine.h"
 #include "chessboard.h"
+#include "searchengine.h"
+#include "zobrist.h"
+#include "timemanager.h"
 #include <QDebug>
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
 
+const QString ChessEngine::BUILTIN_ENGINE = QStringLiteral("builtin");
+
 ChessEngine::ChessEngine(QObject *parent)
     : QObject(parent)
     , m_process(nullptr)
@@ -12,22 +17,62 @@ ChessEngine::ChessEngine(QObject *parent)
     , m_skillLevel(0)  // 預設初學者難度
     , m_thinkingTimeMs(50)  // 預設 50ms 思考時間
     , m_searchDepth(1)  // 預設搜尋深度 1
-    , m_isReady(false)
+    , m_threadCount(qMax(1, QThread::idealThreadCount()))
+    , m_multiPv(1)
+    , m_clockEnabled(false)
+    , m_clockTimeMs{ 0, 0 }
+    , m_clockIncrementMs{ 0, 0 }
+    , m_state(EngineState::NotRunning)
+    , m_bytesInFlight(0)
     , m_isThinking(false)
+    , m_isAnalyzing(false)
+    , m_ignoredBestMoves(0)
+    , m_ponderEnabled(false)
+    , m_isPondering(false)
+    , m_positionBoard(new ChessBoard)
+    , m_positionValid(true)
+    , m_requestKey(0)
+    , m_stopRequested(false)
+    , m_pendingHashSizeMb(0)
+    , m_useBuiltinEngine(false)
+    , m_searchThread(nullptr)
+    , m_searchId(0)
+    , m_analysisTimer(new QTimer(this))
+    , m_startTimer(new QTimer(this))
 {
+    m_analysisTimer->setSingleShot(true);
+    m_analysisTimer->setInterval(ANALYSIS_UPDATE_INTERVAL_MS);
+    connect(m_analysisTimer, &QTimer::timeout, this, &ChessEngine::flushAnalysis);
+    
+    m_startTimer->setSingleShot(true);
+    m_startTimer->setInterval(START_TIMEOUT_MS);
+    connect(m_startTimer, &QTimer::timeout, this, [this]() {
+        if (m_useBuiltinEngine || m_state == EngineState::Ready || m_state == EngineState::NotRunning) return;
+        stopEngine();
+        emit engineError("引擎沒有回應");
+    });
 }
 
 ChessEngine::~ChessEngine()
 {
     stopEngine();
+    // 已取消的搜尋仍在使用置換表，解構前等它們結束
+    for (QThread* thread : m_runningSearchThreads) {
+        thread->wait();
+        delete thread;
+    }
 }
 
 bool ChessEngine::startEngine(const QString& enginePath)
 {
-    if (m_process && m_process->state() != QProcess::NotRunning) {
+    if (m_process || m_useBuiltinEngine) {
         stopEngine();
     }
 
+    if (enginePath == BUILTIN_ENGINE) {
+        return startBuiltinEngine();
+    }
+
     // 檢查引擎檔案是否存在
     QFileInfo engineInfo(enginePath);
     if (!engineInfo.exists()) {
@@ -46,58 +91,104 @@ bool ChessEngine::startEngine(const QString& enginePath)
             this, &ChessEngine::onEngineFinished);
     connect(m_process, &QProcess::errorOccurred,
             this, &ChessEngine::onEngineError);
+    connect(m_process, &QProcess::started,
+            this, &ChessEngine::onEngineStarted);
+    connect(m_process, &QProcess::bytesWritten,
+            this, &ChessEngine::onBytesWritten);
 
+    // 不等待程序啟動：started 之後送出 uci，uciok 時設定選項，readyok 時才發出 engineReady；
+    // 啟動失敗由 errorOccurred 回報，握手逾時則由 m_startTimer 處理
+    setState(EngineState::Starting);
+    m_startTimer->start();
     m_process->start(enginePath, QStringList());
-    
-    if (!m_process->waitForStarted(5000)) {
-        emit engineError(QString("無法啟動引擎：%1").arg(m_process->errorString()));
-        delete m_process;
-        m_process = nullptr;
-        return false;
-    }
-
-    // 初始化 UCI 協議
-    sendCommand("uci");
+    sendCommand("uci");  // 放入緩衝區，程序啟動後送出
     
     return true;
 }
 
 void ChessEngine::stopEngine()
 {
+    m_isAnalyzing = false;
+    m_isPondering = false;
+    m_ponderBestMove.clear();
+    m_ponderResult.reset();
+    if (m_useBuiltinEngine) {
+        cancelBuiltinSearch();
+        m_useBuiltinEngine = false;
+    }
+
     if (m_process) {
-        if (m_isThinking) {
-            sendCommand("stop");
-            m_isThinking = false;
-        }
-        sendCommand("quit");
+        // 程序交給應用程式物件，在背景結束：送出 quit 後不等待，結束時自行刪除，
+        // 逾時仍未結束就強制終止。之後的輸出與錯誤都與此物件無關
+        QProcess* process = m_process;
+        m_process = nullptr;
+        process->disconnect(this);
+        process->setParent(QCoreApplication::instance());
         
-        if (!m_process->waitForFinished(3000)) {
-            m_process->kill();
-            m_process->waitForFinished(1000);
+        if (process->state() == QProcess::Running) {
+            if (m_isThinking) m_commandBuffer += "stop\n";
+            m_commandBuffer += "quit\n";
+            process->write(m_commandBuffer);
+            connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                    process, &QObject::deleteLater);
+            QTimer::singleShot(QUIT_TIMEOUT_MS, process, [process]() {
+                process->kill();
+            });
+        } else {
+            // 尚在啟動中（或已結束）的程序直接終止
+            process->kill();
+            process->deleteLater();
         }
-        
-        delete m_process;
-        m_process = nullptr;
     }
+    m_commandBuffer.clear();
+    m_bytesInFlight = 0;
+    m_startTimer->stop();
     
-    m_isReady = false;
+    setState(EngineState::NotRunning);
     m_isThinking = false;
+    m_ignoredBestMoves = 0;
+    
+    // 重新啟動的引擎從初始局面開始
+    m_positionBoard->initializeBoard();
+    m_positionValid = true;
+    m_positionMoves.clear();
+    m_startFen.clear();
+    m_currentPosition.clear();
 }
 
 bool ChessEngine::isEngineRunning() const
 {
-    return m_process && m_process->state() == QProcess::Running && m_isReady;
+    return m_state == EngineState::Ready;
+}
+
+bool ChessEngine::acceptsOptions() const
+{
+    // uciok 之前送出的 setoption 可能被引擎忽略；握手完成時 configureEngine() 會一併送出所有選項
+    return m_process && (m_state == EngineState::Configuring || m_state == EngineState::Ready);
+}
+
+void ChessEngine::setState(EngineState state)
+{
+    if (m_state == state) return;
+    m_state = state;
+    emit stateChanged(state);
 }
 
 void ChessEngine::setGameMode(GameMode mode)
 {
     m_gameMode = mode;
+    if (mode != GameMode::HumanVsComputer && mode != GameMode::ComputerVsHuman) {
+        stopPondering();
+    }
 }
 
 void ChessEngine::setDifficulty(int level)
 {
-    m_skillLevel = qBound(0, level, 20);
-    configureEngine();
+    m_skillLevel = qBound(0, level, MAX_SKILL_LEVEL);
+    // 對局中切換難度只送出技能等級，不重送 Hash（引擎會重新配置並清空雜湊表）
+    if (acceptsOptions()) {
+        sendCommand(QString("setoption name Skill Level value %1").arg(m_skillLevel));
+    }
 }
 
 void ChessEngine::setThinkingTime(int milliseconds)
@@ -110,60 +201,700 @@ void ChessEngine::setSearchDepth(int depth)
     m_searchDepth = qBound(1, depth, 30);
 }
 
+void ChessEngine::setClock(int whiteTimeMs, int blackTimeMs, int whiteIncrementMs, int blackIncrementMs)
+{
+    m_clockEnabled = true;
+    m_clockTimeMs[0] = qMax(0, whiteTimeMs);
+    m_clockTimeMs[1] = qMax(0, blackTimeMs);
+    m_clockIncrementMs[0] = qMax(0, whiteIncrementMs);
+    m_clockIncrementMs[1] = qMax(0, blackIncrementMs);
+    m_clockTimer.start();
+}
+
+void ChessEngine::clearClock()
+{
+    m_clockEnabled = false;
+}
+
+void ChessEngine::setHashSize(int megabytes)
+{
+    megabytes = qBound(1, megabytes, TranspositionTable::MAX_SIZE_MB);
+    // 內建引擎搜尋中不可釋放置換表，也不在 GUI 執行緒等待搜尋結束：記下大小，搜尋執行緒結束後才重新配置
+    m_pendingHashSizeMb = megabytes != m_transpositionTable.sizeMb() ? megabytes : 0;
+    applyPendingHashSize();
+    
+    if (acceptsOptions()) {
+        sendCommand(QString("setoption name Hash value %1").arg(megabytes));
+    }
+}
+
+void ChessEngine::setThreadCount(int threads)
+{
+    // 0 或負數表示自動：使用可同時執行的硬體執行緒數
+    m_threadCount = threads > 0 ? qMin(threads, MAX_THREADS) : qMax(1, QThread::idealThreadCount());
+    
+    // 內建引擎在下一次 requestMove() 時套用；外部引擎立即設定
+    if (acceptsOptions()) {
+        sendCommand(QString("setoption name Threads value %1").arg(m_threadCount));
+    }
+}
+
 void ChessEngine::newGame()
 {
     if (!isEngineRunning()) return;
     
-    sendCommand("ucinewgame");
+    stopAnalysis();
+    stopPondering();
+    
+    // 舊棋局的項目在置換表中降為舊世代，優先被新棋局取代
+    m_transpositionTable.newGeneration();
+    m_positionBoard->initializeBoard();
+    m_positionValid = true;
+    m_positionMoves.clear();
+    m_startFen.clear();
     m_currentPosition.clear();
     m_bestMove.clear();
+    clearAnalysis();
+    
+    if (m_useBuiltinEngine) {
+        cancelBuiltinSearch();
+        return;
+    }
+    
+    ++m_searchId;  // 丟棄尚未送出的快取回應
+    sendCommand("ucinewgame");
 }
 
 void ChessEngine::setPosition(const QString& fen)
 {
     if (!isEngineRunning()) return;
     
+    if (m_isAnalyzing && fen == m_currentPosition) return;
+    
+    stopPondering();
     m_currentPosition = fen;
+    m_positionMoves.clear();
+    m_startFen.clear();
+    m_positionValid = m_positionBoard->setFromFEN(fen);
+    if (m_useBuiltinEngine) {
+        if (!m_positionValid) {
+            emit engineError(QString("無效的 FEN：%1").arg(fen));
+        } else if (m_isAnalyzing) {
+            restartAnalysis();
+        }
+        return;
+    }
+    if (m_isAnalyzing) abandonExternalSearch();
     sendCommand(QString("position fen %1").arg(fen));
+    if (m_isAnalyzing) restartAnalysis();
 }
 
-void ChessEngine::setPositionFromMoves(const QStringList& moves)
+void ChessEngine::setPositionFromMoves(const QStringList& moves, const QString& startFen)
 {
     if (!isEngineRunning()) return;
     
-    if (moves.isEmpty()) {
-        sendCommand("position startpos");
-    } else {
-        sendCommand(QString("position startpos moves %1").arg(moves.join(" ")));
+    // 增量更新：與上一次的走法共同的前綴保留在棋盤上，只撤銷與執行不同的部分
+    // （一般對局每步只需執行一步，回放時前後瀏覽也只需撤銷或重做幾步）
+    const bool sameStart = m_currentPosition.isEmpty() && startFen == m_startFen;
+    int common = 0;
+    if (sameStart && m_positionValid) {
+        const int limit = qMin(moves.size(), m_positionMoves.size());
+        while (common < limit && moves[common] == m_positionMoves[common]) ++common;
+        if (m_isAnalyzing && common == moves.size() && common == m_positionMoves.size()) {
+            return;  // 局面沒有改變，分析繼續進行
+        }
+        for (int i = m_positionMoves.size(); i > common; --i) {
+            m_positionBoard->unmakeMove();
+        }
+    } else if (startFen.isEmpty()) {
+        m_positionBoard->initializeBoard();
+    } else if (!m_positionBoard->setFromFEN(startFen)) {
+        m_positionBoard->initializeBoard();
+        m_currentPosition.clear();
+        m_positionMoves.clear();
+        m_startFen.clear();
+        m_positionValid = false;
+        emit engineError(QString("無效的 FEN：%1").arg(startFen));
+        return;
+    }
+    m_currentPosition.clear();
+    m_positionMoves = moves;
+    m_startFen = startFen;
+    
+    // 遇到不合法的走法（例如特殊模式改動過棋盤）時停在該處，此時局面與外部引擎看到的不同，
+    // 不使用走法快取，下一次也改為從起始局面重播
+    m_positionValid = true;
+    for (int i = common; i < moves.size(); ++i) {
+        Move move = parseBoardMove(moves[i]);
+        if (move.isNull()) {
+            qWarning() << "Chess engine: ignoring illegal move" << moves[i];
+            m_positionValid = false;
+            break;
+        }
+        m_positionBoard->makeMove(move);
+    }
+    
+    // 玩家走了預期的走法時預測思考繼續進行，由 requestMove() 送出 ponderhit；否則立即停止
+    if (m_isPondering) {
+        if (sameStart && moves == m_ponderMoves) return;
+        stopPondering();
+    }
+    
+    if (m_useBuiltinEngine) {
+        if (m_isAnalyzing) restartAnalysis();
+        return;
     }
+    
+    // UCI 沒有增量的 position 指令；分析中只停止搜尋並送出新局面，引擎的雜湊表保留，
+    // 重新搜尋時很快就能回到原本的深度
+    if (m_isAnalyzing) abandonExternalSearch();
+    sendCommand(positionCommand(moves));
+    if (m_isAnalyzing) restartAnalysis();
 }
 
 void ChessEngine::requestMove()
 {
     if (!isEngineRunning()) return;
     
+    stopAnalysis();
+    if (m_isPondering) {
+        if (m_currentPosition.isEmpty() && m_positionMoves == m_ponderMoves) {
+            ponderHit();
+            return;
+        }
+        stopPondering();
+    }
+    if (m_useBuiltinEngine) {
+        cancelBuiltinSearch();
+    }
+    
+    m_isThinking = true;
+    m_stopRequested = false;
+    m_bestMove.clear();
+    clearAnalysis();
+    emit thinkingStarted();
+    
+    // 相同局面與難度設定已計算過時直接回報快取的走法（例如在棋局中來回瀏覽），不再詢問引擎
+    m_requestKey = bestMoveCacheKey();
+    TranspositionTable::Entry cached;
+    if (m_requestKey != 0 && m_transpositionTable.probe(m_requestKey, cached, true)
+        && m_positionBoard->isValidMove(cached.move.fromPoint(), cached.move.toPoint())) {
+        const int requestId = m_searchId;
+        const QString move = moveToUCI(cached.move.fromPoint(), cached.move.toPoint(), cached.move.promotionType());
+        QTimer::singleShot(0, this, [this, requestId, move, cached]() {
+            if (requestId != m_searchId || !m_isThinking) return;
+            // 快取的分數與深度同樣經由 analysisUpdated 回報，使用分數的介面不需區分是否命中快取
+            UciInfo info;
+            info.depth = qMax(1, cached.depth);
+            info.setSearchScore(cached.score);
+            info.source = move;
+            info.pvOffset = 0;
+            recordAnalysis(info);
+            flushAnalysis();
+            m_bestMove = move;
+            m_isThinking = false;
+            emit thinkingStopped();
+            emit bestMoveFound(m_bestMove);
+        });
+        return;
+    }
+    
+    if (m_useBuiltinEngine) {
+        // 與外部引擎相同的限制：思考時間（或棋鐘）、搜尋深度與技能等級
+        startBuiltinSearch(builtinLimits(*m_positionBoard, false), *m_positionBoard);
+        return;
+    }
+    
+    sendCommand(goCommand(m_positionBoard->getCurrentPlayer(), false));
+}
+
+void ChessEngine::setMultiPv(int lines)
+{
+    lines = qBound(1, lines, MAX_ANALYSIS_LINES);
+    if (lines == m_multiPv) return;
+    m_multiPv = lines;
+    
+    // 分析中改變變例數時以新的設定重新搜尋目前局面
+    if (!m_isAnalyzing) return;
+    if (!m_useBuiltinEngine) {
+        abandonExternalSearch();
+        sendCommand(QString("setoption name MultiPV value %1").arg(m_multiPv));
+    }
+    restartAnalysis();
+}
+
+void ChessEngine::startAnalysis()
+{
+    // 電腦正在思考走法時不開始分析，走完後由呼叫端再次要求
+    if (!isEngineRunning() || m_isAnalyzing || m_isThinking) return;
+    
+    stopPondering();
+    m_isAnalyzing = true;
+    if (!m_useBuiltinEngine) {
+        sendCommand(QString("setoption name MultiPV value %1").arg(m_multiPv));
+    }
+    restartAnalysis();
+}
+
+void ChessEngine::stopAnalysis()
+{
+    if (!m_isAnalyzing) return;
+    m_isAnalyzing = false;
+    
+    // 分析結果保留在 analysisUpdated 最後發出的內容，不另外清除
+    if (m_useBuiltinEngine) {
+        cancelBuiltinSearch();
+        return;
+    }
+    abandonExternalSearch();
+    // 對局中只需要一條變例，MultiPV 大於 1 會拖慢搜尋
+    sendCommand("setoption name MultiPV value 1");
+}
+
+void ChessEngine::restartAnalysis()
+{
+    clearAnalysis();
+    
+    if (m_useBuiltinEngine) {
+        // 內建引擎以不限時間的最大深度搜尋，直到局面改變或 stopAnalysis()
+        cancelBuiltinSearch();
+        SearchLimits limits;
+        limits.maxDepth = SearchEngine::MAX_PLY - 1;
+        limits.multiPv = m_multiPv;
+        startBuiltinSearch(limits, *m_positionBoard);
+        return;
+    }
+    sendCommand("go infinite");
+}
+
+void ChessEngine::abandonExternalSearch()
+{
+    // stop 之後引擎仍會送出舊搜尋剩餘的 info 與一個 bestmove，全部丟棄
+    sendCommand("stop");
+    ++m_ignoredBestMoves;
+}
+
+void ChessEngine::setPonderEnabled(bool enabled)
+{
+    if (enabled == m_ponderEnabled) return;
+    m_ponderEnabled = enabled;
+    if (!enabled) stopPondering();
+    if (acceptsOptions()) {
+        sendCommand(QString("setoption name Ponder value %1").arg(enabled ? "true" : "false"));
+    }
+}
+
+void ChessEngine::startPondering(const QString& ponderMove)
+{
+    // 只在人機對弈中、沒有其他搜尋時預測思考；局面須以起始局面加走法列表設定
+    if (!m_ponderEnabled || ponderMove.isEmpty() || m_isPondering || m_isThinking || m_isAnalyzing) return;
+    if (m_gameMode != GameMode::HumanVsComputer && m_gameMode != GameMode::ComputerVsHuman) return;
+    if (!m_currentPosition.isEmpty() || !m_positionValid) return;
+    
+    // 電腦的走法與預期的回應都必須是合法走法（棋局結束時沒有回應）
+    ChessBoard board(*m_positionBoard);
+    for (const QString& uci : { m_bestMove, ponderMove }) {
+        const Move move = uciToBoardMove(board, uci);
+        if (move.isNull()) return;
+        board.makeMove(move);
+    }
+    
+    m_isPondering = true;
+    m_ponderMoves = m_positionMoves;
+    m_ponderMoves << m_bestMove << ponderMove;
+    m_ponderBestMove.clear();
+    m_ponderResult.reset();
+    // 上一次搜尋的變例屬於另一方，不可與預測思考的結果混在一起
+    m_analysisTimer->stop();
+    m_analysisLines.clear();
+    
+    if (m_useBuiltinEngine) {
+        startBuiltinSearch(builtinLimits(board, true), board, true);
+        return;
+    }
+    sendCommand(positionCommand(m_ponderMoves));
+    sendCommand(goCommand(board.getCurrentPlayer(), true));
+}
+
+void ChessEngine::stopPondering()
+{
+    if (!m_isPondering) return;
+    m_isPondering = false;
+    m_analysisTimer->stop();
+    m_analysisLines.clear();
+    m_ponderResult.reset();
+    
+    if (m_useBuiltinEngine) {
+        cancelBuiltinSearch();
+    } else if (m_ponderBestMove.isEmpty()) {
+        abandonExternalSearch();
+    }
+    m_ponderBestMove.clear();
+    
+    // 外部引擎停在預測的局面，下一次搜尋前重新送出目前局面
+    if (!m_useBuiltinEngine) {
+        if (!m_currentPosition.isEmpty()) {
+            sendCommand(QString("position fen %1").arg(m_currentPosition));
+        } else {
+            sendCommand(positionCommand(m_positionMoves));
+        }
+    }
+}
+
+void ChessEngine::ponderHit()
+{
+    // 預測命中：同一個搜尋繼續進行，已預測思考的時間計入思考時間
+    m_isPondering = false;
     m_isThinking = true;
+    m_stopRequested = false;
     m_bestMove.clear();
+    m_requestKey = bestMoveCacheKey();
     emit thinkingStarted();
+    flushAnalysis();
     
-    // 使用 movetime 和 depth 限制思考
-    sendCommand(QString("go movetime %1 depth %2").arg(m_thinkingTimeMs).arg(m_searchDepth));
+    if (m_useBuiltinEngine) {
+        if (m_ponderResult) {
+            // 預測思考已先結束，在事件迴圈中回報保留的結果（與一般搜尋相同，requestMove() 返回後才發出信號）
+            const SearchResult result = *m_ponderResult;
+            m_ponderResult.reset();
+            const int searchId = m_searchId;
+            QTimer::singleShot(0, this, [this, searchId, result]() {
+                onBuiltinSearchFinished(searchId, result);
+            });
+        } else {
+            m_searchEngine->setPondering(false);
+        }
+        return;
+    }
+    
+    sendCommand("ponderhit");
+    if (!m_ponderBestMove.isEmpty()) {
+        const QString line = m_ponderBestMove;
+        m_ponderBestMove.clear();
+        QTimer::singleShot(0, this, [this, line]() {
+            if (m_isThinking) parseOutput(line);
+        });
+    }
 }
 
 void ChessEngine::stop()
 {
+    stopPondering();
+    // 內建引擎停止後仍會回報目前為止的最佳走法，與 UCI 的 stop 行為一致
+    if (m_isThinking) {
+        m_stopRequested = true;
+    }
+    if (m_isThinking && m_useBuiltinEngine) {
+        m_searchEngine->stop();
+        return;
+    }
     if (m_isThinking && m_process) {
         sendCommand("stop");
     }
 }
 
-void ChessEngine::sendCommand(const QString& command)
+QString ChessEngine::positionCommand(const QStringList& moves) const
+{
+    QString command = m_startFen.isEmpty() ? QString("position startpos")
+                                           : QString("position fen %1").arg(m_startFen);
+    if (!moves.isEmpty()) {
+        command += QString(" moves %1").arg(moves.join(" "));
+    }
+    return command;
+}
+
+int ChessEngine::clockTime(int side, bool ponder) const
+{
+    const int timeMs = m_clockTimeMs[side];
+    if (!ponder || timeMs == 0) return timeMs;
+    // 預測思考的局面輪到電腦：電腦這一步用掉的時間已從棋鐘扣除，並已加上加秒
+    const qint64 remaining = timeMs - m_clockTimer.elapsed();
+    return static_cast<int>(qMax<qint64>(1, remaining)) + m_clockIncrementMs[side];
+}
+
+QString ChessEngine::goCommand(PieceColor sideToMove, bool ponder) const
+{
+    QString command = ponder ? "go ponder" : "go";
+    const int side = sideToMove == PieceColor::White ? 0 : 1;
+    if (m_clockEnabled && m_clockTimeMs[side] > 0) {
+        // 不限時的一方不送出，引擎只依行棋方的時間分配
+        const int whiteTime = m_clockTimeMs[0] > 0 ? clockTime(0, ponder && side == 0) : 0;
+        const int blackTime = m_clockTimeMs[1] > 0 ? clockTime(1, ponder && side == 1) : 0;
+        if (whiteTime > 0) command += QString(" wtime %1").arg(whiteTime);
+        if (blackTime > 0) command += QString(" btime %1").arg(blackTime);
+        if (whiteTime > 0) command += QString(" winc %1").arg(m_clockIncrementMs[0]);
+        if (blackTime > 0) command += QString(" binc %1").arg(m_clockIncrementMs[1]);
+    } else {
+        command += QString(" movetime %1").arg(m_thinkingTimeMs);
+    }
+    // 深度限制保留難度的差異
+    return command + QString(" depth %1").arg(m_searchDepth);
+}
+
+SearchLimits ChessEngine::builtinLimits(const ChessBoard& board, bool ponder) const
+{
+    SearchLimits limits;
+    limits.maxDepth = m_searchDepth;
+    limits.timeMs = m_thinkingTimeMs;
+    limits.skillLevel = m_skillLevel;
+    
+    const int side = board.getCurrentPlayer() == PieceColor::White ? 0 : 1;
+    if (m_clockEnabled && m_clockTimeMs[side] > 0) {
+        const TimeBudget budget = TimeManager::allocate(clockTime(side, ponder), m_clockIncrementMs[side],
+                                                        board.getFullmoveNumber());
+        limits.timeMs = budget.maximumMs;
+        limits.optimumTimeMs = budget.optimumMs;
+    }
+    return limits;
+}
+
+quint64 ChessEngine::bestMoveCacheKey() const
+{
+    if (!m_positionValid) return 0;
+    // 降低棋力時每次搜尋加入的隨機性不可被快取固定；半回合計數不為零時，
+    // 局面鍵不含的重複局面與五十步規則可能改變最佳走法，同樣不快取
+    if (m_skillLevel < MAX_SKILL_LEVEL || m_positionBoard->getHalfmoveClock() != 0) return 0;
+    // 有棋鐘時思考時間依剩餘時間分配，以固定思考時間得到的走法（或反過來）不可重播
+    if (m_clockEnabled) return 0;
+    
+    // 局面鍵混入難度設定，不同難度的結果分開快取，也不會與搜尋本身的置換表項目衝突
+    quint64 settings = (static_cast<quint64>(m_skillLevel) << 48)
+                     ^ (static_cast<quint64>(m_searchDepth) << 32)
+                     ^ static_cast<quint64>(m_thinkingTimeMs);
+    return m_positionBoard->hash() ^ Zobrist::splitMix64(settings);
+}
+
+Move ChessEngine::parseBoardMove(const QString& uci) const
+{
+    return uciToBoardMove(*m_positionBoard, uci);
+}
+
+Move ChessEngine::uciToBoardMove(const ChessBoard& board, const QString& uci)
+{
+    QPoint from, to;
+    PieceType promotionType;
+    uciToMove(uci, from, to, promotionType);
+    if (!board.isValidMove(from, to)) return Move();
+    
+    const ChessPiece& piece = board.getPiece(from.y(), from.x());
+    if (piece.getType() == PieceType::Pawn && (to.y() == 0 || to.y() == 7)
+        && promotionType == PieceType::None) {
+        promotionType = PieceType::Queen;
+    }
+    return board.createMove(from, to, promotionType);
+}
+
+void ChessEngine::cacheBestMove(const QString& uci, int score, int depth)
+{
+    if (m_requestKey == 0 || m_stopRequested) return;
+    
+    Move move = parseBoardMove(uci);
+    if (move.isNull()) return;
+    // 快取項目只提供走法，BoundNone 使搜尋不會把分數用於剪枝
+    m_transpositionTable.store(m_requestKey, move, score, TranspositionTable::NO_EVAL, depth,
+                               TranspositionTable::BoundNone);
+}
+
+void ChessEngine::applyPendingHashSize()
+{
+    if (m_pendingHashSizeMb == 0 || !m_runningSearchThreads.isEmpty()) return;
+    m_transpositionTable.resize(m_pendingHashSizeMb);
+    m_pendingHashSizeMb = 0;
+}
+
+bool ChessEngine::startBuiltinEngine()
+{
+    m_enginePath = BUILTIN_ENGINE;
+    m_useBuiltinEngine = true;
+    if (!m_searchEngine) {
+        m_searchEngine = std::make_shared<SearchEngine>();
+        m_searchEngine->setTranspositionTable(&m_transpositionTable);
+    }
+    
+    // 不需要 UCI 握手，但與外部引擎一樣在事件迴圈中才發出 engineReady
+    setState(EngineState::Ready);
+    QTimer::singleShot(0, this, [this]() {
+        if (m_useBuiltinEngine && m_state == EngineState::Ready) emit engineReady();
+    });
+    return true;
+}
+
+void ChessEngine::startBuiltinSearch(const SearchLimits& limits, const ChessBoard& board, bool ponder)
+{
+    // 工作執行緒搜尋局面的副本，結果經由佇列呼叫回到 GUI 執行緒；執行緒持有引擎，取消後仍可安全收尾
+    const int searchId = m_searchId;
+    std::shared_ptr<SearchEngine> engine = m_searchEngine;
+    engine->clearStop();
+    engine->setPondering(ponder);
+    engine->setThreadCount(m_threadCount);
+    m_searchThread = QThread::create([this, engine, board, limits, searchId]() mutable {
+        SearchResult result = engine->search(board, limits, [this, searchId](const SearchResult& iteration) {
+            QMetaObject::invokeMethod(this, [this, searchId, iteration]() {
+                if (searchId != m_searchId) return;
+                recordBuiltinAnalysis(iteration);
+            }, Qt::QueuedConnection);
+        });
+        QMetaObject::invokeMethod(this, [this, searchId, result]() {
+            onBuiltinSearchFinished(searchId, result);
+        }, Qt::QueuedConnection);
+    });
+    QThread* thread = m_searchThread;
+    m_runningSearchThreads.append(thread);
+    connect(thread, &QThread::finished, this, [this, thread]() {
+        m_runningSearchThreads.removeOne(thread);
+        if (m_searchThread == thread) m_searchThread = nullptr;
+        thread->deleteLater();
+        applyPendingHashSize();
+    });
+    thread->start();
+}
+
+void ChessEngine::cancelBuiltinSearch()
+{
+    // 遞增編號後，已排入事件佇列的舊結果會被 onBuiltinSearchFinished 丟棄
+    ++m_searchId;
+    if (m_searchThread) {
+        // 不在 GUI 執行緒等待：舊的搜尋收到停止要求後在背景收尾，執行緒結束時自行刪除。
+        // 它仍使用原本的 SearchEngine，之後的搜尋改用新的引擎
+        m_searchEngine->stop();
+        m_searchThread = nullptr;
+        m_searchEngine = std::make_shared<SearchEngine>();
+        m_searchEngine->setTranspositionTable(&m_transpositionTable);
+    }
+    if (m_isThinking) {
+        m_isThinking = false;
+        emit thinkingStopped();
+    }
+}
+
+void ChessEngine::onBuiltinSearchFinished(int searchId, const SearchResult& result)
+{
+    if (searchId != m_searchId) return;
+    
+    // search() 已返回，引擎可以立即開始下一次搜尋；執行緒本身在 finished 時刪除
+    m_searchThread = nullptr;
+    
+    // 預測思考在 ponderhit 之前就達到深度限制（或找到將殺）時保留結果，等待玩家走棋
+    if (m_isPondering) {
+        m_ponderResult.reset(new SearchResult(result));
+        return;
+    }
+    
+    flushAnalysis();
+    // 分析搜尋達到最大深度或找到將殺時自然結束，結果保留在分析面板，不回報走法
+    if (m_isAnalyzing) return;
+    
+    m_isThinking = false;
+    emit thinkingStopped();
+    
+    // 沒有合法走法（棋局已結束）時不回報
+    if (result.bestMove.isNull()) return;
+    
+    m_bestMove = moveToUCI(result.bestMove.fromPoint(), result.bestMove.toPoint(),
+                           result.bestMove.promotionType());
+    cacheBestMove(m_bestMove, result.score, result.depth);
+    emit bestMoveFound(m_bestMove);
+    
+    // 降低棋力時選出的走法可能不是主要變例的第一步，此時主要變例的第二步不是它的回應
+    if (result.pv.size() >= 2 && result.pv[0] == result.bestMove) {
+        startPondering(moveToUCI(result.pv[1].fromPoint(), result.pv[1].toPoint(), result.pv[1].promotionType()));
+    }
+}
+
+void ChessEngine::recordBuiltinAnalysis(const SearchResult& iteration)
+{
+    // 轉成與 UCI info 相同的格式，分析面板不需區分引擎
+    UciInfo info;
+    info.depth = iteration.depth;
+    info.selDepth = iteration.selDepth;
+    info.nodes = iteration.nodes;
+    info.nodesPerSecond = iteration.nodesPerSecond();
+    info.timeMs = iteration.elapsedMs;
+    info.hashfull = m_transpositionTable.hashfull();
+    
+    auto setLine = [&info](int score, const std::vector<Move>& pv) {
+        info.setSearchScore(score);
+        QStringList moves;
+        for (const Move& move : pv) {
+            moves.append(moveToUCI(move.fromPoint(), move.toPoint(), move.promotionType()));
+        }
+        info.source = moves.join(' ');
+        info.pvOffset = moves.isEmpty() ? -1 : 0;
+    };
+    
+    if (iteration.lines.empty()) {
+        setLine(iteration.score, iteration.pv);
+        recordAnalysis(info);
+        return;
+    }
+    for (int i = 0; i < static_cast<int>(iteration.lines.size()); ++i) {
+        info.multiPv = i + 1;
+        setLine(iteration.lines[i].score, iteration.lines[i].pv);
+        recordAnalysis(info);
+    }
+}
+
+void ChessEngine::recordAnalysis(const UciInfo& info)
 {
-    if (m_process && m_process->state() == QProcess::Running) {
-        QString cmd = command + "\n";
-        m_process->write(cmd.toUtf8());
-        m_process->waitForBytesWritten(100);
+    // 只保留前 MAX_ANALYSIS_LINES 條變例，避免異常輸出撐大列表
+    if (info.multiPv > MAX_ANALYSIS_LINES) return;
+    if (m_analysisLines.size() < info.multiPv) {
+        m_analysisLines.resize(info.multiPv);
     }
+    m_analysisLines[info.multiPv - 1] = info;
+    
+    // 同一個更新間隔內的多行 info 只發出一次，計時器到期時送出最新結果；
+    // 預測思考的局面與畫面上的不同，結果先保留，ponderhit 時才發出
+    if (!m_isPondering && !m_analysisTimer->isActive()) {
+        m_analysisTimer->start();
+    }
+}
+
+void ChessEngine::flushAnalysis()
+{
+    m_analysisTimer->stop();
+    emit analysisUpdated(m_analysisLines);
+}
+
+void ChessEngine::clearAnalysis()
+{
+    m_analysisTimer->stop();
+    if (m_analysisLines.isEmpty()) return;
+    m_analysisLines.clear();
+    emit analysisUpdated(m_analysisLines);
+}
+
+void ChessEngine::sendCommand(const QString& command)
+{
+    if (!m_process) return;
+    
+    // 指令先放入緩衝區：程序啟動前累積到 started，寫入中則等上一批 bytesWritten 後合併成一次寫入
+    m_commandBuffer += command.toUtf8();
+    m_commandBuffer += '\n';
+    flushCommands();
+}
+
+void ChessEngine::flushCommands()
+{
+    if (!m_process || m_process->state() != QProcess::Running) return;
+    if (m_bytesInFlight > 0 || m_commandBuffer.isEmpty()) return;
+    
+    const qint64 written = m_process->write(m_commandBuffer);
+    if (written < 0) return;  // 寫入錯誤由 errorOccurred 回報
+    m_bytesInFlight = written;
+    m_commandBuffer.clear();
+}
+
+void ChessEngine::onEngineStarted()
+{
+    setState(EngineState::Handshaking);
+    flushCommands();
+}
+
+void ChessEngine::onBytesWritten(qint64 bytes)
+{
+    m_bytesInFlight = qMax<qint64>(0, m_bytesInFlight - bytes);
+    if (m_bytesInFlight == 0) flushCommands();
 }
 
 void ChessEngine::onReadyReadStandardOutput()
@@ -191,8 +922,14 @@ void ChessEngine::onEngineFinished(int exitCode, QProcess::ExitStatus exitStatus
     Q_UNUSED(exitCode);
     Q_UNUSED(exitStatus);
     
-    m_isReady = false;
+    m_startTimer->stop();
+    m_commandBuffer.clear();
+    m_bytesInFlight = 0;
+    setState(EngineState::NotRunning);
     m_isThinking = false;
+    m_isAnalyzing = false;
+    m_isPondering = false;
+    m_ignoredBestMoves = 0;
 }
 
 void ChessEngine::onEngineError(QProcess::ProcessError error)
@@ -200,7 +937,7 @@ void ChessEngine::onEngineError(QProcess::ProcessError error)
     QString errorMsg;
     switch (error) {
         case QProcess::FailedToStart:
-            errorMsg = "引擎無法啟動";
+            errorMsg = QString("無法啟動引擎：%1").arg(m_process ? m_process->errorString() : QString());
             break;
         case QProcess::Crashed:
             errorMsg = "引擎崩潰";
@@ -219,52 +956,105 @@ void ChessEngine::onEngineError(QProcess::ProcessError error)
             break;
     }
     
-    emit engineError(errorMsg);
-    m_isReady = false;
+    // 沒有啟動成功的程序不會發出 finished，在這裡釋放
+    if (error == QProcess::FailedToStart && m_process) {
+        m_process->disconnect(this);
+        m_process->deleteLater();
+        m_process = nullptr;
+        m_commandBuffer.clear();
+        m_bytesInFlight = 0;
+        m_startTimer->stop();
+    }
+    
+    if (error == QProcess::FailedToStart || error == QProcess::Crashed) {
+        setState(EngineState::NotRunning);
+    }
     m_isThinking = false;
+    m_isAnalyzing = false;
+    m_isPondering = false;
+    emit engineError(errorMsg);
 }
 
 void ChessEngine::parseOutput(const QString& line)
 {
     if (line.isEmpty()) return;
     
+    // 搜尋中的 info 行佔引擎輸出的絕大部分，先以不配置記憶體的解析器處理
+    if (line.startsWith(QLatin1String("info "))) {
+        UciInfo info;
+        if (m_ignoredBestMoves == 0 && UciInfo::parse(line, info)) {
+            recordAnalysis(info);
+        }
+        return;
+    }
+    
     // UCI 協議回應
     if (line == "uciok") {
         // UCI 初始化完成，配置引擎
+        setState(EngineState::Configuring);
         configureEngine();
         sendCommand("isready");
     }
     else if (line == "readyok") {
-        m_isReady = true;
-        emit engineReady();
+        // 之後的 isready（若有）只是同步確認，不重複發出 engineReady
+        if (m_state == EngineState::Configuring) {
+            m_startTimer->stop();
+            setState(EngineState::Ready);
+            emit engineReady();
+        }
+    }
+    else if (line.startsWith("bestmove") && m_ignoredBestMoves > 0) {
+        // 被放棄的搜尋（分析切換局面、結束分析、預測落空）的結果
+        --m_ignoredBestMoves;
+    }
+    else if (line.startsWith("bestmove") && m_isPondering) {
+        // 協議要求引擎在 ponderhit 或 stop 之前不回報走法；仍送出時保留到 ponderhit 再處理
+        m_ponderBestMove = line;
     }
     else if (line.startsWith("bestmove")) {
         // 解析最佳走法
         QStringList parts = line.split(' ', Qt::SkipEmptyParts);
         if (parts.size() >= 2) {
             m_bestMove = parts[1];
+            // 快取時記錄主要變例最後回報的分數與深度（沒有 info 時以設定的深度代替）
+            int score = 0;
+            int depth = m_searchDepth;
+            if (!m_analysisLines.isEmpty() && m_analysisLines[0].depth > 0) {
+                score = m_analysisLines[0].searchScore();
+                depth = m_analysisLines[0].depth;
+            }
+            if (m_analysisTimer->isActive()) {
+                flushAnalysis();
+            }
+            cacheBestMove(m_bestMove, score, depth);
             m_isThinking = false;
             emit thinkingStopped();
             emit bestMoveFound(m_bestMove);
+            
+            // "bestmove e2e4 ponder e7e5"
+            if (parts.size() >= 4 && parts[2] == "ponder") {
+                startPondering(parts[3]);
+            }
         }
     }
-    // 可以添加更多解析，如 info 資訊用於顯示引擎思考
 }
 
 void ChessEngine::configureEngine()
 {
-    if (!m_process || m_process->state() != QProcess::Running) return;
+    if (!m_process) return;
     
     // 設定 Stockfish 的技能等級（1-20）
     // 注意：此選項名稱為 Stockfish 專用，其他引擎可能使用不同名稱
     sendCommand(QString("setoption name Skill Level value %1").arg(m_skillLevel));
     
-    // 設定較小的 hash 表（16MB）以節省記憶體
-    // 對於休閒遊戲來說足夠，同時不會佔用太多系統資源
-    sendCommand("setoption name Hash value 16");
+    // hash 表大小與內建置換表相同（預設 16MB，可在引擎設定中調整）
+    sendCommand(QString("setoption name Hash value %1").arg(m_transpositionTable.sizeMb()));
+    
+    // 搜尋執行緒數（預設為本機可同時執行的執行緒數）
+    sendCommand(QString("setoption name Threads value %1").arg(m_threadCount));
     
-    // 禁用 Ponder（預測對手走法）以簡化遊戲體驗
-    sendCommand("setoption name Ponder value false");
+    // Ponder 選項讓引擎在時間分配上考慮預測思考
+    sendCommand(QString("setoption name Ponder value %1").arg(m_ponderEnabled ? "true" : "false"));
 }
 
 // 靜態工具函數
@@ -315,31 +1105,13 @@ QString ChessEngine::boardToFEN(const ChessBoard& board)
     fen += ' ';
     fen += (board.getCurrentPlayer() == PieceColor::White) ? 'w' : 'b';
     
-    // 王車易位權利（簡化：檢查國王和車是否移動過）
+    // 王車易位權利
     QString castling;
-    const ChessPiece& whiteKing = board.getPiece(7, 4);
-    const ChessPiece& blackKing = board.getPiece(0, 4);
-    const ChessPiece& whiteRookK = board.getPiece(7, 7);
-    const ChessPiece& whiteRookQ = board.getPiece(7, 0);
-    const ChessPiece& blackRookK = board.getPiece(0, 7);
-    const ChessPiece& blackRookQ = board.getPiece(0, 0);
-    
-    if (whiteKing.getType() == PieceType::King && !whiteKing.hasMoved()) {
-        if (whiteRookK.getType() == PieceType::Rook && !whiteRookK.hasMoved()) {
-            castling += 'K';
-        }
-        if (whiteRookQ.getType() == PieceType::Rook && !whiteRookQ.hasMoved()) {
-            castling += 'Q';
-        }
-    }
-    if (blackKing.getType() == PieceType::King && !blackKing.hasMoved()) {
-        if (blackRookK.getType() == PieceType::Rook && !blackRookK.hasMoved()) {
-            castling += 'k';
-        }
-        if (blackRookQ.getType() == PieceType::Rook && !blackRookQ.hasMoved()) {
-            castling += 'q';
-        }
-    }
+    quint8 rights = board.castlingRights();
+    if (rights & WhiteKingSide)  castling += 'K';
+    if (rights & WhiteQueenSide) castling += 'Q';
+    if (rights & BlackKingSide)  castling += 'k';
+    if (rights & BlackQueenSide) castling += 'q';
     
     fen += ' ';
     fen += castling.isEmpty() ? "-" : castling;
@@ -356,8 +1128,8 @@ QString ChessEngine::boardToFEN(const ChessBoard& board)
         fen += '-';
     }
     
-    // 半步計數和全步計數（簡化）
-    fen += " 0 1";
+    // 半步計數（五十步規則）和全步計數
+    fen += QString(" %1 %2").arg(board.getHalfmoveClock()).arg(board.getFullmoveNumber());
     
     return fen;
 }
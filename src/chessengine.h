@@ -3,12 +3,22 @@
 
 #include <QObject>
 #include <QProcess>
+#include <QByteArray>
 #include <QString>
 #include <QPoint>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVector>
+#include <memory>
 #include "chesspiece.h"
+#include "transpositiontable.h"
+#include "uciinfo.h"
 
 class ChessBoard;
+class SearchEngine;
+struct SearchLimits;
+struct SearchResult;
 
 // 引擎難度等級
 enum class EngineDifficulty {
@@ -19,6 +29,15 @@ enum class EngineDifficulty {
     VeryHard = 20   // 等級 20 - 非常困難
 };
 
+// 外部引擎的生命週期（內建引擎啟動後直接進入 Ready）
+enum class EngineState {
+    NotRunning,     // 沒有程序
+    Starting,       // 程序啟動中，指令暫存在緩衝區
+    Handshaking,    // 已送出 uci，等待 uciok
+    Configuring,    // 已送出選項與 isready，等待 readyok
+    Ready           // 可以接受局面與搜尋要求
+};
+
 // 遊戲模式
 enum class GameMode {
     HumanVsHuman,       // 雙人對弈
@@ -35,10 +54,25 @@ public:
     explicit ChessEngine(QObject *parent = nullptr);
     ~ChessEngine();
 
-    // 引擎控制
+    // 內建搜尋引擎的識別路徑：傳給 startEngine 時不啟動外部程序，改用行程內的 SearchEngine
+    static const QString BUILTIN_ENGINE;
+    static constexpr int MAX_THREADS = 256;
+    static constexpr int MAX_SKILL_LEVEL = 20;  // 完整棋力；低於此值時搜尋加入隨機性
+    // 分析資訊的合併間隔（毫秒）：期間收到的 info 只保留每條變例的最新一筆，約每個畫面更新一次
+    static constexpr int ANALYSIS_UPDATE_INTERVAL_MS = 16;
+    static constexpr int MAX_ANALYSIS_LINES = 16;
+    // 從啟動程序到 readyok 的時間上限；quit 之後等待程序自行結束的時間
+    static constexpr int START_TIMEOUT_MS = 10000;
+    static constexpr int QUIT_TIMEOUT_MS = 3000;
+
+    // 引擎控制：兩者都不會阻塞事件迴圈。startEngine() 只開始啟動程序（檔案不存在時回傳 false），
+    // 握手完成後發出 engineReady，失敗時發出 engineError；stopEngine() 送出 quit 後立即返回，
+    // 程序在背景結束（逾時則強制終止），可以馬上再次 startEngine()
     bool startEngine(const QString& enginePath);
     void stopEngine();
-    bool isEngineRunning() const;
+    bool isEngineRunning() const;  // 已可接受局面與搜尋要求（EngineState::Ready）
+    EngineState getState() const { return m_state; }
+    bool isBuiltinEngine() const { return m_useBuiltinEngine; }
 
     // 遊戲模式和難度設定
     void setGameMode(GameMode mode);
@@ -52,34 +86,76 @@ public:
     
     void setSearchDepth(int depth);  // 設定搜尋深度（1-30）
     int getSearchDepth() const { return m_searchDepth; }
+    
+    // 棋鐘（毫秒，剩餘時間 0 表示該方不限時）：設定後 requestMove() 與預測思考改依行棋方的剩餘時間分配思考時間，
+    // 外部引擎收到 go wtime/btime/winc/binc，內建搜尋由 TimeManager 分配；行棋方不限時或 clearClock() 後
+    // 恢復 setThinkingTime() 的固定思考時間。每次 requestMove() 前以當時的棋鐘呼叫
+    void setClock(int whiteTimeMs, int blackTimeMs, int whiteIncrementMs, int blackIncrementMs);
+    void clearClock();
+    bool hasClock() const { return m_clockEnabled; }
+    
+    // 置換表大小（MB），同時作為外部引擎的 UCI Hash 選項
+    void setHashSize(int megabytes);
+    int getHashSize() const { return m_transpositionTable.sizeMb(); }
+    
+    // 搜尋執行緒數（0 表示自動偵測 QThread::idealThreadCount()），同時作為外部引擎的 UCI Threads 選項
+    void setThreadCount(int threads);
+    int getThreadCount() const { return m_threadCount; }  // 實際使用的執行緒數
 
     // 棋局控制
     void newGame();
     void setPosition(const QString& fen);
-    void setPositionFromMoves(const QStringList& moves);
+    // startFen 為空時走法從初始局面開始，否則從該 FEN 開始（UCI 的 position fen ... moves ...）
+    void setPositionFromMoves(const QStringList& moves, const QString& startFen = QString());
     void requestMove();
     void stop();
+    bool isThinking() const { return m_isThinking; }
+    
+    // 無限分析（go infinite + MultiPV）：分析中 setPosition / setPositionFromMoves 直接把搜尋轉到新局面，
+    // 結果只經由 analysisUpdated 回報，不發出 bestMoveFound；requestMove() 與 newGame() 會先結束分析
+    void setMultiPv(int lines);  // 1-MAX_ANALYSIS_LINES
+    int getMultiPv() const { return m_multiPv; }
+    void startAnalysis();
+    void stopAnalysis();
+    bool isAnalyzing() const { return m_isAnalyzing; }
+    
+    // 預測思考（ponder）：人機對弈中電腦走完後，在玩家思考期間搜尋預期的回應局面
+    // （bestmove 的 ponder 走法；內建引擎取主要變例的第二步）。玩家走了預期的走法時
+    // requestMove() 送出 ponderhit 繼續同一個搜尋，否則停止並重新搜尋。思考時間從預測思考開始時起算，
+    // 因此 ponderhit 之後最多再等 setThinkingTime() 減去已預測思考的時間
+    void setPonderEnabled(bool enabled);
+    bool isPonderEnabled() const { return m_ponderEnabled; }
+    bool isPondering() const { return m_isPondering; }
 
     // UCI 相關
     QString getBestMove() const { return m_bestMove; }
+    const QVector<UciInfo>& getAnalysisLines() const { return m_analysisLines; }
 
     // 工具函數 - 將棋盤狀態轉換為 FEN 格式
     static QString boardToFEN(const ChessBoard& board);
     static QString moveToUCI(const QPoint& from, const QPoint& to, PieceType promotionType = PieceType::None);
     static void uciToMove(const QString& uci, QPoint& from, QPoint& to, PieceType& promotionType);
+    // 在指定局面中把 UCI 走法轉成合法的 Move（不合法時回傳空走法；省略升變類型時視為升后）
+    static Move uciToBoardMove(const ChessBoard& board, const QString& uci);
 
 signals:
     void engineReady();
+    void stateChanged(EngineState state);
     void bestMoveFound(const QString& move);
     void engineError(const QString& error);
     void thinkingStarted();
     void thinkingStopped();
+    // 搜尋進度：依 multipv 排列的每條變例最新資訊（分數以行棋方角度），兩種引擎都會發出；
+    // 高頻的 info 會合併，最多每 ANALYSIS_UPDATE_INTERVAL_MS 發出一次，開始新的搜尋時以空列表清除
+    void analysisUpdated(const QVector<UciInfo>& lines);
 
 private slots:
     void onReadyReadStandardOutput();
     void onReadyReadStandardError();
     void onEngineFinished(int exitCode, QProcess::ExitStatus exitStatus);
     void onEngineError(QProcess::ProcessError error);
+    void onEngineStarted();
+    void onBytesWritten(qint64 bytes);
 
 private:
     QProcess* m_process;
@@ -91,13 +167,87 @@ private:
     int m_skillLevel;           // 0-20
     int m_thinkingTimeMs;       // 思考時間（毫秒）
     int m_searchDepth;          // 搜尋深度（1-30）
+    int m_threadCount;          // 搜尋執行緒數
+    int m_multiPv;              // 分析模式的變例數
     
-    bool m_isReady;
+    // 棋鐘（依顏色索引：0 白、1 黑）與 setClock() 之後經過的時間（預測思考時估計電腦走完後的剩餘時間）
+    bool m_clockEnabled;
+    int m_clockTimeMs[2];
+    int m_clockIncrementMs[2];
+    QElapsedTimer m_clockTimer;
+    
+    EngineState m_state;
+    QByteArray m_commandBuffer;  // 尚未寫入程序的指令（程序啟動前、或上一批仍在寫入時累積）
+    qint64 m_bytesInFlight;      // 已交給 QProcess 但尚未 bytesWritten 的位元組數
     bool m_isThinking;
+    bool m_isAnalyzing;
+    int m_ignoredBestMoves;     // 已送出 stop 但尚未收到的 bestmove 數，期間的 info 與 bestmove 屬於舊搜尋，一律丟棄
+    
+    // 預測思考
+    bool m_ponderEnabled;
+    bool m_isPondering;
+    QStringList m_ponderMoves;                   // 預測思考的局面（由初始局面開始的走法，最後兩步為電腦的走法與預期的回應）
+    QString m_ponderBestMove;                    // 外部引擎在 ponderhit 前就送出的 bestmove 行（不符合協議，但仍保留）
+    std::unique_ptr<SearchResult> m_ponderResult;  // 內建引擎在 ponderhit 前就結束的搜尋結果
     
+    // 目前局面（兩種引擎都會維護，用於內建搜尋與走法快取）
+    std::unique_ptr<ChessBoard> m_positionBoard;
+    bool m_positionValid;                        // 局面是否與送給引擎的走法一致
+    QStringList m_positionMoves;                 // m_positionBoard 的走法（m_currentPosition 為空時有效），用於增量更新
+    QString m_startFen;                          // m_positionMoves 的起始局面（空字串為初始局面）
+    
+    // 置換表：內建搜尋使用，也以「局面 + 難度設定」為鍵快取 bestMoveFound 的結果
+    TranspositionTable m_transpositionTable;
+    quint64 m_requestKey;                        // 目前請求的快取鍵（0 表示不快取）
+    bool m_stopRequested;                        // 本次請求是否被 stop() 中斷（中斷的結果不快取）
+    int m_pendingHashSizeMb;                     // 搜尋中變更的置換表大小，搜尋執行緒結束後才套用（0 表示沒有）
+    
+    // 內建引擎
+    bool m_useBuiltinEngine;
+    std::shared_ptr<SearchEngine> m_searchEngine;  // 下一次搜尋使用的引擎（搜尋執行緒另外持有一份）
+    QThread* m_searchThread;                     // 目前請求的搜尋工作執行緒（取消後為 nullptr）
+    QVector<QThread*> m_runningSearchThreads;    // 尚未結束的搜尋執行緒，含已取消、仍在收尾的搜尋
+    int m_searchId;                              // 遞增的請求編號，用來丟棄已取消請求的結果
+    
+    // 搜尋進度（依 multipv 排列）與合併 info 的計時器
+    QVector<UciInfo> m_analysisLines;
+    QTimer* m_analysisTimer;
+    QTimer* m_startTimer;                        // 外部引擎啟動與握手的逾時
+
     void sendCommand(const QString& command);
+    void flushCommands();
+    void setState(EngineState state);
+    bool acceptsOptions() const;
     void parseOutput(const QString& line);
     void configureEngine();
+    QString positionCommand(const QStringList& moves) const;
+    // 搜尋限制：有棋鐘時依行棋方的剩餘時間，否則為固定的思考時間與深度；
+    // ponder 為 true 時棋鐘以電腦走完這一步之後估計（預測思考的局面輪到電腦）
+    int clockTime(int side, bool ponder) const;
+    QString goCommand(PieceColor sideToMove, bool ponder) const;
+    SearchLimits builtinLimits(const ChessBoard& board, bool ponder) const;
+
+    quint64 bestMoveCacheKey() const;
+    Move parseBoardMove(const QString& uci) const;
+    void cacheBestMove(const QString& uci, int score, int depth);
+    void applyPendingHashSize();
+    
+    bool startBuiltinEngine();
+    void startBuiltinSearch(const SearchLimits& limits, const ChessBoard& board, bool ponder = false);
+    void cancelBuiltinSearch();
+    void onBuiltinSearchFinished(int searchId, const SearchResult& result);
+    void recordBuiltinAnalysis(const SearchResult& iteration);
+    
+    void restartAnalysis();
+    
+    void startPondering(const QString& ponderMove);
+    void stopPondering();
+    void ponderHit();
+    void abandonExternalSearch();
+    
+    void recordAnalysis(const UciInfo& info);
+    void flushAnalysis();
+    void clearAnalysis();
 };
 
 #endif // CHESSENGINE_H
@@ -0,0 +1,103 @@
+#ifndef CHESSMOVE_H
+#define CHESSMOVE_H
+
+#include <QtGlobal>
+#include <QPoint>
+#include "chesspiece.h"
+#include "bitboard.h"
+
+// ===== 16 位元移動編碼 =====
+// bits 0-5：起始格，bits 6-11：目標格，bits 12-15：移動標記
+// 格子索引與位元棋盤一致（row * 8 + col）
+class Move {
+public:
+    enum Flag : quint16 {
+        Quiet = 0,
+        DoublePawnPush = 1,
+        KingCastle = 2,
+        QueenCastle = 3,
+        Capture = 4,
+        EnPassant = 5,
+        KnightPromotion = 8,
+        BishopPromotion = 9,
+        RookPromotion = 10,
+        QueenPromotion = 11,
+        KnightPromotionCapture = 12,
+        BishopPromotionCapture = 13,
+        RookPromotionCapture = 14,
+        QueenPromotionCapture = 15
+    };
+
+    constexpr Move() : m_data(0) {}
+    constexpr Move(int from, int to, int flags = Quiet)
+        : m_data(static_cast<quint16>((from & 0x3F) | ((to & 0x3F) << 6) | ((flags & 0xF) << 12))) {}
+
+    constexpr int from() const { return m_data & 0x3F; }
+    constexpr int to() const { return (m_data >> 6) & 0x3F; }
+    constexpr int flags() const { return m_data >> 12; }
+    constexpr quint16 raw() const { return m_data; }
+    static constexpr Move fromRaw(quint16 raw) { return Move(raw & 0x3F, (raw >> 6) & 0x3F, raw >> 12); }
+    constexpr bool isNull() const { return m_data == 0; }
+
+    constexpr bool isCapture() const { return (flags() & Capture) != 0; }
+    constexpr bool isPromotion() const { return (flags() & KnightPromotion) != 0; }
+    constexpr bool isCastling() const { return flags() == KingCastle || flags() == QueenCastle; }
+    constexpr bool isEnPassant() const { return flags() == EnPassant; }
+
+    PieceType promotionType() const {
+        if (!isPromotion()) return PieceType::None;
+        switch (flags() & 3) {
+            case 0:  return PieceType::Knight;
+            case 1:  return PieceType::Bishop;
+            case 2:  return PieceType::Rook;
+            default: return PieceType::Queen;
+        }
+    }
+
+    // 依升變類型與是否吃子取得對應的移動標記
+    static int promotionFlags(PieceType type, bool isCapture) {
+        int base = isCapture ? KnightPromotionCapture : KnightPromotion;
+        switch (type) {
+            case PieceType::Knight: return base;
+            case PieceType::Bishop: return base + 1;
+            case PieceType::Rook:   return base + 2;
+            default:                return base + 3;
+        }
+    }
+
+    QPoint fromPoint() const { return QPoint(Bitboards::colOf(from()), Bitboards::rowOf(from())); }
+    QPoint toPoint() const { return QPoint(Bitboards::colOf(to()), Bitboards::rowOf(to())); }
+
+    constexpr bool operator==(const Move& other) const { return m_data == other.m_data; }
+    constexpr bool operator!=(const Move& other) const { return m_data != other.m_data; }
+
+private:
+    quint16 m_data;
+};
+
+// ===== 固定容量的移動列表（配置在堆疊上，不使用堆積記憶體）=====
+// 任何合法西洋棋局面的合法走法數都少於 256
+class MoveList {
+public:
+    static constexpr int MAX_MOVES = 256;
+
+    MoveList() : m_size(0) {}
+
+    void add(Move move) { m_moves[m_size++] = move; }
+    void clear() { m_size = 0; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    const Move& operator[](int index) const { return m_moves[index]; }
+    Move& operator[](int index) { return m_moves[index]; }
+    const Move* begin() const { return m_moves; }
+    const Move* end() const { return m_moves + m_size; }
+    Move* begin() { return m_moves; }
+    Move* end() { return m_moves + m_size; }
+
+private:
+    Move m_moves[MAX_MOVES];
+    int m_size;
+};
+
+#endif // CHESSMOVE_H
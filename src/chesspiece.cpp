@@ -1,4 +1,5 @@
 #include "chesspiece.h"
+#include "chessboard.h"
 #include <cmath>
 
 ChessPiece::ChessPiece(PieceType type, PieceColor color)
@@ -34,7 +35,7 @@ QString ChessPiece::getSymbol() const {
 }
 
 bool ChessPiece::isValidMove(const QPoint& from, const QPoint& to, 
-                              const std::vector<std::vector<ChessPiece>>& board,
+                              const ChessBoard& board,
                               const QPoint& enPassantTarget) const {
     if (from == to) return false;
     
@@ -42,8 +43,8 @@ bool ChessPiece::isValidMove(const QPoint& from, const QPoint& to,
     if (to.x() < 0 || to.x() >= 8 || to.y() < 0 || to.y() >= 8) return false;
     
     // 不能吃掉自己的棋子
-    const ChessPiece& target = board[to.y()][to.x()];
-    if (target.getColor() == m_color && target.getType() != PieceType::None) return false;
+    Bitboard toMask = Bitboards::squareMask(Bitboards::squareIndex(to.y(), to.x()));
+    if (board.colorBitboard(m_color) & toMask) return false;
     
     switch (m_type) {
         case PieceType::Pawn:   return isValidPawnMove(from, to, board, enPassantTarget);
@@ -57,7 +58,7 @@ bool ChessPiece::isValidMove(const QPoint& from, const QPoint& to,
 }
 
 bool ChessPiece::isValidPawnMove(const QPoint& from, const QPoint& to, 
-                                  const std::vector<std::vector<ChessPiece>>& board,
+                                  const ChessBoard& board,
                                   const QPoint& enPassantTarget) const {
     int direction = (m_color == PieceColor::White) ? -1 : 1;
     int startRow = (m_color == PieceColor::White) ? 6 : 1;
@@ -65,29 +66,31 @@ bool ChessPiece::isValidPawnMove(const QPoint& from, const QPoint& to,
     int dx = to.x() - from.x();
     int dy = to.y() - from.y();
     
+    Bitboard occupied = board.occupied();
+    Bitboard toMask = Bitboards::squareMask(Bitboards::squareIndex(to.y(), to.x()));
+    
     // 向前移動
     if (dx == 0) {
-        const ChessPiece& target = board[to.y()][to.x()];
-        if (target.getType() != PieceType::None) return false;
+        if (occupied & toMask) return false;
         
         // 向前一格
         if (dy == direction) return true;
         
         // 從起始位置向前兩格
         if (!m_hasMoved && from.y() == startRow && dy == 2 * direction) {
-            const ChessPiece& middle = board[from.y() + direction][from.x()];
-            return middle.getType() == PieceType::None;
+            Bitboard middleMask = Bitboards::squareMask(Bitboards::squareIndex(from.y() + direction, from.x()));
+            return (occupied & middleMask) == 0;
         }
     }
-    // 斜向吃子
-    else if (abs(dx) == 1 && dy == direction) {
-        const ChessPiece& target = board[to.y()][to.x()];
-        // 普通斜向吃子
-        if (target.getType() != PieceType::None && target.getColor() != m_color) {
+    // 斜向吃子（查兵的攻擊表）
+    else if (Bitboards::pawnAttacks(Bitboards::squareIndex(from.y(), from.x()), m_color) & toMask) {
+        // 普通斜向吃子（目標格有任何棋子，己方棋子已在 isValidMove 中排除）
+        if (occupied & toMask) {
             return true;
         }
-        // 吃過路兵
-        if (enPassantTarget.x() >= 0 && to == enPassantTarget) {
+        // 吃過路兵（目標格必須位於對方兵剛跳過的橫列）
+        int enPassantRow = (m_color == PieceColor::White) ? 2 : 5;
+        if (enPassantTarget.x() >= 0 && to == enPassantTarget && to.y() == enPassantRow) {
             return true;
         }
     }
@@ -96,55 +99,39 @@ bool ChessPiece::isValidPawnMove(const QPoint& from, const QPoint& to,
 }
 
 bool ChessPiece::isValidRookMove(const QPoint& from, const QPoint& to, 
-                                  const std::vector<std::vector<ChessPiece>>& board) const {
-    if (from.x() != to.x() && from.y() != to.y()) return false;
-    return isPathClear(from, to, board);
+                                  const ChessBoard& board) const {
+    // 查 magic bitboard 攻擊表：目標格在攻擊範圍內即表示同行/列且路徑暢通
+    Bitboard toMask = Bitboards::squareMask(Bitboards::squareIndex(to.y(), to.x()));
+    return (Bitboards::rookAttacks(Bitboards::squareIndex(from.y(), from.x()), board.occupied()) & toMask) != 0;
 }
 
 bool ChessPiece::isValidKnightMove(const QPoint& from, const QPoint& to) const {
-    int dx = abs(to.x() - from.x());
-    int dy = abs(to.y() - from.y());
-    return (dx == 2 && dy == 1) || (dx == 1 && dy == 2);
+    Bitboard toMask = Bitboards::squareMask(Bitboards::squareIndex(to.y(), to.x()));
+    return (Bitboards::knightAttacks(Bitboards::squareIndex(from.y(), from.x())) & toMask) != 0;
 }
 
 bool ChessPiece::isValidBishopMove(const QPoint& from, const QPoint& to, 
-                                    const std::vector<std::vector<ChessPiece>>& board) const {
-    if (abs(to.x() - from.x()) != abs(to.y() - from.y())) return false;
-    return isPathClear(from, to, board);
+                                    const ChessBoard& board) const {
+    Bitboard toMask = Bitboards::squareMask(Bitboards::squareIndex(to.y(), to.x()));
+    return (Bitboards::bishopAttacks(Bitboards::squareIndex(from.y(), from.x()), board.occupied()) & toMask) != 0;
 }
 
 bool ChessPiece::isValidQueenMove(const QPoint& from, const QPoint& to, 
-                                   const std::vector<std::vector<ChessPiece>>& board) const {
+                                   const ChessBoard& board) const {
     return isValidRookMove(from, to, board) || isValidBishopMove(from, to, board);
 }
 
 bool ChessPiece::isValidKingMove(const QPoint& from, const QPoint& to) const {
+    // 普通國王移動（任意方向一格，查國王的攻擊表）
+    Bitboard toMask = Bitboards::squareMask(Bitboards::squareIndex(to.y(), to.x()));
+    if (Bitboards::kingAttacks(Bitboards::squareIndex(from.y(), from.x())) & toMask) return true;
+    
     int dx = abs(to.x() - from.x());
     int dy = abs(to.y() - from.y());
     
-    // 普通國王移動（任意方向一格）
-    if (dx <= 1 && dy <= 1) return true;
-    
     // 王車易位（水平移動 2 格）
     // 注意：額外的驗證（例如，不處於被將軍狀態、路徑暢通）在 ChessBoard::canCastle 中完成
     if (dx == 2 && dy == 0 && !m_hasMoved) return true;
     
     return false;
 }
-
-bool ChessPiece::isPathClear(const QPoint& from, const QPoint& to, 
-                              const std::vector<std::vector<ChessPiece>>& board) const {
-    int dx = (to.x() > from.x()) ? 1 : (to.x() < from.x()) ? -1 : 0;
-    int dy = (to.y() > from.y()) ? 1 : (to.y() < from.y()) ? -1 : 0;
-    
-    int x = from.x() + dx;
-    int y = from.y() + dy;
-    
-    while (x != to.x() || y != to.y()) {
-        if (board[y][x].getType() != PieceType::None) return false;
-        x += dx;
-        y += dy;
-    }
-    
-    return true;
-}
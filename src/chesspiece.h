@@ -3,7 +3,6 @@
 
 #include <QString>
 #include <QPoint>
-#include <vector>
 
 enum class PieceType {
     None,
@@ -21,6 +20,8 @@ enum class PieceColor {
     Black
 };
 
+class ChessBoard;
+
 class ChessPiece {
 public:
     ChessPiece(PieceType type = PieceType::None, PieceColor color = PieceColor::None);
@@ -33,8 +34,9 @@ public:
     QString getSymbol() const;
     
     // 檢查移動到目標位置是否有效（基本棋子移動規則）
+    // 使用棋盤的位元棋盤佔用遮罩判斷阻擋與吃子
     bool isValidMove(const QPoint& from, const QPoint& to, 
-                     const std::vector<std::vector<ChessPiece>>& board,
+                     const ChessBoard& board,
                      const QPoint& enPassantTarget = QPoint(-1, -1)) const;
     
 private:
@@ -43,19 +45,16 @@ private:
     bool m_hasMoved;
     
     bool isValidPawnMove(const QPoint& from, const QPoint& to, 
-                         const std::vector<std::vector<ChessPiece>>& board,
+                         const ChessBoard& board,
                          const QPoint& enPassantTarget) const;
     bool isValidRookMove(const QPoint& from, const QPoint& to, 
-                         const std::vector<std::vector<ChessPiece>>& board) const;
+                         const ChessBoard& board) const;
     bool isValidKnightMove(const QPoint& from, const QPoint& to) const;
     bool isValidBishopMove(const QPoint& from, const QPoint& to, 
-                           const std::vector<std::vector<ChessPiece>>& board) const;
+                           const ChessBoard& board) const;
     bool isValidQueenMove(const QPoint& from, const QPoint& to, 
-                          const std::vector<std::vector<ChessPiece>>& board) const;
+                          const ChessBoard& board) const;
     bool isValidKingMove(const QPoint& from, const QPoint& to) const;
-    
-    bool isPathClear(const QPoint& from, const QPoint& to, 
-                     const std::vector<std::vector<ChessPiece>>& board) const;
 };
 
 #endif // CHESSPIECE_H
@@ -0,0 +1,23 @@
+#ifndef DIFFICULTY_H
+#define DIFFICULTY_H
+
+// ===== 電腦難度等級 =====
+// 難度滑桿的等級（0 到 ChessEngine::MAX_SKILL_LEVEL）對應的顯示 ELO、思考時間與搜尋深度。
+// 主視窗與對戰工具（tools/match）共用同一份對應，校準時量測的就是實際對弈的設定
+
+namespace Difficulty {
+
+constexpr int ELO_BASE = 250;                // 最低 ELO 評分（對應 Skill Level 0）
+constexpr int ELO_PER_LEVEL = 150;           // 每級增加的 ELO 分數（確保結果能被50整除）
+
+constexpr int nominalElo(int level) { return ELO_BASE + level * ELO_PER_LEVEL; }
+
+// 較低難度：較短思考時間（最小 50ms）；較高難度：較長思考時間（最多 2550ms）
+constexpr int thinkingTimeMs(int level) { return 50 + level * 125; }
+
+// 搜尋深度與難度綁定：Level 0 (ELO 250) = depth 1，Level 20 (ELO 3250) = depth 21
+constexpr int searchDepth(int level) { return 1 + level; }
+
+} // namespace Difficulty
+
+#endif // DIFFICULTY_H
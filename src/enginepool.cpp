@@ -0,0 +1,320 @@
+#include "enginepool.h"
+#include "chessengine.h"
+#include "chessboard.h"
+#include "searchengine.h"
+#include <QThread>
+#include <QDebug>
+
+bool PositionEvaluation::isMate() const
+{
+    return SearchEngine::isMateScore(score);
+}
+
+int PositionEvaluation::mateMoves() const
+{
+    if (!isMate()) return 0;
+    UciInfo info;
+    info.setSearchScore(score);
+    return info.score;
+}
+
+EnginePool::EnginePool(QObject *parent)
+    : QObject(parent)
+    , m_busyCount(0)
+    , m_completed(0)
+    , m_total(0)
+    , m_generation(0)
+    , m_searchDepth(16)
+    , m_thinkingTimeMs(500)
+    , m_hashSizeMb(16)
+    , m_threadsPerEngine(1)
+{
+}
+
+EnginePool::~EnginePool()
+{
+    shutdown();
+}
+
+int EnginePool::defaultEngineCount(int threadsPerEngine)
+{
+    return qMax(1, QThread::idealThreadCount() / qMax(1, threadsPerEngine));
+}
+
+bool EnginePool::start(const QString& enginePath, int engineCount, int threadsPerEngine)
+{
+    shutdown();
+
+    m_threadsPerEngine = qBound(1, threadsPerEngine, ChessEngine::MAX_THREADS);
+    if (engineCount <= 0) {
+        engineCount = defaultEngineCount(m_threadsPerEngine);
+    }
+
+    for (int i = 0; i < engineCount; ++i) {
+        Worker* worker = new Worker;
+        worker->engine = new ChessEngine(this);
+        ChessEngine* engine = worker->engine;
+        engine->setDifficulty(20);
+        engine->setSearchDepth(m_searchDepth);
+        engine->setThinkingTime(m_thinkingTimeMs);
+        engine->setHashSize(m_hashSizeMb);
+        engine->setThreadCount(m_threadsPerEngine);
+
+        connect(engine, &ChessEngine::engineReady, this, [this, worker]() {
+            worker->ready = true;
+            dispatch();
+        });
+        connect(engine, &ChessEngine::analysisUpdated, this, [this, worker](const QVector<UciInfo>& lines) {
+            onAnalysisUpdated(worker, lines);
+        });
+        connect(engine, &ChessEngine::bestMoveFound, this, [this, worker](const QString& move) {
+            onBestMove(worker, move);
+        });
+        connect(engine, &ChessEngine::engineError, this, [this, worker](const QString& error) {
+            onWorkerError(worker, error);
+        });
+
+        m_workers.append(worker);
+        if (!engine->startEngine(enginePath)) {
+            // 錯誤已經由 onWorkerError 處理（引擎從池中移除）
+            continue;
+        }
+    }
+
+    qDebug() << "Engine pool started:" << m_workers.size() << "engines x"
+             << m_threadsPerEngine << "threads";
+    return !m_workers.isEmpty();
+}
+
+void EnginePool::shutdown()
+{
+    m_queue.clear();
+    m_games.clear();
+    for (Worker* worker : m_workers) {
+        worker->engine->disconnect(this);
+        worker->engine->stopEngine();
+        delete worker->engine;
+        delete worker;
+    }
+    m_workers.clear();
+    m_busyCount = 0;
+}
+
+void EnginePool::setSearchDepth(int depth)
+{
+    m_searchDepth = depth;
+    for (Worker* worker : m_workers) {
+        worker->engine->setSearchDepth(depth);
+    }
+}
+
+void EnginePool::setThinkingTime(int milliseconds)
+{
+    m_thinkingTimeMs = milliseconds;
+    for (Worker* worker : m_workers) {
+        worker->engine->setThinkingTime(milliseconds);
+    }
+}
+
+void EnginePool::setHashSize(int megabytes)
+{
+    m_hashSizeMb = megabytes;
+    for (Worker* worker : m_workers) {
+        worker->engine->setHashSize(megabytes);
+    }
+}
+
+void EnginePool::enqueue(const AnalysisJob& job)
+{
+    // 從閒置開始的新一批工作重新計算進度與速度
+    if (isIdle()) {
+        m_completed = 0;
+        m_total = 0;
+        m_timer.start();
+    }
+    m_queue.append(job);
+    ++m_total;
+    dispatch();
+}
+
+void EnginePool::analyzeGame(int gameId, const QStringList& uciMoves, const QString& startFen)
+{
+    GameProgress& game = m_games[gameId];
+    game.evaluations = QVector<PositionEvaluation>(uciMoves.size() + 1);
+    game.remaining = uciMoves.size() + 1;
+
+    AnalysisJob job;
+    job.gameId = gameId;
+    job.fen = startFen;
+    for (int ply = 0; ply <= uciMoves.size(); ++ply) {
+        job.ply = ply;
+        job.moves = uciMoves.mid(0, ply);
+        enqueue(job);
+    }
+}
+
+void EnginePool::cancel()
+{
+    m_queue.clear();
+    m_games.clear();
+    // 進行中的局面送出 stop；之後回報的 bestmove 屬於舊的一批，只用來釋放引擎
+    ++m_generation;
+    for (Worker* worker : m_workers) {
+        if (worker->busy) worker->engine->stop();
+    }
+    m_total = m_completed;
+}
+
+double EnginePool::positionsPerSecond() const
+{
+    if (!m_timer.isValid() || m_completed == 0) return 0.0;
+    const qint64 elapsed = qMax<qint64>(1, m_timer.elapsed());
+    return m_completed * 1000.0 / elapsed;
+}
+
+void EnginePool::dispatch()
+{
+    // 已分出勝負的局面在 startJob 內直接完成，引擎仍然空閒，因此同一個引擎可能連續領取多個工作
+    for (int i = 0; i < m_workers.size() && !m_queue.isEmpty(); ++i) {
+        Worker* worker = m_workers[i];
+        while (worker->ready && !worker->busy && !m_queue.isEmpty()) {
+            startJob(worker, m_queue.takeFirst());
+        }
+    }
+}
+
+void EnginePool::startJob(Worker* worker, const AnalysisJob& job)
+{
+    PositionEvaluation evaluation;
+    evaluation.gameId = job.gameId;
+    evaluation.ply = job.ply;
+
+    // 先在本地棋盤重建局面：無效的局面與已分出勝負的局面不必交給引擎
+    ChessBoard board;
+    bool valid = job.fen.isEmpty() || board.setFromFEN(job.fen);
+    for (int i = 0; valid && i < job.moves.size(); ++i) {
+        const Move move = ChessEngine::uciToBoardMove(board, job.moves[i]);
+        if (move.isNull()) {
+            valid = false;
+            break;
+        }
+        board.makeMove(move);
+    }
+    if (!valid) {
+        qWarning() << "Engine pool: invalid position for game" << job.gameId << "ply" << job.ply;
+        finishJob(evaluation);
+        return;
+    }
+
+    evaluation.sideToMove = board.getCurrentPlayer();
+    MoveList legalMoves;
+    board.generateLegalMoves(legalMoves);
+    if (legalMoves.size() == 0) {
+        evaluation.valid = true;
+        evaluation.terminal = true;
+        if (board.isInCheck(evaluation.sideToMove)) {
+            evaluation.score = evaluation.sideToMove == PieceColor::White ? -SearchEngine::MATE_SCORE
+                                                                          : SearchEngine::MATE_SCORE;
+        }
+        finishJob(evaluation);
+        return;
+    }
+
+    worker->busy = true;
+    worker->generation = m_generation;
+    worker->evaluation = evaluation;
+    ++m_busyCount;
+
+    if (!job.fen.isEmpty()) {
+        worker->engine->setPosition(ChessEngine::boardToFEN(board));
+    } else {
+        // 同一個引擎常連續分析同一局的相鄰局面，走法列表可以增量更新
+        worker->engine->setPositionFromMoves(job.moves);
+    }
+    worker->job = job;
+    worker->engine->requestMove();
+}
+
+void EnginePool::onAnalysisUpdated(Worker* worker, const QVector<UciInfo>& lines)
+{
+    if (!worker->busy || lines.isEmpty() || !lines[0].hasScore) return;
+
+    const UciInfo& mainLine = lines[0];
+    // 邊界分數（lowerbound / upperbound）只在沒有確切分數時採用
+    if (mainLine.bound != UciInfo::BoundExact && worker->evaluation.valid
+        && worker->evaluation.depth >= mainLine.depth) {
+        return;
+    }
+    const int score = mainLine.searchScore();
+    worker->evaluation.valid = true;
+    worker->evaluation.depth = mainLine.depth;
+    worker->evaluation.score = worker->evaluation.sideToMove == PieceColor::White ? score : -score;
+}
+
+void EnginePool::onBestMove(Worker* worker, const QString& move)
+{
+    if (!worker->busy) return;
+    worker->busy = false;
+    --m_busyCount;
+
+    if (worker->generation != m_generation) {
+        // cancel() 之前的局面：丟棄結果，引擎直接領取下一個工作
+        dispatch();
+        if (isIdle()) emit idle();
+        return;
+    }
+
+    PositionEvaluation evaluation = worker->evaluation;
+    evaluation.bestMove = move;
+    finishJob(evaluation);
+    dispatch();
+}
+
+void EnginePool::onWorkerError(Worker* worker, const QString& error)
+{
+    qWarning() << "Engine pool: engine failed:" << error;
+
+    // 失敗的引擎移出池外，進行中的局面放回佇列最前面交給其他引擎
+    const int index = m_workers.indexOf(worker);
+    if (index < 0) return;
+    m_workers.remove(index);
+    if (worker->busy) {
+        --m_busyCount;
+        if (worker->generation == m_generation) m_queue.prepend(worker->job);
+    }
+    worker->engine->disconnect(this);
+    worker->engine->deleteLater();
+    delete worker;
+
+    if (m_workers.isEmpty()) {
+        m_queue.clear();
+        m_games.clear();
+        emit engineError(error);
+        emit idle();
+        return;
+    }
+    dispatch();
+}
+
+void EnginePool::finishJob(const PositionEvaluation& evaluation)
+{
+    ++m_completed;
+    emit positionEvaluated(evaluation);
+    emit progress(m_completed, m_total, positionsPerSecond());
+
+    auto game = m_games.find(evaluation.gameId);
+    if (game != m_games.end() && evaluation.ply >= 0 && evaluation.ply < game->evaluations.size()) {
+        game->evaluations[evaluation.ply] = evaluation;
+        if (--game->remaining == 0) {
+            const QVector<PositionEvaluation> evaluations = game->evaluations;
+            m_games.erase(game);
+            emit gameAnalyzed(evaluation.gameId, evaluations);
+        }
+    }
+
+    if (isIdle()) {
+        qDebug() << "Engine pool: analyzed" << m_completed << "positions,"
+                 << positionsPerSecond() << "positions/s";
+        emit idle();
+    }
+}
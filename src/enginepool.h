@@ -0,0 +1,120 @@
+#ifndef ENGINEPOOL_H
+#define ENGINEPOOL_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QElapsedTimer>
+#include "chesspiece.h"
+
+class ChessEngine;
+struct UciInfo;
+
+// ===== 引擎池：批次分析用的多個引擎程序 =====
+// 賽後覆盤需要分析大量棋局的每一步，各局面彼此獨立；引擎池同時啟動 N 個 UCI 引擎
+// （每個都是 ChessEngine），以工作佇列分派局面，空閒的引擎立即領取下一個局面。
+// 引擎在工作之間保持執行（雜湊表與程序都不重建），直到 shutdown()
+
+// 一個待分析的局面：fen 不為空時直接分析該局面，否則為起始局面加上 moves
+struct AnalysisJob {
+    int gameId = 0;
+    int ply = 0;                // 已走的半步數（0 為開局局面），與棋步歷史的索引對應
+    QString fen;
+    QStringList moves;
+};
+
+// 一個局面的分析結果；分數一律以白方角度，單位與 SearchEngine 相同（將殺為 ±(MATE_SCORE - 層數)）
+struct PositionEvaluation {
+    int gameId = 0;
+    int ply = 0;
+    bool valid = false;         // 引擎已回報分數（或局面已分出勝負）
+    bool terminal = false;      // 局面已將死或逼和，沒有最佳走法
+    PieceColor sideToMove = PieceColor::White;
+    QString bestMove;           // UCI 格式
+    int depth = 0;
+    int score = 0;
+
+    bool isMate() const;
+    int mateMoves() const;      // 將殺的走步數（正數白方將殺），非將殺時為 0
+};
+
+class EnginePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EnginePool(QObject *parent = nullptr);
+    ~EnginePool();
+
+    // 啟動引擎：engineCount 為 0 時依 QThread::idealThreadCount() / threadsPerEngine 決定，
+    // 讓所有引擎的搜尋執行緒合計剛好用滿 CPU；已啟動的引擎會先關閉
+    bool start(const QString& enginePath, int engineCount = 0, int threadsPerEngine = 1);
+    void shutdown();
+    bool isRunning() const { return !m_workers.isEmpty(); }
+    int engineCount() const { return m_workers.size(); }
+    static int defaultEngineCount(int threadsPerEngine);
+
+    // 每個局面的搜尋限制（套用到所有引擎，下一個局面開始生效）
+    void setSearchDepth(int depth);
+    void setThinkingTime(int milliseconds);
+    void setHashSize(int megabytes);
+
+    // 工作佇列
+    void enqueue(const AnalysisJob& job);
+    void analyzeGame(int gameId, const QStringList& uciMoves, const QString& startFen = QString());
+    void cancel();              // 清空佇列並停止進行中的局面，已取消的結果不再回報
+    bool isIdle() const { return m_queue.isEmpty() && m_busyCount == 0; }
+
+    // 統計
+    int completedCount() const { return m_completed; }
+    int totalCount() const { return m_total; }
+    double positionsPerSecond() const;
+
+signals:
+    void positionEvaluated(const PositionEvaluation& evaluation);
+    // analyzeGame() 的所有局面都完成時發出，evaluations[i] 為走了 i 步之後的局面
+    void gameAnalyzed(int gameId, const QVector<PositionEvaluation>& evaluations);
+    void progress(int completed, int total, double positionsPerSecond);
+    void idle();
+    void engineError(const QString& error);
+
+private:
+    struct Worker {
+        ChessEngine* engine = nullptr;
+        bool ready = false;             // 已收到 engineReady，可以接受局面
+        bool busy = false;
+        int generation = 0;             // 領取工作時的批次編號，與 m_generation 不同表示已被 cancel()
+        AnalysisJob job;
+        PositionEvaluation evaluation;   // 目前局面的最新分數（來自 analysisUpdated 的第一條變例）
+    };
+
+    // analyzeGame() 的結果依局面的半步數收集
+    struct GameProgress {
+        QVector<PositionEvaluation> evaluations;
+        int remaining = 0;
+    };
+
+    QVector<Worker*> m_workers;
+    QList<AnalysisJob> m_queue;
+    QHash<int, GameProgress> m_games;
+    int m_busyCount;
+    int m_completed;
+    int m_total;
+    int m_generation;
+    int m_searchDepth;
+    int m_thinkingTimeMs;
+    int m_hashSizeMb;
+    int m_threadsPerEngine;
+    QElapsedTimer m_timer;      // 佇列由空轉為非空時開始計時
+
+    void dispatch();
+    void startJob(Worker* worker, const AnalysisJob& job);
+    void onAnalysisUpdated(Worker* worker, const QVector<UciInfo>& lines);
+    void onBestMove(Worker* worker, const QString& move);
+    void onWorkerError(Worker* worker, const QString& error);
+    void finishJob(const PositionEvaluation& evaluation);
+};
+
+#endif // ENGINEPOOL_H
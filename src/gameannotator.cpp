@@ -0,0 +1,202 @@
+#include "gameannotator.h"
+#include "chessengine.h"
+#include "searchengine.h"
+#include "uciinfo.h"
+#include <QTimer>
+#include <QDebug>
+#include <cmath>
+
+GameAnnotator::GameAnnotator(QObject *parent)
+    : QObject(parent)
+    , m_pool(new EnginePool(this))
+    , m_gameId(0)
+    , m_searchDepth(16)
+    , m_thinkingTimeMs(500)
+    , m_running(false)
+{
+    connect(m_pool, &EnginePool::positionEvaluated, this, &GameAnnotator::onPositionEvaluated);
+    connect(m_pool, &EnginePool::idle, this, &GameAnnotator::onPoolIdle);
+    connect(m_pool, &EnginePool::engineError, this, &GameAnnotator::onPoolError);
+}
+
+GameAnnotator::~GameAnnotator()
+{
+    m_running = false;
+    m_pool->shutdown();
+}
+
+void GameAnnotator::setMoves(const QStringList& uciMoves)
+{
+    if (uciMoves == m_moves && !m_positions.isEmpty()) return;
+
+    // 走了 i 步之後的局面只取決於前 i 步，相同開頭的局面結果仍然有效
+    int common = 0;
+    while (common < m_moves.size() && common < uciMoves.size() && m_moves[common] == uciMoves[common]) {
+        ++common;
+    }
+    QVector<PositionEvaluation> positions(uciMoves.size() + 1);
+    for (int ply = 0; ply <= common && ply < m_positions.size(); ++ply) {
+        positions[ply] = m_positions[ply];
+    }
+
+    cancel();
+    ++m_gameId;
+    m_moves = uciMoves;
+    m_positions = positions;
+}
+
+void GameAnnotator::clear()
+{
+    cancel();
+    ++m_gameId;
+    m_moves.clear();
+    m_positions.clear();
+}
+
+bool GameAnnotator::start(const QString& enginePath)
+{
+    if (m_running || m_positions.isEmpty() || isComplete()) return false;
+
+    m_pool->setSearchDepth(m_searchDepth);
+    m_pool->setThinkingTime(m_thinkingTimeMs);
+    if (!m_pool->isRunning() && !m_pool->start(enginePath)) {
+        return false;
+    }
+
+    m_running = true;
+    emit progress(evaluatedCount(), positionCount());
+
+    AnalysisJob job;
+    job.gameId = m_gameId;
+    for (int ply = 0; ply < m_positions.size(); ++ply) {
+        if (m_positions[ply].valid) continue;
+        job.ply = ply;
+        job.moves = m_moves.mid(0, ply);
+        m_pool->enqueue(job);
+    }
+    return true;
+}
+
+void GameAnnotator::cancel()
+{
+    if (!m_running) return;
+    m_running = false;
+    // 引擎程序與搜尋執行緒都結束，背景不再佔用 CPU
+    m_pool->cancel();
+    m_pool->shutdown();
+}
+
+int GameAnnotator::evaluatedCount() const
+{
+    int count = 0;
+    for (const PositionEvaluation& position : m_positions) {
+        if (position.valid) ++count;
+    }
+    return count;
+}
+
+MoveEvaluation GameAnnotator::moveEvaluation(int moveIndex) const
+{
+    MoveEvaluation result;
+    if (moveIndex < 0 || moveIndex >= m_moves.size() || moveIndex + 1 >= m_positions.size()) return result;
+
+    const PositionEvaluation& before = m_positions[moveIndex];
+    const PositionEvaluation& after = m_positions[moveIndex + 1];
+    if (after.valid) {
+        result.valid = true;
+        result.score = after.score;
+        result.depth = after.depth;
+    }
+    if (before.valid) {
+        result.bestMove = before.bestMove;
+    }
+    if (before.valid && after.valid) {
+        // 走了引擎的最佳走法時，前後分數的差異只是搜尋深度不同造成的
+        result.quality = before.bestMove == m_moves[moveIndex]
+                       ? MoveEvaluation::Good
+                       : classify(before.score, after.score, before.sideToMove);
+    }
+    return result;
+}
+
+double GameAnnotator::winPercent(int score)
+{
+    int centipawns = score;
+    if (SearchEngine::isMateScore(score)) {
+        centipawns = score > 0 ? MAX_SCORE : -MAX_SCORE;
+    }
+    centipawns = qBound(-MAX_SCORE, centipawns, MAX_SCORE);
+    // 以大量對局擬合的邏輯函數：+1 兵約 59%，+3 兵約 75%
+    return 50.0 + 50.0 * (2.0 / (1.0 + std::exp(-0.00368208 * centipawns)) - 1.0);
+}
+
+MoveEvaluation::Quality GameAnnotator::classify(int scoreBefore, int scoreAfter, PieceColor mover)
+{
+    double drop = winPercent(scoreBefore) - winPercent(scoreAfter);
+    if (mover == PieceColor::Black) drop = -drop;
+
+    if (drop >= BLUNDER_DROP) return MoveEvaluation::Blunder;
+    if (drop >= MISTAKE_DROP) return MoveEvaluation::Mistake;
+    if (drop >= INACCURACY_DROP) return MoveEvaluation::Inaccuracy;
+    return MoveEvaluation::Good;
+}
+
+QString GameAnnotator::formatScore(int score)
+{
+    if (SearchEngine::isMateScore(score)) {
+        UciInfo info;
+        info.setSearchScore(score);
+        return QString("#%1").arg(info.score);
+    }
+    return QString::number(score / 100.0, 'f', 2);
+}
+
+QString GameAnnotator::moveToSan(const ChessBoard& board, const QString& uci)
+{
+    const Move move = ChessEngine::uciToBoardMove(board, uci);
+    if (move.isNull()) return QString();
+
+    // 在副本上走這一步，由棋譜記錄產生記譜（含消歧義、將軍與升變）
+    ChessBoard copy(board);
+    copy.clearMoveHistory();
+    if (!copy.movePiece(move.fromPoint(), move.toPoint())) return QString();
+    if (move.isPromotion()) {
+        copy.promotePawn(move.toPoint(), move.promotionType());
+    }
+    return copy.getMoveNotation(0);
+}
+
+void GameAnnotator::onPositionEvaluated(const PositionEvaluation& evaluation)
+{
+    if (!m_running || evaluation.gameId != m_gameId) return;
+    const int ply = evaluation.ply;
+    if (ply < 0 || ply >= m_positions.size()) return;
+    if (!evaluation.valid) {
+        qWarning() << "Game annotator: no evaluation for ply" << ply;
+        return;
+    }
+
+    m_positions[ply] = evaluation;
+    // 這個局面是上一步走完之後的局面，也是下一步走之前的局面
+    if (ply > 0) emit moveEvaluated(ply - 1, moveEvaluation(ply - 1));
+    if (ply < m_moves.size()) emit moveEvaluated(ply, moveEvaluation(ply));
+    emit progress(evaluatedCount(), positionCount());
+}
+
+void GameAnnotator::onPoolIdle()
+{
+    if (!m_running) return;
+    m_running = false;
+    emit finished(isComplete());
+    // idle 可能由引擎的信號觸發，回到事件迴圈後才關閉引擎
+    QTimer::singleShot(0, this, [this]() {
+        if (!m_running) m_pool->shutdown();
+    });
+}
+
+void GameAnnotator::onPoolError(const QString& error)
+{
+    if (!m_running) return;
+    // 所有引擎都失敗時引擎池會接著發出 idle，由 onPoolIdle 結束這次分析
+    emit engineError(error);
+}
@@ -0,0 +1,80 @@
+#ifndef GAMEANNOTATOR_H
+#define GAMEANNOTATOR_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "chessboard.h"
+#include "enginepool.h"
+
+// ===== 賽後分析：在背景以 EnginePool 評估棋局的每一個局面 =====
+// 局面平行分派給引擎池中的引擎，不阻塞介面；每個局面完成時以 moveEvaluated 回報受影響的走法
+// （走完之後的分數、走之前的最佳走法與失誤分類）。cancel() 只停止分析，已完成的局面保留，
+// 再次 start() 時只分析尚未完成的局面；棋譜改變時只保留與新棋譜相同開頭的部分
+
+class GameAnnotator : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 以行棋方勝率（0-100）下降的百分點分類走法
+    static constexpr double INACCURACY_DROP = 10.0;
+    static constexpr double MISTAKE_DROP = 20.0;
+    static constexpr double BLUNDER_DROP = 30.0;
+    // 換算勝率前分數限制在 ±MAX_SCORE 百分兵（將殺也視為此值），大優時的分數起伏不算失誤
+    static constexpr int MAX_SCORE = 1000;
+
+    explicit GameAnnotator(QObject *parent = nullptr);
+    ~GameAnnotator();
+
+    // 要分析的棋局：由初始局面開始的 UCI 走法
+    void setMoves(const QStringList& uciMoves);
+    const QStringList& moves() const { return m_moves; }
+    void clear();
+
+    // 開始或繼續分析尚未完成的局面；enginePath 與 ChessEngine::startEngine() 相同（可為內建引擎），
+    // 引擎數依 CPU 核心數決定。沒有需要分析的局面或無法啟動引擎時回傳 false
+    bool start(const QString& enginePath);
+    void cancel();              // 停止分析並關閉引擎，已完成的局面保留
+    bool isRunning() const { return m_running; }
+
+    // 每個局面的搜尋限制（下一次 start() 生效）
+    void setSearchDepth(int depth) { m_searchDepth = depth; }
+    void setThinkingTime(int milliseconds) { m_thinkingTimeMs = milliseconds; }
+
+    int positionCount() const { return m_positions.size(); }
+    int evaluatedCount() const;
+    bool isComplete() const { return positionCount() > 0 && evaluatedCount() == positionCount(); }
+    MoveEvaluation moveEvaluation(int moveIndex) const;
+
+    // 勝率（以白方角度的分數換算白方勝率）與分類
+    static double winPercent(int score);
+    static MoveEvaluation::Quality classify(int scoreBefore, int scoreAfter, PieceColor mover);
+    // 分數格式（PGN 的 [%eval]）：以兵為單位到小數兩位，將殺為 #N / #-N
+    static QString formatScore(int score);
+    // 在指定局面把 UCI 走法轉成代數記譜（不合法時回傳空字串）
+    static QString moveToSan(const ChessBoard& board, const QString& uci);
+
+signals:
+    void moveEvaluated(int moveIndex, const MoveEvaluation& evaluation);
+    void progress(int evaluated, int total);
+    // 分析結束（全部完成、或引擎沒有回報部分局面）；cancel() 不發出
+    void finished(bool complete);
+    void engineError(const QString& error);
+
+private:
+    EnginePool* m_pool;
+    QStringList m_moves;
+    QVector<PositionEvaluation> m_positions;    // m_positions[i]：走了 i 步之後的局面
+    int m_gameId;                               // 棋譜改變時遞增，丟棄屬於舊棋譜的結果
+    int m_searchDepth;
+    int m_thinkingTimeMs;
+    bool m_running;
+
+    void onPositionEvaluated(const PositionEvaluation& evaluation);
+    void onPoolIdle();
+    void onPoolError(const QString& error);
+};
+
+#endif // GAMEANNOTATOR_H
@@ -5,6 +5,7 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    Bitboards::initSliderAttacks();  // 建立滑動棋子的攻擊查詢表（只執行一次）
     Qt_Chess w;
     w.showFullScreen();
     return a.exec();
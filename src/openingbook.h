@@ -0,0 +1,54 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "chessmove.h"
+
+class ChessBoard;
+
+// ===== Polyglot 開局庫 =====
+// 讀取 Polyglot 格式的 .bin 開局庫：檔案由 16 位元組的項目組成（大端序的局面鍵 64、走法 16、
+// 權重 16、學習值 32 位元），依局面鍵排序。檔案以 QFile::map 映射到記憶體，查詢時以二分搜尋
+// 找到第一個相符的項目，不需要把整個開局庫讀入記憶體，開啟大型開局庫也不會延遲
+// 局面鍵使用 Polyglot 規格的 781 個固定亂數，與 ChessBoard::hash() 的 Zobrist 鍵不同
+
+struct BookMove {
+    Move move;              // 已轉換為本棋盤的合法走法
+    quint16 weight = 0;
+    quint32 learn = 0;
+};
+
+class OpeningBook {
+public:
+    OpeningBook();
+    ~OpeningBook();
+
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    // 開啟並映射開局庫；已開啟的開局庫會先關閉。檔案大小不是 16 的倍數時視為無效
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const { return m_entries != nullptr; }
+    QString path() const { return m_file.fileName(); }
+    qint64 entryCount() const { return m_entryCount; }
+
+    // 目前局面在開局庫中的所有合法走法（依開局庫中的順序，通常權重由高到低）
+    QVector<BookMove> probe(const ChessBoard& board) const;
+    // 依權重隨機選擇走法：技能等級 0-20，等級越高越集中在權重高的走法；沒有走法時回傳空走法
+    Move pickMove(const ChessBoard& board, int skillLevel) const;
+
+    static quint64 polyglotKey(const ChessBoard& board);
+
+private:
+    QFile m_file;
+    const uchar* m_entries;     // 映射後的檔案內容
+    qint64 m_entryCount;
+
+    qint64 lowerBound(quint64 key) const;
+    static Move decodeMove(const ChessBoard& board, quint16 polyglotMove);
+};
+
+#endif // OPENINGBOOK_H
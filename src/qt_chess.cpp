@@ -1,6 +1,7 @@
 #include "qt_chess.h"
 #include "ui_qt_chess.h"
 #include "chessengine.h"
+#include "difficulty.h"
 #include "soundsettingsdialog.h"
 #include "pieceiconsettingsdialog.h"
 #include "boardcolorsettingsdialog.h"
@@ -15,6 +16,7 @@
 #include <QEvent>
 #include <QResizeEvent>
 #include <QPointer>
+#include <QSignalBlocker>
 #include <QSettings>
 #include <QIcon>
 #include <QPixmap>
@@ -117,15 +119,6 @@ const int NORMAL_PANEL_FALLBACK_HEIGHT = 100;   // 正常面板的後備高度
 // PGN 格式常數
 const int PGN_MOVES_PER_LINE = 6;            // PGN 檔案中每行的移動回合數
 
-// ELO 評分常數（用於難度顯示）
-const int ELO_BASE = 250;                    // 最低 ELO 評分（對應 Skill Level 0）
-const int ELO_PER_LEVEL = 150;               // 每級增加的 ELO 分數（確保結果能被50整除）
-
-// 計算 ELO 評分的輔助函數
-static int calculateElo(int skillLevel) {
-    return ELO_BASE + skillLevel * ELO_PER_LEVEL;
-}
-
 // 根據難度等級取得中文難度名稱
 static QString getDifficultyName(int skillLevel) {
     if (skillLevel <= 4) {        // Level 0-4
@@ -217,6 +210,8 @@ Qt_Chess::Qt_Chess(QWidget *parent)
     , m_moveListWidget(nullptr)
     , m_exportPGNButton(nullptr)
     , m_copyPGNButton(nullptr)
+    , m_annotateButton(nullptr)
+    , m_annotationProgressBar(nullptr)
     , m_moveListPanel(nullptr)
     , m_capturedWhitePanel(nullptr)
     , m_capturedBlackPanel(nullptr)
@@ -232,8 +227,12 @@ Qt_Chess::Qt_Chess(QWidget *parent)
     , m_replayLastButton(nullptr)
     , m_isReplayMode(false)
     , m_replayMoveIndex(-1)
+    , m_replayByUndo(false)
     , m_savedCurrentPlayer(PieceColor::White)
+    , m_savedGameResult(GameResult::InProgress)
+    , m_savedCastlingRights(0)
     , m_chessEngine(nullptr)
+    , m_gameAnnotator(new GameAnnotator(this))
     , m_humanModeButton(nullptr)
     , m_computerModeButton(nullptr)
     , m_gameModeStatusLabel(nullptr)
@@ -246,7 +245,19 @@ Qt_Chess::Qt_Chess(QWidget *parent)
     , m_difficultySlider(nullptr)
     , m_difficultyLabel(nullptr)
     , m_difficultyValueLabel(nullptr)
+    , m_engineOptionsWidget(nullptr)
+    , m_hashSizeSpinBox(nullptr)
+    , m_threadCountSpinBox(nullptr)
+    , m_ponderButton(nullptr)
+    , m_bookButton(nullptr)
+    , m_tablebaseButton(nullptr)
     , m_thinkingLabel(nullptr)
+    , m_analysisPanel(nullptr)
+    , m_analysisStatsLabel(nullptr)
+    , m_analysisListWidget(nullptr)
+    , m_analysisButton(nullptr)
+    , m_multiPvSpinBox(nullptr)
+    , m_analysisUpdatePending(false)
     , m_networkManager(nullptr)
     , m_onlineModeButton(nullptr)
     , m_exitRoomButton(nullptr)
@@ -500,6 +511,26 @@ void Qt_Chess::setupUI() {
     connect(m_copyPGNButton, &QPushButton::clicked, this, &Qt_Chess::onCopyPGNClicked);
     moveListLayout->addWidget(m_copyPGNButton);
 
+    // 賽後分析按鈕與進度條（與 PGN 按鈕一起在遊戲結束時顯示）
+    m_annotateButton = new QPushButton("📊 賽後分析", m_moveListPanel);
+    m_annotateButton->setToolTip("在背景以引擎評估每一步，標記疑問手、錯著與大錯，並寫入匯出的 PGN");
+    m_annotateButton->hide();
+    connect(m_annotateButton, &QPushButton::clicked, this, &Qt_Chess::onAnnotateClicked);
+    moveListLayout->addWidget(m_annotateButton);
+
+    m_annotationProgressBar = new QProgressBar(m_moveListPanel);
+    m_annotationProgressBar->setFormat("%v / %m");
+    m_annotationProgressBar->setAlignment(Qt::AlignCenter);
+    m_annotationProgressBar->hide();
+    moveListLayout->addWidget(m_annotationProgressBar);
+
+    connect(m_gameAnnotator, &GameAnnotator::moveEvaluated, this, &Qt_Chess::onMoveEvaluated);
+    connect(m_gameAnnotator, &GameAnnotator::progress, this, &Qt_Chess::onAnnotationProgress);
+    connect(m_gameAnnotator, &GameAnnotator::finished, this, &Qt_Chess::onAnnotationFinished);
+    connect(m_gameAnnotator, &GameAnnotator::engineError, this, [](const QString& error) {
+        qWarning() << "Game annotation engine error:" << error;
+    });
+
     // 回放控制按鈕標題 - 現代科技風格
     m_replayTitle = new QLabel("🎬 回放控制", m_moveListPanel);
     m_replayTitle->setAlignment(Qt::AlignCenter);
@@ -1233,7 +1264,7 @@ void Qt_Chess::setupTimeControlUI(QVBoxLayout* timeControlPanelLayout) {
     timeControlLayout->addWidget(m_difficultyLabel);
     
     // 初始值為 0（初學者），顯示 ELO 和中文難度名稱
-    int initialElo = calculateElo(0);
+    int initialElo = Difficulty::nominalElo(0);
     QString initialDiffName = getDifficultyName(0);
     m_difficultyValueLabel = new QLabel(QString("%1 (ELO %2)").arg(initialDiffName).arg(initialElo), this);
     m_difficultyValueLabel->setFont(labelFont);
@@ -1251,6 +1282,61 @@ void Qt_Chess::setupTimeControlUI(QVBoxLayout* timeControlPanelLayout) {
     connect(m_difficultySlider, &QSlider::valueChanged, this, &Qt_Chess::onDifficultyChanged);
     timeControlLayout->addWidget(m_difficultySlider);
     
+    // 引擎選項：置換表大小（同時設定外部引擎的 Hash 選項）
+    m_engineOptionsWidget = new QWidget(this);
+    QHBoxLayout* engineOptionsLayout = new QHBoxLayout(m_engineOptionsWidget);
+    engineOptionsLayout->setContentsMargins(0, 0, 0, 0);
+    QLabel* hashSizeLabel = new QLabel("💾 雜湊表:", m_engineOptionsWidget);
+    hashSizeLabel->setFont(labelFont);
+    hashSizeLabel->setStyleSheet(QString("QLabel { color: %1; }").arg(THEME_TEXT_PRIMARY));
+    engineOptionsLayout->addWidget(hashSizeLabel);
+    m_hashSizeSpinBox = new QSpinBox(m_engineOptionsWidget);
+    m_hashSizeSpinBox->setFont(labelFont);
+    m_hashSizeSpinBox->setRange(1, TranspositionTable::MAX_SIZE_MB);
+    m_hashSizeSpinBox->setValue(TranspositionTable::DEFAULT_SIZE_MB);
+    m_hashSizeSpinBox->setSuffix(" MB");
+    m_hashSizeSpinBox->setToolTip("引擎置換表大小，較大的表可減少重複搜尋但佔用更多記憶體");
+    connect(m_hashSizeSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &Qt_Chess::onHashSizeChanged);
+    engineOptionsLayout->addWidget(m_hashSizeSpinBox, 1);
+    
+    QLabel* threadCountLabel = new QLabel("🧵 執行緒:", m_engineOptionsWidget);
+    threadCountLabel->setFont(labelFont);
+    threadCountLabel->setStyleSheet(QString("QLabel { color: %1; }").arg(THEME_TEXT_PRIMARY));
+    engineOptionsLayout->addWidget(threadCountLabel);
+    m_threadCountSpinBox = new QSpinBox(m_engineOptionsWidget);
+    m_threadCountSpinBox->setFont(labelFont);
+    m_threadCountSpinBox->setRange(0, ChessEngine::MAX_THREADS);
+    m_threadCountSpinBox->setValue(0);
+    m_threadCountSpinBox->setSpecialValueText("自動");  // 0 = QThread::idealThreadCount()
+    m_threadCountSpinBox->setToolTip(QString("引擎搜尋使用的執行緒數，自動為本機的 %1 個執行緒")
+                                     .arg(QThread::idealThreadCount()));
+    connect(m_threadCountSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &Qt_Chess::onThreadCountChanged);
+    engineOptionsLayout->addWidget(m_threadCountSpinBox, 1);
+    m_ponderButton = new QPushButton("🤔 預測思考", m_engineOptionsWidget);
+    m_ponderButton->setFont(labelFont);
+    m_ponderButton->setCheckable(true);
+    m_ponderButton->setToolTip("輪到你時引擎先思考預期的回應，猜中時可更快回應");
+    connect(m_ponderButton, &QPushButton::toggled, this, &Qt_Chess::onPonderToggled);
+    engineOptionsLayout->addWidget(m_ponderButton);
+    m_bookButton = new QPushButton("📖 開局庫", m_engineOptionsWidget);
+    m_bookButton->setFont(labelFont);
+    m_bookButton->setCheckable(true);
+    m_bookButton->setToolTip("開局階段從 Polyglot 開局庫（.bin）直接選擇走法，不需等待引擎思考");
+    connect(m_bookButton, &QPushButton::toggled, this, &Qt_Chess::onBookToggled);
+    engineOptionsLayout->addWidget(m_bookButton);
+    m_tablebaseButton = new QPushButton("🗄️ 殘局庫", m_engineOptionsWidget);
+    m_tablebaseButton->setFont(labelFont);
+    m_tablebaseButton->setCheckable(true);
+    m_tablebaseButton->setToolTip("子力少時從 Syzygy 殘局庫（.rtbw / .rtbz）直接選擇走法，並在結果確定時判定勝負");
+    connect(m_tablebaseButton, &QPushButton::toggled, this, &Qt_Chess::onTablebaseToggled);
+#ifndef QT_CHESS_USE_SYZYGY
+    // 未以 CONFIG+=syzygy 建置時殘局庫功能關閉，按鈕保留但不可點選
+    m_tablebaseButton->setEnabled(false);
+    m_tablebaseButton->setToolTip("殘局庫解碼尚未通過驗證，需以 CONFIG+=syzygy 建置才能啟用");
+#endif
+    engineOptionsLayout->addWidget(m_tablebaseButton);
+    timeControlLayout->addWidget(m_engineOptionsWidget);
+    
     // 電腦思考中的提示標籤（初始隱藏）- 簡約風格
     m_thinkingLabel = new QLabel("🔄 電腦思考中...", this);
     m_thinkingLabel->setFont(labelFont);
@@ -1267,12 +1353,53 @@ void Qt_Chess::setupTimeControlUI(QVBoxLayout* timeControlPanelLayout) {
     m_thinkingLabel->hide();
     timeControlLayout->addWidget(m_thinkingLabel);
     
+    // 引擎分析面板：搜尋深度、分數（白方角度）與主要變例，由 ChessEngine::analysisUpdated 更新
+    m_analysisPanel = new QWidget(this);
+    QVBoxLayout* analysisLayout = new QVBoxLayout(m_analysisPanel);
+    analysisLayout->setContentsMargins(0, 0, 0, 0);
+    analysisLayout->setSpacing(4);
+    m_analysisStatsLabel = new QLabel("📈 引擎分析", m_analysisPanel);
+    m_analysisStatsLabel->setFont(labelFont);
+    m_analysisStatsLabel->setStyleSheet(QString("QLabel { color: %1; }").arg(THEME_TEXT_PRIMARY));
+    analysisLayout->addWidget(m_analysisStatsLabel);
+    m_analysisListWidget = new QListWidget(m_analysisPanel);
+    m_analysisListWidget->setWordWrap(true);
+    m_analysisListWidget->setSelectionMode(QAbstractItemView::NoSelection);
+    m_analysisListWidget->setFocusPolicy(Qt::NoFocus);
+    m_analysisListWidget->setMaximumHeight(120);
+    analysisLayout->addWidget(m_analysisListWidget);
+    
+    // 無限分析開關與變例數：開啟後引擎持續分析目前局面（含回放中瀏覽的局面）
+    QHBoxLayout* analysisControlsLayout = new QHBoxLayout();
+    analysisControlsLayout->setContentsMargins(0, 0, 0, 0);
+    m_analysisButton = new QPushButton("🔍 無限分析", m_analysisPanel);
+    m_analysisButton->setFont(labelFont);
+    m_analysisButton->setCheckable(true);
+    m_analysisButton->setToolTip("讓引擎持續分析目前局面，瀏覽棋譜時自動切換到該局面");
+    connect(m_analysisButton, &QPushButton::toggled, this, &Qt_Chess::onAnalysisToggled);
+    analysisControlsLayout->addWidget(m_analysisButton, 1);
+    QLabel* multiPvLabel = new QLabel("變例:", m_analysisPanel);
+    multiPvLabel->setFont(labelFont);
+    multiPvLabel->setStyleSheet(QString("QLabel { color: %1; }").arg(THEME_TEXT_PRIMARY));
+    analysisControlsLayout->addWidget(multiPvLabel);
+    m_multiPvSpinBox = new QSpinBox(m_analysisPanel);
+    m_multiPvSpinBox->setFont(labelFont);
+    m_multiPvSpinBox->setRange(1, ChessEngine::MAX_ANALYSIS_LINES);
+    m_multiPvSpinBox->setValue(3);
+    m_multiPvSpinBox->setToolTip("分析時同時顯示的變例數（MultiPV）");
+    connect(m_multiPvSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &Qt_Chess::onMultiPvChanged);
+    analysisControlsLayout->addWidget(m_multiPvSpinBox);
+    analysisLayout->addLayout(analysisControlsLayout);
+    timeControlLayout->addWidget(m_analysisPanel);
+    
     // 根據初始模式設定難度控制的可見性（預設為雙人模式，隱藏難度控制）
     bool isVsComputer = (m_currentGameMode != GameMode::HumanVsHuman);
     m_colorSelectionWidget->setVisible(isVsComputer);
     m_difficultyLabel->setVisible(isVsComputer);
     m_difficultyValueLabel->setVisible(isVsComputer);
     m_difficultySlider->setVisible(isVsComputer);
+    m_engineOptionsWidget->setVisible(isVsComputer);
+    m_analysisPanel->setVisible(m_currentGameMode != GameMode::OnlineGame);
 
     // 添加伸展以填充群組框中的剩餘空間
     timeControlLayout->addStretch();
@@ -1859,6 +1986,7 @@ void Qt_Chess::resetGameState() {
     if (m_copyPGNButton) {
         m_copyPGNButton->hide();
     }
+    resetGameAnnotation();
     
     // 隱藏玩家顏色指示器
     if (m_playerColorLabel) {
@@ -2006,6 +2134,9 @@ void Qt_Chess::updateBoard() {
     
     // 更新被吃掉的棋子顯示
     updateCapturedPiecesDisplay();
+    
+    // 無限分析跟隨棋盤上的局面
+    scheduleAnalysisUpdate();
 }
 
 void Qt_Chess::updateSquareColor(int displayRow, int displayCol) {
@@ -2075,6 +2206,30 @@ void Qt_Chess::updateStatus() {
         QTimer::singleShot(100, this, [this]() {
             showNonBlockingInfo("遊戲結束", "子力不足以將死！對局和棋。");
         });
+    } else if (m_chessBoard.isThreefoldRepetition()) {
+        m_chessBoard.setGameResult(GameResult::Draw);
+        handleGameEnd();
+        QTimer::singleShot(100, this, [this]() {
+            showNonBlockingInfo("遊戲結束", "同一局面重複三次！對局和棋。");
+        });
+    } else if (m_chessBoard.isFiftyMoveRule()) {
+        m_chessBoard.setGameResult(GameResult::Draw);
+        handleGameEnd();
+        QTimer::singleShot(100, this, [this]() {
+            showNonBlockingInfo("遊戲結束", "五十步內無吃子或兵移動！對局和棋。");
+        });
+    } else if (adjudicateByTablebase(&result)) {
+        m_chessBoard.setGameResult(result);
+        handleGameEnd();
+        QString message = "殘局庫判定：對局和棋。";
+        if (result == GameResult::WhiteWins) {
+            message = "殘局庫判定：白方獲勝！";
+        } else if (result == GameResult::BlackWins) {
+            message = "殘局庫判定：黑方獲勝！";
+        }
+        QTimer::singleShot(100, this, [this, message]() {
+            showNonBlockingInfo("遊戲結束", message);
+        });
     }
 }
 
@@ -2224,32 +2379,36 @@ void Qt_Chess::highlightValidMoves() {
         QString("QPushButton { background-color: #90EE90; border: 3px solid %1; color: %2; }").arg(THEME_ACCENT_PRIMARY, selectedTextColor)
         );
 
-    // 高亮有效的移動
-    for (int logicalRow = 0; logicalRow < 8; ++logicalRow) {
-        for (int logicalCol = 0; logicalCol < 8; ++logicalCol) {
-            QPoint targetSquare(logicalCol, logicalRow);
-            if (m_chessBoard.isValidMove(m_selectedSquare, targetSquare)) {
-                bool isCapture = isCaptureMove(m_selectedSquare, targetSquare);
-                int displayRow = getDisplayRow(logicalRow);
-                int displayCol = getDisplayCol(logicalCol);
-                // 使用邏輯坐標確定淺色/深色格子
-                bool isLight = (logicalRow + logicalCol) % 2 == 0;
-                QString textColor = getPieceTextColor(logicalRow, logicalCol);
-
-                if (isCapture) {
-                    // 將吃子移動高亮為柔和紫色
-                    QString color = isLight ? "#DDA0DD" : "#BA55D3";
-                    m_squares[displayRow][displayCol]->setStyleSheet(
-                        QString("QPushButton { background-color: %1; border: 3px solid %2; color: %3; }").arg(color, THEME_ACCENT_PRIMARY, textColor)
-                        );
-                } else {
-                    // 將非吃子移動高亮為淺藍色
-                    QString color = isLight ? "#B0E0E6" : "#87CEEB";
-                    m_squares[displayRow][displayCol]->setStyleSheet(
-                        QString("QPushButton { background-color: %1; border: 3px solid %2; color: %3; }").arg(color, THEME_ACCENT_SECONDARY, textColor)
-                        );
-                }
-            }
+    // 高亮有效的移動（一次產生所有合法走法，再篩選選中棋子的走法）
+    MoveList legalMoves;
+    m_chessBoard.generateLegalMoves(legalMoves);
+    for (const Move& move : legalMoves) {
+        if (move.fromPoint() != m_selectedSquare) continue;
+        // 升變的四種走法目標格相同，只需高亮一次
+        if (move.isPromotion() && move.promotionType() != PieceType::Queen) continue;
+
+        QPoint targetSquare = move.toPoint();
+        int logicalRow = targetSquare.y();
+        int logicalCol = targetSquare.x();
+        bool isCapture = isCaptureMove(m_selectedSquare, targetSquare);
+        int displayRow = getDisplayRow(logicalRow);
+        int displayCol = getDisplayCol(logicalCol);
+        // 使用邏輯坐標確定淺色/深色格子
+        bool isLight = (logicalRow + logicalCol) % 2 == 0;
+        QString textColor = getPieceTextColor(logicalRow, logicalCol);
+
+        if (isCapture) {
+            // 將吃子移動高亮為柔和紫色
+            QString color = isLight ? "#DDA0DD" : "#BA55D3";
+            m_squares[displayRow][displayCol]->setStyleSheet(
+                QString("QPushButton { background-color: %1; border: 3px solid %2; color: %3; }").arg(color, THEME_ACCENT_PRIMARY, textColor)
+                );
+        } else {
+            // 將非吃子移動高亮為淺藍色
+            QString color = isLight ? "#B0E0E6" : "#87CEEB";
+            m_squares[displayRow][displayCol]->setStyleSheet(
+                QString("QPushButton { background-color: %1; border: 3px solid %2; color: %3; }").arg(color, THEME_ACCENT_SECONDARY, textColor)
+                );
         }
     }
 
@@ -2862,6 +3021,7 @@ void Qt_Chess::onNewGameClicked() {
     // 隱藏匯出 PGN 按鈕和複製棋譜按鈕
     if (m_exportPGNButton) m_exportPGNButton->hide();
     if (m_copyPGNButton) m_copyPGNButton->hide();
+    resetGameAnnotation();
     
     // 隱藏玩家顏色指示器
     if (m_playerColorLabel) m_playerColorLabel->hide();
@@ -3050,6 +3210,7 @@ void Qt_Chess::onExitClicked() {
     // 隱藏匯出 PGN 按鈕和複製棋譜按鈕
     if (m_exportPGNButton) m_exportPGNButton->hide();
     if (m_copyPGNButton) m_copyPGNButton->hide();
+    resetGameAnnotation();
     
     // 隱藏電腦思考標籤
     if (m_thinkingLabel) m_thinkingLabel->hide();
@@ -3162,8 +3323,9 @@ void Qt_Chess::onStartButtonClicked() {
         return;
     }
     
-    // 清空 UCI 移動歷史
+    // 清空 UCI 移動歷史（上一局的賽後分析一併停止）
     m_uciMoveHistory.clear();
+    resetGameAnnotation();
     
     // 通知引擎開始新遊戲
     if (m_chessEngine) {
@@ -3596,6 +3758,100 @@ void Qt_Chess::onCopyPGNClicked() {
     copyPGN();
 }
 
+void Qt_Chess::onAnnotateClicked() {
+    // 分析中再按一次停止；已分析的局面保留，之後再按只分析剩下的局面
+    if (m_gameAnnotator->isRunning()) {
+        m_gameAnnotator->cancel();
+        updateAnnotateButton();
+        return;
+    }
+    
+    if (m_uciMoveHistory.size() != static_cast<int>(m_chessBoard.getMoveHistory().size())) {
+        QMessageBox::warning(this, "賽後分析", "棋譜與走法記錄不一致，無法分析這盤棋");
+        return;
+    }
+    m_gameAnnotator->setMoves(m_uciMoveHistory);
+    
+    // 與電腦對弈使用同一個引擎，找不到外部引擎時使用內建引擎
+    QString enginePath = getEnginePath();
+    if (enginePath != ChessEngine::BUILTIN_ENGINE && (enginePath.isEmpty() || !QFile::exists(enginePath))) {
+        enginePath = ChessEngine::BUILTIN_ENGINE;
+    }
+    if (!m_gameAnnotator->isComplete() && !m_gameAnnotator->start(enginePath)) {
+        QMessageBox::warning(this, "賽後分析", "無法啟動分析引擎");
+    }
+    updateAnnotateButton();
+}
+
+void Qt_Chess::onMoveEvaluated(int moveIndex, const MoveEvaluation& evaluation) {
+    m_chessBoard.setMoveEvaluation(moveIndex, evaluation);
+    
+    // 只更新該步所在的一行，不打斷回放中的選擇與捲動位置
+    if (m_moveListWidget) {
+        QListWidgetItem* item = m_moveListWidget->item(moveIndex / 2);
+        if (item) item->setText(moveListRowText(moveIndex / 2));
+    }
+}
+
+void Qt_Chess::onAnnotationProgress(int evaluated, int total) {
+    if (!m_annotationProgressBar) return;
+    m_annotationProgressBar->setRange(0, total);
+    m_annotationProgressBar->setValue(evaluated);
+    m_annotationProgressBar->show();
+}
+
+void Qt_Chess::onAnnotationFinished(bool complete) {
+    if (!complete) {
+        qWarning() << "Game annotation finished with" << m_gameAnnotator->evaluatedCount()
+                   << "of" << m_gameAnnotator->positionCount() << "positions";
+    }
+    updateAnnotateButton();
+}
+
+void Qt_Chess::resetGameAnnotation() {
+    m_gameAnnotator->clear();
+    if (m_annotateButton) m_annotateButton->hide();
+    if (m_annotationProgressBar) m_annotationProgressBar->hide();
+}
+
+void Qt_Chess::updateAnnotateButton() {
+    if (!m_annotateButton) return;
+    
+    if (m_gameAnnotator->moves().isEmpty()) {
+        m_annotateButton->hide();
+        if (m_annotationProgressBar) m_annotationProgressBar->hide();
+        return;
+    }
+    
+    const int evaluated = m_gameAnnotator->evaluatedCount();
+    if (m_gameAnnotator->isRunning()) {
+        m_annotateButton->setText("⏹ 停止分析");
+    } else if (m_gameAnnotator->isComplete()) {
+        m_annotateButton->setText("✅ 分析完成");
+    } else if (evaluated > 0) {
+        m_annotateButton->setText("▶ 繼續分析");
+    } else {
+        m_annotateButton->setText("📊 賽後分析");
+    }
+    m_annotateButton->setEnabled(!m_gameAnnotator->isComplete() || m_gameAnnotator->isRunning());
+    m_annotateButton->show();
+    
+    if (m_annotationProgressBar) {
+        m_annotationProgressBar->setRange(0, m_gameAnnotator->positionCount());
+        m_annotationProgressBar->setValue(evaluated);
+        m_annotationProgressBar->setVisible(evaluated > 0 || m_gameAnnotator->isRunning());
+    }
+}
+
+QString Qt_Chess::qualitySymbol(MoveEvaluation::Quality quality) {
+    switch (quality) {
+        case MoveEvaluation::Inaccuracy: return "?!";
+        case MoveEvaluation::Mistake:    return "?";
+        case MoveEvaluation::Blunder:    return "??";
+        default:                         return QString();
+    }
+}
+
 void Qt_Chess::onToggleBackgroundMusicClicked() {
     toggleBackgroundMusic();
 }
@@ -4739,6 +4995,9 @@ void Qt_Chess::handleGameEnd() {
         if (m_copyPGNButton) {
             m_copyPGNButton->show();
         }
+        // 賽後分析只用於標準規則的棋局（霧戰不改變走法）
+        m_gameAnnotator->setMoves(m_uciMoveHistory);
+        updateAnnotateButton();
     } else {
         // 其他特殊遊戲模式組合：隱藏 PGN 按鈕
         if (m_exportPGNButton) {
@@ -4747,6 +5006,7 @@ void Qt_Chess::handleGameEnd() {
         if (m_copyPGNButton) {
             m_copyPGNButton->hide();
         }
+        resetGameAnnotation();
     }
 
     // 更新回放按鈕狀態（遊戲結束後可以回放）
@@ -5052,15 +5312,7 @@ void Qt_Chess::updateMoveList() {
 
     // 每兩步組合成一行（白方和黑方）
     for (size_t i = 0; i < moveHistory.size(); i += 2) {
-        int moveNumber = (i / 2) + 1;
-        QString moveText = QString("%1. %2").arg(moveNumber).arg(moveHistory[i].algebraicNotation);
-
-        // 如果有黑方的移動，添加到同一行
-        if (i + 1 < moveHistory.size()) {
-            moveText += QString(" %1").arg(moveHistory[i + 1].algebraicNotation);
-        }
-
-        m_moveListWidget->addItem(moveText);
+        m_moveListWidget->addItem(moveListRowText(static_cast<int>(i / 2)));
     }
 
     // 自動捲動到最新的移動
@@ -5070,6 +5322,23 @@ void Qt_Chess::updateMoveList() {
     updateReplayButtons();
 }
 
+QString Qt_Chess::moveListRowText(int row) const {
+    const int moveCount = static_cast<int>(m_chessBoard.getMoveHistory().size());
+    const int whiteIndex = row * 2;
+    
+    // 賽後分析標記的失誤接在記譜後面（?!、?、??）
+    QString moveText = QString("%1. %2%3").arg(row + 1)
+                           .arg(m_chessBoard.getMoveNotation(whiteIndex))
+                           .arg(qualitySymbol(m_chessBoard.getMoveEvaluation(whiteIndex).quality));
+
+    // 如果有黑方的移動，添加到同一行
+    if (whiteIndex + 1 < moveCount) {
+        moveText += QString(" %1%2").arg(m_chessBoard.getMoveNotation(whiteIndex + 1))
+                                    .arg(qualitySymbol(m_chessBoard.getMoveEvaluation(whiteIndex + 1).quality));
+    }
+    return moveText;
+}
+
 void Qt_Chess::exportPGN() {
     QString pgn = generatePGN();
 
@@ -5126,23 +5395,70 @@ QString Qt_Chess::generatePGN() const {
         PieceColor currentPlayer = m_chessBoard.getCurrentPlayer();
         if (m_chessBoard.isCheckmate(currentPlayer)) {
             result = (currentPlayer == PieceColor::White) ? "0-1" : "1-0";
-        } else if (m_chessBoard.isStalemate(currentPlayer) || m_chessBoard.isInsufficientMaterial()) {
+        } else if (m_chessBoard.isStalemate(currentPlayer) || m_chessBoard.isInsufficientMaterial() ||
+                   m_chessBoard.isThreefoldRepetition() || m_chessBoard.isFiftyMoveRule()) {
             result = "1/2-1/2";
         }
     }
     pgn += QString("[Result \"%1\"]\n\n").arg(result);
 
-    // 移動列表
+    // 賽後分析的結果：失誤以 NAG 標記（$6 ?!、$2 ?、$4 ??），分數（[%eval]）與較佳的走法寫成註解。
+    // 較佳走法的記譜需要走這一步之前的局面，因此同時在另一個棋盤上重播棋局
     const std::vector<MoveRecord>& moveHistory = m_chessBoard.getMoveHistory();
+    bool annotated = false;
+    for (size_t i = 0; i < moveHistory.size() && !annotated; ++i) {
+        annotated = m_chessBoard.getMoveEvaluation(static_cast<int>(i)).valid;
+    }
+    ChessBoard position;
+    auto annotation = [&](int moveIndex) -> QString {
+        const MoveEvaluation evaluation = m_chessBoard.getMoveEvaluation(moveIndex);
+        if (!evaluation.valid) return QString();
+        
+        QString text;
+        QStringList comment;
+        if (!moveHistory[moveIndex].isCheckmate()) {
+            comment << QString("[%eval %1]").arg(GameAnnotator::formatScore(evaluation.score));
+        }
+        QString qualityName;
+        switch (evaluation.quality) {
+            case MoveEvaluation::Inaccuracy: text = " $6"; qualityName = "疑問手"; break;
+            case MoveEvaluation::Mistake:    text = " $2"; qualityName = "錯著"; break;
+            case MoveEvaluation::Blunder:    text = " $4"; qualityName = "大錯"; break;
+            default: break;
+        }
+        if (!qualityName.isEmpty()) {
+            const QString bestMove = GameAnnotator::moveToSan(position, evaluation.bestMove);
+            comment << (bestMove.isEmpty() ? qualityName : QString("%1，最佳走法為 %2").arg(qualityName, bestMove));
+        }
+        if (!comment.isEmpty()) {
+            text += QString(" { %1 }").arg(comment.join(' '));
+        }
+        return text;
+    };
+
+    // 移動列表
     int moveNumber = 1;
+    bool afterComment = false;
     for (size_t i = 0; i < moveHistory.size(); ++i) {
+        const int moveIndex = static_cast<int>(i);
         if (i % 2 == 0) {
             // 白方移動
             if (i > 0) pgn += " ";
-            pgn += QString("%1. %2").arg(moveNumber).arg(moveHistory[i].algebraicNotation);
+            pgn += QString("%1. %2").arg(moveNumber).arg(m_chessBoard.getMoveNotation(moveIndex));
+        } else if (afterComment) {
+            // 白方走法後有註解時，黑方走法需重新標出回合數
+            pgn += QString(" %1... %2").arg(moveNumber).arg(m_chessBoard.getMoveNotation(moveIndex));
         } else {
             // 黑方移動
-            pgn += QString(" %1").arg(moveHistory[i].algebraicNotation);
+            pgn += QString(" %1").arg(m_chessBoard.getMoveNotation(moveIndex));
+        }
+
+        const QString moveAnnotation = annotation(moveIndex);
+        pgn += moveAnnotation;
+        afterComment = moveAnnotation.contains('{');
+        if (annotated) position.makeMove(moveHistory[i].move);
+
+        if (i % 2 == 1) {
             moveNumber++;
 
             // 每 PGN_MOVES_PER_LINE 個回合換行以提高可讀性
@@ -5431,6 +5747,11 @@ void Qt_Chess::enterReplayMode() {
 
     m_isReplayMode = true;
 
+    // 撤銷記錄涵蓋整個棋譜時（未經重力、傳送等外部修改），可直接在目前局面上前後導航
+    int historySize = static_cast<int>(m_chessBoard.getMoveHistory().size());
+    m_replayByUndo = (m_chessBoard.getUndoDepth() == historySize);
+    m_replayMoveIndex = historySize - 1;
+
     // 儲存當前棋盤狀態
     saveBoardState();
 
@@ -5441,10 +5762,23 @@ void Qt_Chess::exitReplayMode() {
     if (!m_isReplayMode) return;
 
     m_isReplayMode = false;
-    m_replayMoveIndex = -1;
 
-    // 恢復棋盤狀態
-    restoreBoardState();
+    if (m_replayByUndo) {
+        // 重做剩餘的棋步回到最新局面（同時還原吃過路兵、被吃棋子與地雷狀態）
+        const std::vector<MoveRecord>& moveHistory = m_chessBoard.getMoveHistory();
+        for (int i = m_replayMoveIndex + 1; i < static_cast<int>(moveHistory.size()); ++i) {
+            m_chessBoard.makeMove(moveHistory[i].move);
+        }
+        // 撤銷會還原到該步之前的結果，需恢復進入回放前由 updateStatus 判定的結果
+        m_chessBoard.setGameResult(m_savedGameResult);
+        updateBoard();
+        clearHighlights();
+    } else {
+        // 恢復棋盤狀態
+        restoreBoardState();
+    }
+    m_replayMoveIndex = -1;
+    m_replayByUndo = false;
 
     // 取消棋譜列表的選擇
     m_moveListWidget->clearSelection();
@@ -5454,8 +5788,7 @@ void Qt_Chess::exitReplayMode() {
 }
 
 void Qt_Chess::replayToMove(int moveIndex) {
-    // 保存移動歷史的副本，因為 initializeBoard() 會清除它
-    std::vector<MoveRecord> moveHistory = m_chessBoard.getMoveHistory();
+    const std::vector<MoveRecord>& moveHistory = m_chessBoard.getMoveHistory();
 
     // 限制索引範圍
     if (moveIndex < -1) moveIndex = -1;
@@ -5463,25 +5796,35 @@ void Qt_Chess::replayToMove(int moveIndex) {
         moveIndex = moveHistory.size() - 1;
     }
 
-    m_replayMoveIndex = moveIndex;
-
-    // 重新初始化棋盤
-    m_chessBoard.initializeBoard();
+    if (m_replayByUndo) {
+        // 從目前回放位置逐步撤銷或重做，不需從初始局面重新下棋
+        while (m_replayMoveIndex > moveIndex) {
+            m_chessBoard.unmakeMove();
+            --m_replayMoveIndex;
+        }
+        while (m_replayMoveIndex < moveIndex) {
+            m_chessBoard.makeMove(moveHistory[++m_replayMoveIndex].move);
+        }
+    } else {
+        // 撤銷記錄不完整（棋盤曾被外部修改）：從初始局面重播
+        // 先移出移動歷史與賽後分析結果（不複製），因為 initializeBoard() 會清除它們
+        std::vector<MoveEvaluation> savedEvaluations;
+        std::vector<MoveRecord> savedHistory = m_chessBoard.takeMoveHistory(&savedEvaluations);
+        m_replayMoveIndex = moveIndex;
 
-    // 重播棋步直到指定的移動
-    for (int i = 0; i <= moveIndex; ++i) {
-        const MoveRecord& move = moveHistory[i];
-        m_chessBoard.movePiece(move.from, move.to);
+        // 重新初始化棋盤
+        m_chessBoard.initializeBoard();
 
-        // 處理升變
-        if (move.isPromotion) {
-            m_chessBoard.promotePawn(move.to, move.promotionType);
+        // 重播棋步直到指定的移動（記錄中的走法已含升變類型，makeMove 不會寫入棋譜）
+        for (int i = 0; i <= moveIndex; ++i) {
+            const MoveRecord& move = savedHistory[i];
+            if (!m_chessBoard.isValidMove(move.from(), move.to())) continue;  // 外部修改後的棋步可能無法重現
+            m_chessBoard.makeMove(move.move);
         }
-    }
 
-    // 恢復移動歷史，因為 movePiece 會記錄新的移動
-    // 我們需要保持原始的移動歷史用於回放
-    m_chessBoard.setMoveHistory(moveHistory);
+        // 放回原始的移動歷史用於回放
+        m_chessBoard.setMoveHistory(std::move(savedHistory), std::move(savedEvaluations));
+    }
 
     // 更新顯示
     updateBoard();
@@ -5605,6 +5948,8 @@ void Qt_Chess::saveBoardState() {
         }
     }
     m_savedCurrentPlayer = m_chessBoard.getCurrentPlayer();
+    m_savedGameResult = m_chessBoard.getGameResult();
+    m_savedCastlingRights = m_chessBoard.castlingRights();
 }
 
 void Qt_Chess::restoreBoardState() {
@@ -5617,8 +5962,10 @@ void Qt_Chess::restoreBoardState() {
         }
     }
 
-    // 恢復當前玩家
+    // 恢復當前玩家、王車易位權與遊戲結果
     m_chessBoard.setCurrentPlayer(m_savedCurrentPlayer);
+    m_chessBoard.setCastlingRights(m_savedCastlingRights);
+    m_chessBoard.setGameResult(m_savedGameResult);
 
     // 更新顯示
     updateBoard();
@@ -5636,15 +5983,34 @@ void Qt_Chess::initializeEngine() {
     connect(m_chessEngine, &ChessEngine::bestMoveFound, this, &Qt_Chess::onEngineBestMove);
     connect(m_chessEngine, &ChessEngine::engineError, this, &Qt_Chess::onEngineError);
     connect(m_chessEngine, &ChessEngine::thinkingStarted, this, [this]() {
-        if (m_thinkingLabel) m_thinkingLabel->show();
+        if (m_thinkingLabel) {
+            m_thinkingLabel->setText("🔄 電腦思考中...");
+            m_thinkingLabel->show();
+        }
     });
     connect(m_chessEngine, &ChessEngine::thinkingStopped, this, [this]() {
         if (m_thinkingLabel) m_thinkingLabel->hide();
     });
+    // 搜尋進度（已合併到約每個畫面一次）
+    connect(m_chessEngine, &ChessEngine::analysisUpdated, this, &Qt_Chess::onEngineAnalysisUpdated);
+    
+    if (m_hashSizeSpinBox) {
+        m_chessEngine->setHashSize(m_hashSizeSpinBox->value());
+    }
+    if (m_threadCountSpinBox) {
+        m_chessEngine->setThreadCount(m_threadCountSpinBox->value());
+    }
+    if (m_ponderButton) {
+        m_chessEngine->setPonderEnabled(m_ponderButton->isChecked());
+    }
+    if (m_multiPvSpinBox) {
+        m_chessEngine->setMultiPv(m_multiPvSpinBox->value());
+    }
     
-    // 嘗試啟動引擎
+    // 嘗試啟動引擎（找不到外部引擎時使用內建引擎）
     QString enginePath = getEnginePath();
-    if (!enginePath.isEmpty() && QFile::exists(enginePath)) {
+    if (enginePath == ChessEngine::BUILTIN_ENGINE
+        || (!enginePath.isEmpty() && QFile::exists(enginePath))) {
         m_chessEngine->startEngine(enginePath);
     }
 }
@@ -5825,8 +6191,8 @@ void Qt_Chess::onBlackColorClicked() {
 void Qt_Chess::onDifficultyChanged(int value) {
     if (!m_difficultyValueLabel || !m_chessEngine) return;
     
-    // 使用輔助函數計算 ELO 評分和中文難度名稱
-    int elo = calculateElo(value);
+    // 計算 ELO 評分和中文難度名稱（ELO、思考時間與搜尋深度的對應見 difficulty.h）
+    int elo = Difficulty::nominalElo(value);
     QString diffName = getDifficultyName(value);
     
     // 更新顯示的難度值（顯示中文難度名稱和 ELO）
@@ -5836,20 +6202,148 @@ void Qt_Chess::onDifficultyChanged(int value) {
     // 更新引擎難度
     m_chessEngine->setDifficulty(value);
     
-    // 根據難度調整思考時間
-    // 較低難度：較短思考時間（最小50ms）；較高難度：較長思考時間
-    int thinkingTime = 50 + (value * 125);  // 50ms 到 2550ms
-    m_chessEngine->setThinkingTime(thinkingTime);
-    
-    // 根據難度調整搜尋深度（與難度綁定）
-    // Level 0 (ELO 250) = depth 1, Level 20 (ELO 3250) = depth 21
-    int depth = 1 + value;  // depth 1-21
-    m_chessEngine->setSearchDepth(depth);
+    // 根據難度調整思考時間與搜尋深度
+    m_chessEngine->setThinkingTime(Difficulty::thinkingTimeMs(value));
+    m_chessEngine->setSearchDepth(Difficulty::searchDepth(value));
     
     // 儲存設定
     saveEngineSettings();
 }
 
+void Qt_Chess::onHashSizeChanged(int megabytes) {
+    if (!m_chessEngine) return;
+    
+    m_chessEngine->setHashSize(megabytes);
+    saveEngineSettings();
+}
+
+void Qt_Chess::onThreadCountChanged(int threads) {
+    if (!m_chessEngine) return;
+    
+    m_chessEngine->setThreadCount(threads);  // 0 = 自動
+    saveEngineSettings();
+}
+
+void Qt_Chess::onPonderToggled(bool enabled) {
+    if (!m_chessEngine) return;
+    
+    m_chessEngine->setPonderEnabled(enabled);
+    saveEngineSettings();
+}
+
+void Qt_Chess::onBookToggled(bool enabled) {
+    if (enabled && !m_openingBook.isOpen() && !loadOpeningBook(true)) {
+        // 沒有可用的開局庫：恢復為關閉
+        QSignalBlocker blocker(m_bookButton);
+        m_bookButton->setChecked(false);
+    }
+    saveEngineSettings();
+}
+
+void Qt_Chess::onTablebaseToggled(bool enabled) {
+    if (enabled && m_tablebase.maxPieces() == 0 && !loadTablebase(true)) {
+        // 沒有可用的殘局庫：恢復為關閉
+        QSignalBlocker blocker(m_tablebaseButton);
+        m_tablebaseButton->setChecked(false);
+    }
+    saveEngineSettings();
+}
+
+void Qt_Chess::onEngineAnalysisUpdated(const QVector<UciInfo>& lines) {
+    if (!m_analysisStatsLabel || !m_analysisListWidget) return;
+    
+    if (lines.isEmpty() || lines[0].depth == 0) {
+        m_analysisStatsLabel->setText("📈 引擎分析");
+        m_analysisListWidget->clear();
+        return;
+    }
+    
+    const UciInfo& mainLine = lines[0];
+    m_analysisStatsLabel->setText(QString("📈 深度 %1/%2 · %3 kN · %4 kN/s")
+                                  .arg(mainLine.depth).arg(mainLine.selDepth)
+                                  .arg(mainLine.nodes / 1000).arg(mainLine.nodesPerSecond / 1000));
+    if (m_thinkingLabel && m_thinkingLabel->isVisible()) {
+        m_thinkingLabel->setText(QString("🔄 電腦思考中... 深度 %1 · %2 kN/s")
+                                 .arg(mainLine.depth).arg(mainLine.nodesPerSecond / 1000));
+    }
+    
+    // 引擎回報行棋方角度的分數，面板統一以白方角度顯示
+    const bool whiteToMove = (m_chessBoard.getCurrentPlayer() == PieceColor::White);
+    int row = 0;
+    for (const UciInfo& line : lines) {
+        if (line.depth == 0) continue;
+        
+        const int score = whiteToMove ? line.score : -line.score;
+        QString text = line.isMate ? QString("#%1").arg(score)
+                                   : QString("%1%2").arg(score >= 0 ? "+" : "").arg(score / 100.0, 0, 'f', 2);
+        if (line.bound != UciInfo::BoundExact) {
+            // 邊界是行棋方角度，換成白方角度時下界與上界互換
+            const bool lower = (line.bound == UciInfo::BoundLower) == whiteToMove;
+            text.prepend(lower ? "≥" : "≤");
+        }
+        text += "  " + line.pv().toString();
+        
+        // 重用既有的列，避免每次更新都重建項目
+        if (row < m_analysisListWidget->count()) {
+            m_analysisListWidget->item(row)->setText(text);
+        } else {
+            m_analysisListWidget->addItem(text);
+        }
+        ++row;
+    }
+    while (m_analysisListWidget->count() > row) {
+        delete m_analysisListWidget->takeItem(m_analysisListWidget->count() - 1);
+    }
+}
+
+void Qt_Chess::onAnalysisToggled(bool enabled) {
+    if (!m_chessEngine) return;
+    
+    if (enabled) {
+        scheduleAnalysisUpdate();
+    } else {
+        m_chessEngine->stopAnalysis();
+    }
+}
+
+void Qt_Chess::onMultiPvChanged(int lines) {
+    if (!m_chessEngine) return;
+    
+    m_chessEngine->setMultiPv(lines);
+    saveEngineSettings();
+}
+
+void Qt_Chess::scheduleAnalysisUpdate() {
+    // 延後到事件迴圈執行：此時 UCI 走法歷史已更新，連續的棋盤更新（快速瀏覽）也只切換一次局面
+    if (m_analysisUpdatePending || !m_analysisButton || !m_analysisButton->isChecked()) return;
+    m_analysisUpdatePending = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_analysisUpdatePending = false;
+        updateAnalysisPosition();
+    });
+}
+
+void Qt_Chess::updateAnalysisPosition() {
+    if (!m_chessEngine || !m_chessEngine->isEngineRunning()) return;
+    if (!m_analysisButton || !m_analysisButton->isChecked() || m_isOnlineGame) {
+        m_chessEngine->stopAnalysis();
+        return;
+    }
+    
+    // 電腦思考走法時不分析；輪到電腦走棋時交給 requestEngineMove，電腦走完後棋盤更新會再次觸發
+    if (m_chessEngine->isThinking()) return;
+    if (m_gameStarted && !m_isReplayMode && isComputerTurn()) {
+        m_chessEngine->stopAnalysis();
+        return;
+    }
+    
+    // 回放時分析正在瀏覽的局面；引擎只在局面改變時才切換搜尋
+    const QStringList moves = m_isReplayMode ? m_uciMoveHistory.mid(0, m_replayMoveIndex + 1)
+                                             : m_uciMoveHistory;
+    m_chessEngine->setPositionFromMoves(moves);
+    m_chessEngine->startAnalysis();
+}
+
 void Qt_Chess::onEngineBestMove(const QString& move) {
     if (move.isEmpty() || !m_gameStarted || m_isReplayMode) return;
     
@@ -5988,16 +6482,105 @@ void Qt_Chess::onEngineError(const QString& error) {
 }
 
 void Qt_Chess::requestEngineMove() {
-    if (!m_chessEngine || !m_chessEngine->isEngineRunning()) return;
     if (!m_gameStarted || m_isReplayMode) return;
     
+    // 開局庫或殘局庫中有走法時直接走，不必等待引擎（引擎仍在啟動中也可以）
+    if (playBookMove()) return;
+    if (playTablebaseMove()) return;
+    
+    if (!m_chessEngine || !m_chessEngine->isEngineRunning()) return;
+    
     // 使用移動歷史設定當前位置
     m_chessEngine->setPositionFromMoves(m_uciMoveHistory);
     
+    // 有時間控制時把雙方目前的棋鐘交給引擎，依剩餘時間與增量分配思考時間（不限時的一方為 0）
+    if (m_timeControlEnabled) {
+        m_chessEngine->setClock(m_whiteTimeMs, m_blackTimeMs, m_incrementMs, m_incrementMs);
+    } else {
+        m_chessEngine->clearClock();
+    }
+    
     // 請求引擎計算最佳走法
     m_chessEngine->requestMove();
 }
 
+bool Qt_Chess::playBookMove() {
+    if (!m_bookButton || !m_bookButton->isChecked() || !m_openingBook.isOpen()) return false;
+    // 特殊模式改變了棋子的移動結果，開局庫的走法不適用
+    if (m_gravityModeEnabled || m_teleportModeEnabled || m_chessBoard.isBombModeEnabled()) return false;
+    
+    // 難度越高越集中在開局庫中權重高的走法
+    const int skillLevel = m_difficultySlider ? m_difficultySlider->value() : 20;
+    const Move move = m_openingBook.pickMove(m_chessBoard, skillLevel);
+    if (move.isNull()) return false;
+    
+    // 引擎可能正在預測思考另一個回應，這一步由開局庫決定，預測思考已無用
+    if (m_chessEngine && m_chessEngine->isPondering()) {
+        m_chessEngine->stop();
+    }
+    
+    const QString uciMove = ChessEngine::moveToUCI(move.fromPoint(), move.toPoint(), move.promotionType());
+    onEngineBestMove(uciMove);
+    return true;
+}
+
+bool Qt_Chess::playTablebaseMove() {
+#ifndef QT_CHESS_USE_SYZYGY
+    // 殘局庫解碼尚未以真實 .rtbw / .rtbz 檔案通過 qt_chess_perft --tablebase-check，預設不以查表結果走棋
+    return false;
+#endif
+    if (!m_tablebaseButton || !m_tablebaseButton->isChecked()) return false;
+    // 殘局庫的走法是完美的，只在完整棋力時使用；較低難度由引擎搜尋（含技能等級的隨機誤差），不會把每個勝局都完美收官
+    const int skillLevel = m_difficultySlider ? m_difficultySlider->value() : ChessEngine::MAX_SKILL_LEVEL;
+    if (skillLevel < ChessEngine::MAX_SKILL_LEVEL) return false;
+    if (m_gravityModeEnabled || m_teleportModeEnabled) return false;
+    // canProbe() 另外排除地雷模式、仍有易位權與棋子數超過殘局庫的局面
+    if (!m_tablebase.canProbe(m_chessBoard)) return false;
+    
+    Move move;
+    WdlScore wdl = WdlScore::Draw;
+    int dtz = 0;
+    if (!m_tablebase.probeRoot(m_chessBoard, &move, &wdl, &dtz)) return false;
+    
+    if (m_chessEngine && m_chessEngine->isPondering()) {
+        m_chessEngine->stop();
+    }
+    
+    const QString uciMove = ChessEngine::moveToUCI(move.fromPoint(), move.toPoint(), move.promotionType());
+    onEngineBestMove(uciMove);
+    return true;
+}
+
+bool Qt_Chess::adjudicateByTablebase(GameResult* result) const {
+#ifndef QT_CHESS_USE_SYZYGY
+    // 同 playTablebaseMove()：解碼未經驗證前不以查表結果判定勝負
+    Q_UNUSED(result);
+    return false;
+#endif
+    // 只判定有電腦參與的對局；雙人與線上對弈由玩家自己下完
+    if (m_currentGameMode != GameMode::HumanVsComputer && m_currentGameMode != GameMode::ComputerVsHuman) return false;
+    if (!m_tablebaseButton || !m_tablebaseButton->isChecked()) return false;
+    if (m_gravityModeEnabled || m_teleportModeEnabled || !m_tablebase.canProbe(m_chessBoard)) return false;
+    
+    WdlScore wdl = WdlScore::Draw;
+    if (!m_tablebase.probeWdl(m_chessBoard, &wdl)) return false;
+    
+    // 本程式執行五十步規則，Cursed / Blessed 的勝負實際上是和棋
+    if (wdl != WdlScore::Win && wdl != WdlScore::Loss) {
+        *result = GameResult::Draw;
+        return true;
+    }
+    
+    // 勝負須在五十步計數到達之前完成；DTZ 可能比實際多一步，無法確定時繼續對局
+    int dtz = 0;
+    if (!m_tablebase.probeDtz(m_chessBoard, &dtz) || qAbs(dtz) + m_chessBoard.getHalfmoveClock() > 99) return false;
+    
+    const bool sideToMoveWins = wdl == WdlScore::Win;
+    const bool whiteToMove = m_chessBoard.getCurrentPlayer() == PieceColor::White;
+    *result = (sideToMoveWins == whiteToMove) ? GameResult::WhiteWins : GameResult::BlackWins;
+    return true;
+}
+
 bool Qt_Chess::isComputerTurn() const {
     if (!m_chessEngine) return false;
     
@@ -6050,6 +6633,12 @@ void Qt_Chess::loadEngineSettings() {
     
     int gameMode = settings.value("gameMode", static_cast<int>(GameMode::HumanVsHuman)).toInt();
     int difficulty = settings.value("difficulty", 0).toInt();  // 預設初學者
+    int hashSize = settings.value("hashSize", TranspositionTable::DEFAULT_SIZE_MB).toInt();
+    int threads = settings.value("threads", 0).toInt();  // 預設自動
+    bool ponder = settings.value("ponder", false).toBool();
+    bool useBook = settings.value("useBook", false).toBool();
+    bool useTablebase = settings.value("useTablebase", false).toBool();
+    int multiPv = settings.value("multiPv", 3).toInt();
     
     // 設定遊戲模式
     m_currentGameMode = static_cast<GameMode>(gameMode);
@@ -6059,6 +6648,28 @@ void Qt_Chess::loadEngineSettings() {
         m_difficultySlider->setValue(difficulty);
         onDifficultyChanged(difficulty);  // 更新顯示（同時設定搜尋深度）
     }
+    
+    if (m_hashSizeSpinBox) {
+        m_hashSizeSpinBox->setValue(hashSize);
+    }
+    if (m_threadCountSpinBox) {
+        m_threadCountSpinBox->setValue(threads);
+    }
+    if (m_ponderButton) {
+        m_ponderButton->setChecked(ponder);
+    }
+    if (m_bookButton) {
+        // 啟動時只從設定或預設位置載入開局庫，不跳出選擇檔案的對話框
+        QSignalBlocker blocker(m_bookButton);
+        m_bookButton->setChecked(useBook && loadOpeningBook(false));
+    }
+    if (m_tablebaseButton && m_tablebaseButton->isEnabled()) {
+        QSignalBlocker blocker(m_tablebaseButton);
+        m_tablebaseButton->setChecked(useTablebase && loadTablebase(false));
+    }
+    if (m_multiPvSpinBox) {
+        m_multiPvSpinBox->setValue(multiPv);
+    }
 }
 
 void Qt_Chess::saveEngineSettings() {
@@ -6069,6 +6680,30 @@ void Qt_Chess::saveEngineSettings() {
     if (m_difficultySlider) {
         settings.setValue("difficulty", m_difficultySlider->value());
     }
+    if (m_hashSizeSpinBox) {
+        settings.setValue("hashSize", m_hashSizeSpinBox->value());
+    }
+    if (m_threadCountSpinBox) {
+        settings.setValue("threads", m_threadCountSpinBox->value());
+    }
+    if (m_ponderButton) {
+        settings.setValue("ponder", m_ponderButton->isChecked());
+    }
+    if (m_bookButton) {
+        settings.setValue("useBook", m_bookButton->isChecked());
+    }
+    if (m_openingBook.isOpen()) {
+        settings.setValue("bookPath", m_openingBook.path());
+    }
+    if (m_tablebaseButton) {
+        settings.setValue("useTablebase", m_tablebaseButton->isChecked());
+    }
+    if (m_tablebase.maxPieces() > 0) {
+        settings.setValue("syzygyPath", m_tablebase.path());
+    }
+    if (m_multiPvSpinBox) {
+        settings.setValue("multiPv", m_multiPvSpinBox->value());
+    }
     
     settings.sync();
 }
@@ -6127,9 +6762,94 @@ QString Qt_Chess::getEnginePath() const {
         }
     }
     
+    // 找不到外部引擎時改用行程內的內建搜尋引擎
+    return ChessEngine::BUILTIN_ENGINE;
+}
+
+QString Qt_Chess::getBookPath() const {
+    // 優先使用上次選擇的開局庫
+    QSettings settings("Qt_Chess", "ChessEngine");
+    QString savedPath = settings.value("bookPath").toString();
+    if (!savedPath.isEmpty() && QFile::exists(savedPath)) {
+        return savedPath;
+    }
+    
+    // 與引擎相同，依序搜尋應用程式目錄、專案與原始碼的 engine 目錄
+    QString appDir = QCoreApplication::applicationDirPath();
+    QStringList candidates;
+    candidates << appDir + "/book.bin"
+               << appDir + "/engine/book.bin"
+               << appDir + "/../engine/book.bin"
+               << appDir + "/../../engine/book.bin";
+    for (const QString& path : candidates) {
+        if (QFile::exists(path)) {
+            return path;
+        }
+    }
     return QString();
 }
 
+bool Qt_Chess::loadOpeningBook(bool askUser) {
+    QString path = getBookPath();
+    if (path.isEmpty() && askUser) {
+        path = QFileDialog::getOpenFileName(this,
+                                            "選擇開局庫",
+                                            QString(),
+                                            "Polyglot 開局庫 (*.bin);;所有檔案 (*)");
+    }
+    if (path.isEmpty()) {
+        return false;
+    }
+    
+    if (!m_openingBook.open(path)) {
+        if (askUser) {
+            QMessageBox::warning(this, "開局庫", QString("無法開啟開局庫：%1").arg(path));
+        }
+        return false;
+    }
+    return true;
+}
+
+QString Qt_Chess::getTablebasePath() const {
+    // 優先使用上次選擇的目錄（可能是以路徑分隔字元連接的多個目錄）
+    QSettings settings("Qt_Chess", "ChessEngine");
+    QString savedPath = settings.value("syzygyPath").toString();
+    if (!savedPath.isEmpty()) {
+        return savedPath;
+    }
+    
+    QString appDir = QCoreApplication::applicationDirPath();
+    QStringList candidates;
+    candidates << appDir + "/syzygy"
+               << appDir + "/engine/syzygy"
+               << appDir + "/../engine/syzygy"
+               << appDir + "/../../engine/syzygy";
+    for (const QString& path : candidates) {
+        if (QDir(path).exists()) {
+            return path;
+        }
+    }
+    return QString();
+}
+
+bool Qt_Chess::loadTablebase(bool askUser) {
+    QString path = getTablebasePath();
+    if (!path.isEmpty()) {
+        m_tablebase.setPath(path);
+    }
+    if (m_tablebase.maxPieces() == 0 && askUser) {
+        path = QFileDialog::getExistingDirectory(this, "選擇 Syzygy 殘局庫目錄");
+        if (path.isEmpty()) {
+            return false;
+        }
+        m_tablebase.setPath(path);
+        if (m_tablebase.maxPieces() == 0) {
+            QMessageBox::warning(this, "殘局庫", QString("目錄中沒有 Syzygy 殘局庫檔案（.rtbw）：%1").arg(path));
+        }
+    }
+    return m_tablebase.maxPieces() > 0;
+}
+
 void Qt_Chess::updateGameModeUI() {
     bool isHumanMode = (m_currentGameMode == GameMode::HumanVsHuman);
     
@@ -6167,6 +6887,8 @@ void Qt_Chess::updateGameModeUI() {
     if (m_difficultyLabel) m_difficultyLabel->setVisible(!isHumanMode);
     if (m_difficultyValueLabel) m_difficultyValueLabel->setVisible(!isHumanMode);
     if (m_difficultySlider) m_difficultySlider->setVisible(!isHumanMode);
+    if (m_engineOptionsWidget) m_engineOptionsWidget->setVisible(!isHumanMode);
+    if (m_analysisPanel) m_analysisPanel->setVisible(m_currentGameMode != GameMode::OnlineGame);
 }
 
 // ============================================================================
@@ -6214,6 +6936,9 @@ void Qt_Chess::onOnlineModeClicked() {
     m_difficultyLabel->hide();
     m_difficultyValueLabel->hide();
     m_difficultySlider->hide();
+    m_engineOptionsWidget->hide();
+    m_analysisPanel->hide();
+    m_analysisButton->setChecked(false);  // 線上對戰不可使用引擎分析
     m_gameModeStatusLabel->hide();
     
     // 停止引擎
@@ -6975,6 +7700,7 @@ void Qt_Chess::onStartGameReceived(int whiteTimeMs, int blackTimeMs, int increme
     m_chessBoard.initializeBoard();
     m_pieceSelected = false;
     m_uciMoveHistory.clear();
+    resetGameAnnotation();
     
     // 啟用地雷模式（如果選擇了踩地雷遊戲模式）
     if (m_selectedGameModes.contains(GAME_MODE_BOMB) && m_selectedGameModes[GAME_MODE_BOMB]) {
@@ -7203,6 +7929,7 @@ void Qt_Chess::onStartGameReceived(int whiteTimeMs, int blackTimeMs, int increme
         if (m_moveListWidget) m_moveListWidget->hide();
         if (m_exportPGNButton) m_exportPGNButton->hide();
         if (m_copyPGNButton) m_copyPGNButton->hide();
+        resetGameAnnotation();
         if (m_replayTitle) m_replayTitle->hide();
         if (m_replayFirstButton) m_replayFirstButton->hide();
         if (m_replayPrevButton) m_replayPrevButton->hide();
@@ -8929,42 +9656,18 @@ void Qt_Chess::calculateVisibleSquares(PieceColor playerColor) {
         }
     }
     
-    // 遍歷所有玩家的棋子
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            const ChessPiece& piece = m_chessBoard.getPiece(row, col);
-            
-            // 如果是玩家的棋子
-            if (piece.getColor() == playerColor && piece.getType() != PieceType::None) {
-                // 該棋子所在的方格可見
-                m_visibleSquares[row][col] = true;
-                
-                // 計算該棋子可以移動到的所有合法位置
-                QPoint from(col, row);
-                
-                // 注意：這裡使用 const_cast 暫時改變當前玩家以檢查該顏色的合法移動。
-                // 這是安全的，因為：
-                // 1. isValidMove() 是 const 方法，不會修改棋盤狀態
-                // 2. 我們立即恢復原來的玩家顏色
-                // 3. 這只用於可見性計算，不影響實際遊戲狀態
-                PieceColor savedPlayer = m_chessBoard.getCurrentPlayer();
-                const_cast<ChessBoard&>(m_chessBoard).setCurrentPlayer(playerColor);
-                
-                for (int targetRow = 0; targetRow < 8; ++targetRow) {
-                    for (int targetCol = 0; targetCol < 8; ++targetCol) {
-                        QPoint to(targetCol, targetRow);
-                        
-                        // 使用 ChessBoard 的 isValidMove 檢查
-                        if (m_chessBoard.isValidMove(from, to)) {
-                            m_visibleSquares[targetRow][targetCol] = true;
-                        }
-                    }
-                }
-                
-                // 恢復原來的玩家
-                const_cast<ChessBoard&>(m_chessBoard).setCurrentPlayer(savedPlayer);
-            }
-        }
+    // 玩家棋子所在的方格可見
+    for (int square : m_chessBoard.pieceList(playerColor)) {
+        m_visibleSquares[Bitboards::rowOf(square)][Bitboards::colOf(square)] = true;
+    }
+    
+    // 玩家所有合法移動的目標格可見
+    // 直接為指定顏色產生走法，不需要暫時切換當前玩家
+    MoveList legalMoves;
+    m_chessBoard.generateLegalMoves(legalMoves, playerColor);
+    for (const Move& move : legalMoves) {
+        QPoint to = move.toPoint();
+        m_visibleSquares[to.y()][to.x()] = true;
     }
     
     // 如果玩家攻擊對方的王，讓對方的王可見
@@ -9032,7 +9735,7 @@ void Qt_Chess::applyGravity() {
         // 從右往左檢查每一列（最右列不需要檢查）
         for (int col = 6; col >= 0; --col) {
             for (int row = 0; row < 8; ++row) {
-                ChessPiece& piece = m_chessBoard.getPiece(row, col);
+                const ChessPiece& piece = m_chessBoard.getPiece(row, col);
                 
                 // 如果這個位置有棋子
                 if (piece.getType() != PieceType::None) {
@@ -9387,27 +10090,20 @@ void Qt_Chess::applyTeleportationAfterGravity() {
 std::vector<QPoint> Qt_Chess::getMovablePieces(PieceColor color) const {
     std::vector<QPoint> movablePieces;
     
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            const ChessPiece& piece = m_chessBoard.getPiece(row, col);
-            if (piece.getType() != PieceType::None && piece.getColor() == color) {
-                QPoint from(col, row);
-                
-                // 檢查這個棋子是否有任何合法移動
-                bool hasValidMove = false;
-                for (int toRow = 0; toRow < 8 && !hasValidMove; ++toRow) {
-                    for (int toCol = 0; toCol < 8 && !hasValidMove; ++toCol) {
-                        QPoint to(toCol, toRow);
-                        if (m_chessBoard.isValidMove(from, to)) {
-                            hasValidMove = true;
-                        }
-                    }
-                }
-                
-                if (hasValidMove) {
-                    movablePieces.push_back(from);
-                }
-            }
+    // 一次產生當前玩家的所有合法走法，收集有合法移動的棋子
+    // 注意：與 isValidMove 相同，只有當前玩家的棋子會被視為可移動
+    MoveList legalMoves;
+    m_chessBoard.generateLegalMoves(legalMoves);
+    
+    Bitboard seen = Bitboards::EMPTY;
+    for (const Move& move : legalMoves) {
+        Bitboard fromMask = Bitboards::squareMask(move.from());
+        if (seen & fromMask) continue;
+        seen |= fromMask;
+        
+        const ChessPiece& piece = m_chessBoard.getPiece(Bitboards::rowOf(move.from()), Bitboards::colOf(move.from()));
+        if (piece.getColor() == color) {
+            movablePieces.push_back(move.fromPoint());
         }
     }
     
@@ -9848,12 +10544,11 @@ bool Qt_Chess::canRollPiece(const QPoint& pos) const {
     }
     
     // 檢查這個棋子是否有任何合法移動
-    for (int toRow = 0; toRow < 8; ++toRow) {
-        for (int toCol = 0; toCol < 8; ++toCol) {
-            QPoint to(toCol, toRow);
-            if (m_chessBoard.isValidMove(pos, to)) {
-                return true;
-            }
+    MoveList legalMoves;
+    m_chessBoard.generateLegalMoves(legalMoves);
+    for (const Move& move : legalMoves) {
+        if (move.fromPoint() == pos) {
+            return true;
         }
     }
     
@@ -19,6 +19,7 @@
 #include <QAction>
 #include <QComboBox>
 #include <QSlider>
+#include <QSpinBox>
 #include <QTimer>
 #include <QRandomGenerator>
 #include <QGroupBox>
@@ -31,6 +32,9 @@
 #include <vector>
 #include "chessboard.h"
 #include "chessengine.h"
+#include "openingbook.h"
+#include "tablebase.h"
+#include "gameannotator.h"
 #include "soundsettingsdialog.h"
 #include "pieceiconsettingsdialog.h"
 #include "boardcolorsettingsdialog.h"
@@ -87,6 +91,7 @@ private slots:
     void onStartButtonClicked();
     void onExportPGNClicked();
     void onCopyPGNClicked();
+    void onAnnotateClicked();
     void onToggleBackgroundMusicClicked();
     void onCheckForUpdatesClicked();
     void onUpdateCheckFinished(bool updateAvailable);
@@ -205,6 +210,8 @@ private:
     QListWidget* m_moveListWidget;
     QPushButton* m_exportPGNButton;
     QPushButton* m_copyPGNButton;
+    QPushButton* m_annotateButton;           // 賽後分析（分析中再按一次停止，之後可以繼續）
+    QProgressBar* m_annotationProgressBar;   // 賽後分析進度（已分析的局面數）
     QWidget* m_moveListPanel;
     
     // ========================================
@@ -228,13 +235,19 @@ private:
     QPushButton* m_replayLastButton;
     bool m_isReplayMode;
     int m_replayMoveIndex;               // 當前回放的棋步索引（-1 表示初始狀態）
+    bool m_replayByUndo;                 // 回放是否以 unmakeMove/makeMove 導航（撤銷記錄完整時）
     std::vector<std::vector<ChessPiece>> m_savedBoardState;  // 儲存進入回放前的棋盤狀態
     PieceColor m_savedCurrentPlayer;     // 儲存進入回放前的當前玩家
+    GameResult m_savedGameResult;        // 儲存進入回放前的遊戲結果
+    quint8 m_savedCastlingRights;        // 儲存進入回放前的王車易位權
     
     // ========================================
     // 電腦對弈系統 (Computer Chess Engine System)
     // ========================================
     ChessEngine* m_chessEngine;
+    OpeningBook m_openingBook;           // Polyglot 開局庫（未開啟時不使用）
+    Tablebase m_tablebase;               // Syzygy 殘局庫（只掃描目錄，查詢時才映射檔案）
+    GameAnnotator* m_gameAnnotator;      // 賽後分析（背景引擎池，結果寫入棋譜）
     QPushButton* m_humanModeButton;      // 雙人對弈按鈕
     QPushButton* m_computerModeButton;   // 電腦對弈按鈕
     QLabel* m_gameModeStatusLabel;       // 顯示電腦模式時的執白/執黑狀態
@@ -246,7 +259,19 @@ private:
     QSlider* m_difficultySlider;
     QLabel* m_difficultyLabel;
     QLabel* m_difficultyValueLabel;
+    QWidget* m_engineOptionsWidget;      // 引擎選項列（置換表大小、執行緒數、預測思考、開局庫、殘局庫）
+    QSpinBox* m_hashSizeSpinBox;         // 置換表 / UCI Hash 大小（MB）
+    QSpinBox* m_threadCountSpinBox;      // 搜尋執行緒數 / UCI Threads（0 = 自動）
+    QPushButton* m_ponderButton;         // 預測思考開關（玩家思考時引擎先搜尋預期的回應）
+    QPushButton* m_bookButton;           // 開局庫開關（開局庫中有走法時不必詢問引擎）
+    QPushButton* m_tablebaseButton;      // 殘局庫開關（子力少時直接查表走棋並判定勝負）
     QLabel* m_thinkingLabel;             // 顯示「電腦思考中...」
+    QWidget* m_analysisPanel;            // 引擎分析面板（線上對戰時隱藏）
+    QLabel* m_analysisStatsLabel;        // 深度、選擇深度、節點數與每秒節點數
+    QListWidget* m_analysisListWidget;   // 每條變例一列：分數與主要變例
+    QPushButton* m_analysisButton;       // 無限分析開關（跟隨目前局面與回放位置）
+    QSpinBox* m_multiPvSpinBox;          // 分析的變例數（MultiPV）
+    bool m_analysisUpdatePending;        // 已排定在事件迴圈中更新分析局面
     QStringList m_uciMoveHistory;        // UCI 格式的移動歷史
     
     // ========================================
@@ -438,6 +463,15 @@ private:
     void copyPGN();
     QString generatePGN() const;
     bool shouldShowPGNFeatures() const;  // 檢查是否應該顯示 PGN 功能（匯出、複製、棋譜列表）
+    QString moveListRowText(int row) const;
+    
+    // 賽後分析：結果以 ChessBoard::setMoveEvaluation() 寫入棋譜，顯示在棋譜列表並寫入 PGN
+    void onMoveEvaluated(int moveIndex, const MoveEvaluation& evaluation);
+    void onAnnotationProgress(int evaluated, int total);
+    void onAnnotationFinished(bool complete);
+    void resetGameAnnotation();          // 停止分析並清除結果（新對局、回到主選單）
+    void updateAnnotateButton();
+    static QString qualitySymbol(MoveEvaluation::Quality quality);
     
     // ========================================
     // 被吃棋子顯示系統 (Captured Pieces Display)
@@ -469,16 +503,33 @@ private:
     void onRandomColorClicked();
     void onBlackColorClicked();
     void onDifficultyChanged(int value);
+    void onHashSizeChanged(int megabytes);
+    void onThreadCountChanged(int threads);
+    void onPonderToggled(bool enabled);
+    void onBookToggled(bool enabled);
+    void onTablebaseToggled(bool enabled);
     void onEngineBestMove(const QString& move);
+    void onEngineAnalysisUpdated(const QVector<UciInfo>& lines);
+    void onAnalysisToggled(bool enabled);
+    void onMultiPvChanged(int lines);
+    void scheduleAnalysisUpdate();
+    void updateAnalysisPosition();
     void onEngineReady();
     void onEngineError(const QString& error);
     void requestEngineMove();
+    bool playBookMove();
+    bool playTablebaseMove();
+    bool adjudicateByTablebase(GameResult* result) const;
     bool isComputerTurn() const;
     bool isPlayerPiece(PieceColor pieceColor) const;
     GameMode getCurrentGameMode() const;
     void loadEngineSettings();
     void saveEngineSettings();
     QString getEnginePath() const;
+    QString getBookPath() const;
+    bool loadOpeningBook(bool askUser);
+    QString getTablebasePath() const;
+    bool loadTablebase(bool askUser);
     void updateGameModeUI();
     
     // ========================================
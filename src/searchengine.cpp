@@ -0,0 +1,784 @@
+#include "searchengine.h"
+#include "chessboard.h"
+#include "transpositiontable.h"
+#include <QRandomGenerator>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// 子力價值（依 PieceType 索引：無、兵、車、馬、象、后、王）
+constexpr int PIECE_VALUES[7] = { 0, 100, 500, 320, 330, 900, 0 };
+// MVV-LVA 的攻擊方排序：價值越低的攻擊方越優先
+constexpr int ATTACKER_RANK[7] = { 0, 1, 4, 2, 3, 5, 6 };
+// 計算對局階段用的子力權重（開局時合計 24，只剩王兵時為 0）
+constexpr int PHASE_WEIGHTS[7] = { 0, 0, 2, 1, 1, 4, 0 };
+constexpr int MAX_PHASE = 24;
+
+// 走法排序分數
+constexpr int PV_MOVE_SCORE = 2000000;
+constexpr int CAPTURE_SCORE = 1000000;
+constexpr int FIRST_KILLER_SCORE = 900000;
+constexpr int SECOND_KILLER_SCORE = 800000;
+
+// 棋子位置表（以白方角度，索引 0 為 a8，與格子索引相同；黑方查表時以 square ^ 56 上下翻轉）
+// 數值取自 Simplified Evaluation Function
+constexpr int PAWN_TABLE[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     10,  10,  20,  30,  30,  20,  10,  10,
+      5,   5,  10,  25,  25,  10,   5,   5,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      5,  -5, -10,   0,   0, -10,  -5,   5,
+      5,  10,  10, -20, -20,  10,  10,   5,
+      0,   0,   0,   0,   0,   0,   0,   0
+};
+
+constexpr int KNIGHT_TABLE[64] = {
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50
+};
+
+constexpr int BISHOP_TABLE[64] = {
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20
+};
+
+constexpr int ROOK_TABLE[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,  10,  10,  10,  10,  10,  10,   5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+      0,   0,   0,   5,   5,   0,   0,   0
+};
+
+constexpr int QUEEN_TABLE[64] = {
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20
+};
+
+constexpr int KING_MIDDLEGAME_TABLE[64] = {
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+     20,  20,   0,   0,   0,   0,  20,  20,
+     20,  30,  10,   0,   0,  10,  30,  20
+};
+
+constexpr int KING_ENDGAME_TABLE[64] = {
+    -50, -40, -30, -20, -20, -30, -40, -50,
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -30,   0,   0,   0,   0, -30, -30,
+    -50, -30, -30, -30, -30, -30, -30, -50
+};
+
+// 依 PieceType 索引的位置表（王另外依對局階段內插）
+constexpr const int* PIECE_TABLES[7] = {
+    nullptr, PAWN_TABLE, ROOK_TABLE, KNIGHT_TABLE, BISHOP_TABLE, QUEEN_TABLE, nullptr
+};
+
+constexpr PieceType NON_KING_TYPES[] = {
+    PieceType::Pawn, PieceType::Knight, PieceType::Bishop, PieceType::Rook, PieceType::Queen
+};
+
+inline PieceType pieceTypeAt(const ChessBoard& board, int square) {
+    return board.getPiece(Bitboards::rowOf(square), Bitboards::colOf(square)).getType();
+}
+
+} // namespace
+
+// 一層反覆加深中各執行緒共用的根節點狀態
+struct SearchEngine::RootSplit {
+    const MoveList* moves;
+    int* scores;
+    int depth;
+    bool exactScores;
+    SearchEngine* owner;           // 主引擎：最佳走法與主要變例寫回這裡
+    std::atomic<int> nextIndex;    // 下一個待搜尋的根節點走法
+    std::atomic<int> alpha;        // 目前最佳分數，各執行緒以它做零窗口驗證
+    std::mutex mutex;              // 保護 bestIndex 與主引擎的主要變例
+    int bestIndex;
+};
+
+// 常駐的輔助執行緒：每層反覆加深只喚醒一次，不再每層建立執行緒與複製棋盤
+struct SearchEngine::HelperPool {
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<ChessBoard>> boards;  // 各輔助執行緒的根局面，每次搜尋開始時同步
+    std::mutex mutex;
+    std::condition_variable wake;   // 分派新的一層或結束
+    std::condition_variable done;   // 輔助執行緒完成本層
+    RootSplit* split = nullptr;
+    quint64 round = 0;              // 每分派一層遞增
+    int running = 0;                // 尚未完成本層的輔助執行緒數
+    bool quit = false;
+};
+
+SearchEngine::SearchEngine()
+    : SearchEngine(nullptr)
+{
+}
+
+SearchEngine::~SearchEngine()
+{
+    stopHelpers();
+}
+
+SearchEngine::SearchEngine(const SearchEngine* parent)
+    : m_tt(nullptr)
+    , m_parent(parent)
+    , m_stopRequested(false)
+    , m_pondering(false)
+    , m_stopped(false)
+    , m_canStop(false)
+    , m_nodes(0)
+    , m_selDepth(0)
+    , m_timeLimitMs(0)
+    , m_previousPvLength(0)
+    , m_followPv(false)
+{
+    std::fill(std::begin(m_pvLength), std::end(m_pvLength), 0);
+}
+
+void SearchEngine::setThreadCount(int threads)
+{
+    const int helperCount = std::max(1, threads) - 1;
+    if (helperCount == static_cast<int>(m_helpers.size())) return;
+
+    stopHelpers();
+    m_helpers.clear();
+    if (helperCount == 0) return;
+
+    m_pool.reset(new HelperPool);
+    for (int i = 0; i < helperCount; ++i) {
+        m_helpers.emplace_back(new SearchEngine(this));
+        m_pool->boards.emplace_back(new ChessBoard);
+    }
+    for (int i = 0; i < helperCount; ++i) {
+        m_pool->threads.emplace_back(&SearchEngine::helperLoop, this, i);
+    }
+}
+
+void SearchEngine::stopHelpers()
+{
+    if (!m_pool) return;
+    {
+        std::lock_guard<std::mutex> lock(m_pool->mutex);
+        m_pool->quit = true;
+    }
+    m_pool->wake.notify_all();
+    for (std::thread& thread : m_pool->threads) {
+        thread.join();
+    }
+    m_pool.reset();
+}
+
+void SearchEngine::helperLoop(int index)
+{
+    HelperPool& pool = *m_pool;
+    SearchEngine* engine = m_helpers[index].get();
+    quint64 seenRound = 0;
+    for (;;) {
+        RootSplit* split;
+        {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.wake.wait(lock, [&pool, seenRound]() { return pool.quit || pool.round != seenRound; });
+            if (pool.quit) return;
+            seenRound = pool.round;
+            split = pool.split;
+        }
+        // 搜尋中斷時 makeMove 也都已還原，根局面在下一層仍然有效
+        engine->searchRootMoves(*pool.boards[index], *split);
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            --pool.running;
+        }
+        pool.done.notify_one();
+    }
+}
+
+void SearchEngine::prepareHelpers(const ChessBoard& board)
+{
+    // 輔助執行緒停在條件變數上，分派第一層時的鎖確保它們看到新的根局面
+    if (m_pool) {
+        for (auto& helperBoard : m_pool->boards) {
+            *helperBoard = board;
+        }
+    }
+    for (auto& helper : m_helpers) {
+        helper->m_tt = m_tt;
+        helper->m_timer = m_timer;
+        helper->m_timeLimitMs = m_timeLimitMs;
+        helper->m_nodes = 0;
+        helper->m_selDepth = 0;
+        helper->m_stopped = false;
+        helper->m_canStop = false;
+        helper->m_previousPvLength = 0;
+        helper->m_followPv = false;
+        for (auto& killers : helper->m_killers) {
+            killers[0] = killers[1] = Move();
+        }
+    }
+}
+
+quint64 SearchEngine::totalNodes() const
+{
+    quint64 nodes = m_nodes;
+    for (const auto& helper : m_helpers) {
+        nodes += helper->m_nodes;
+    }
+    return nodes;
+}
+
+int SearchEngine::maxSelDepth() const
+{
+    int selDepth = m_selDepth;
+    for (const auto& helper : m_helpers) {
+        selDepth = std::max(selDepth, helper->m_selDepth);
+    }
+    return selDepth;
+}
+
+int SearchEngine::scoreToTable(int score, int ply)
+{
+    if (score > MATE_BOUND) return score + ply;
+    if (score < -MATE_BOUND) return score - ply;
+    return score;
+}
+
+int SearchEngine::scoreFromTable(int score, int ply)
+{
+    if (score > MATE_BOUND) return score - ply;
+    if (score < -MATE_BOUND) return score + ply;
+    return score;
+}
+
+int SearchEngine::evaluate(const ChessBoard& board)
+{
+    int score = 0;
+    int kingMiddlegame = 0;
+    int kingEndgame = 0;
+    int phase = 0;
+
+    for (PieceColor color : { PieceColor::White, PieceColor::Black }) {
+        const int sign = (color == PieceColor::White) ? 1 : -1;
+        const int flip = (color == PieceColor::White) ? 0 : 56;
+
+        for (PieceType type : NON_KING_TYPES) {
+            const int t = static_cast<int>(type);
+            Bitboard pieces = board.pieceBitboard(type, color);
+            phase += PHASE_WEIGHTS[t] * Bitboards::popCount(pieces);
+            while (pieces) {
+                int square = Bitboards::popLsb(pieces);
+                score += sign * (PIECE_VALUES[t] + PIECE_TABLES[t][square ^ flip]);
+            }
+        }
+
+        // 炸彈模式下王可能已被炸毀
+        int king = board.kingSquare(color);
+        if (king != Bitboards::NO_SQUARE) {
+            kingMiddlegame += sign * KING_MIDDLEGAME_TABLE[king ^ flip];
+            kingEndgame += sign * KING_ENDGAME_TABLE[king ^ flip];
+        }
+    }
+
+    phase = std::min(phase, MAX_PHASE);
+    score += (kingMiddlegame * phase + kingEndgame * (MAX_PHASE - phase)) / MAX_PHASE;
+
+    return board.getCurrentPlayer() == PieceColor::White ? score : -score;
+}
+
+SearchResult SearchEngine::search(ChessBoard& board, const SearchLimits& limits,
+                                  const IterationCallback& onIteration)
+{
+    m_timer.start();
+    m_stopped = false;
+    m_canStop = false;
+    m_nodes = 0;
+    m_selDepth = 0;
+    m_timeLimitMs = limits.timeMs;
+    m_pvLength[0] = 0;
+    m_previousPvLength = 0;
+    m_followPv = false;
+    for (auto& killers : m_killers) {
+        killers[0] = killers[1] = Move();
+    }
+    prepareHelpers(board);
+
+    SearchResult result;
+    MoveList rootMoves;
+    board.generateLegalMoves(rootMoves);
+    if (rootMoves.isEmpty()) return result;
+
+    // 根節點走法：置換表走法優先，其餘以 MVV-LVA 排序；之後每層把最佳走法移到最前面
+    Move tableMove;
+    TranspositionTable::Entry entry;
+    if (m_tt && m_tt->probe(board.hash(), entry)) tableMove = entry.move;
+    int rootScores[MoveList::MAX_MOVES];
+    scoreMoves(board, rootMoves, rootScores, tableMove, 0);
+    for (int i = 0; i < rootMoves.size(); ++i) {
+        pickNextMove(rootMoves, rootScores, i);
+    }
+    result.bestMove = rootMoves[0];
+
+    // 降低棋力與多條變例都需要每個根節點走法的確切分數，根節點改用完整窗口搜尋
+    const bool weakened = limits.skillLevel < 20 && rootMoves.size() > 1;
+    const int multiPv = qBound(1, limits.multiPv, rootMoves.size());
+    m_rootPvs.clear();
+    if (multiPv > 1) m_rootPvs.resize(rootMoves.size());
+    const int maxDepth = qBound(1, limits.maxDepth, MAX_PLY - 1);
+    // 目標時間只決定是否開始下一層；進行中的一層在 timeMs 時才強制中斷
+    const qint64 targetTimeMs = limits.optimumTimeMs > 0 ? limits.optimumTimeMs : limits.timeMs;
+    int completedScores[MoveList::MAX_MOVES];
+
+    for (int depth = 1; depth <= maxDepth; ++depth) {
+        std::copy(m_pv[0], m_pv[0] + m_pvLength[0], m_previousPv);
+        m_previousPvLength = m_pvLength[0];
+
+        int score = searchRoot(board, rootMoves, rootScores, depth, weakened || multiPv > 1);
+        if (m_stopped) break;  // 未完成的一層不採用
+
+        std::copy(rootScores, rootScores + rootMoves.size(), completedScores);
+        result.bestMove = rootMoves[0];
+        result.score = score;
+        result.depth = depth;
+        result.selDepth = maxSelDepth();
+        result.nodes = totalNodes();
+        result.elapsedMs = m_timer.elapsed();
+        result.pv.assign(m_pv[0], m_pv[0] + m_pvLength[0]);
+        result.lines.clear();
+        for (int i = 0; i < static_cast<int>(m_rootPvs.size()) && i < multiPv; ++i) {
+            result.lines.push_back({ rootScores[i], m_rootPvs[i] });
+        }
+        m_canStop = true;
+        if (m_tt) {
+            m_tt->store(board.hash(), result.bestMove, scoreToTable(score, 0),
+                        TranspositionTable::NO_EVAL, depth, TranspositionTable::BoundExact);
+        }
+        if (onIteration) onIteration(result);
+
+        // 只有一個合法走法、已找到搜尋範圍內的將殺，或剩餘的目標時間不足以完成下一層時提前結束
+        if (rootMoves.size() == 1) break;
+        if (isMateScore(score) && MATE_SCORE - qAbs(score) <= depth) break;
+        if (targetTimeMs > 0 && !isPondering() && result.elapsedMs * 2 >= targetTimeMs) break;
+    }
+
+    if (weakened && result.depth > 0) {
+        // 每個走法的分數加上 0 ~ (20 - 等級) * 15 百分兵的隨機誤差後取最高者
+        const int margin = (20 - limits.skillLevel) * 15;
+        int bestIndex = 0;
+        int bestNoisy = -INFINITE_SCORE * 2;
+        for (int i = 0; i < rootMoves.size(); ++i) {
+            int noisy = completedScores[i] + static_cast<int>(QRandomGenerator::global()->bounded(margin + 1));
+            if (noisy > bestNoisy) {
+                bestNoisy = noisy;
+                bestIndex = i;
+            }
+        }
+        result.bestMove = rootMoves[bestIndex];
+        result.score = completedScores[bestIndex];
+    }
+
+    result.nodes = totalNodes();
+    result.elapsedMs = m_timer.elapsed();
+    return result;
+}
+
+int SearchEngine::searchRoot(ChessBoard& board, MoveList& rootMoves, int* rootScores, int depth, bool exactScores)
+{
+    m_pvLength[0] = 0;
+    ++m_nodes;
+
+    // 第一個走法（上一層的最佳走法）以完整窗口搜尋，沿著上一層的主要變例
+    const Move firstMove = rootMoves[0];
+    m_followPv = true;
+    board.makeMove(firstMove);
+    const int firstScore = -negamax(board, depth - 1, 1, -INFINITE_SCORE, INFINITE_SCORE);
+    board.unmakeMove();
+    if (m_stopped) return 0;
+    rootScores[0] = firstScore;
+    updatePv(0, firstMove);
+    if (!m_rootPvs.empty()) {
+        m_rootPvs[0].assign(m_pv[0], m_pv[0] + m_pvLength[0]);
+    }
+
+    RootSplit split;
+    split.moves = &rootMoves;
+    split.scores = rootScores;
+    split.depth = depth;
+    split.exactScores = exactScores;
+    split.owner = this;
+    split.nextIndex.store(1);
+    split.alpha.store(firstScore);
+    split.bestIndex = 0;
+
+    // 其餘走法由主執行緒與各輔助執行緒（各自使用自己的根局面）依序領取
+    const bool useHelpers = m_pool && rootMoves.size() > 2;
+    if (useHelpers) {
+        std::lock_guard<std::mutex> lock(m_pool->mutex);
+        for (auto& helper : m_helpers) {
+            helper->m_canStop = m_canStop;
+        }
+        m_pool->split = &split;
+        m_pool->running = static_cast<int>(m_helpers.size());
+        ++m_pool->round;
+    }
+    if (useHelpers) m_pool->wake.notify_all();
+    searchRootMoves(board, split);
+    if (useHelpers) {
+        std::unique_lock<std::mutex> lock(m_pool->mutex);
+        m_pool->done.wait(lock, [this]() { return m_pool->running == 0; });
+    }
+
+    for (const auto& helper : m_helpers) {
+        if (helper->m_stopped) m_stopped = true;
+    }
+    if (m_stopped) return 0;
+
+    if (!m_rootPvs.empty()) {
+        // MultiPV：依分數穩定排序所有根節點走法，前幾個即為各條變例，下一層也依此順序搜尋
+        for (int i = 1; i < rootMoves.size(); ++i) {
+            for (int j = i; j > 0 && rootScores[j] > rootScores[j - 1]; --j) {
+                std::swap(rootMoves[j], rootMoves[j - 1]);
+                std::swap(rootScores[j], rootScores[j - 1]);
+                std::swap(m_rootPvs[j], m_rootPvs[j - 1]);
+            }
+        }
+        // 同分時排序結果可能與各執行緒更新的最佳走法不同，以排序後的第一條為準
+        m_pvLength[0] = static_cast<int>(m_rootPvs[0].size());
+        std::copy(m_rootPvs[0].begin(), m_rootPvs[0].end(), m_pv[0]);
+        return rootScores[0];
+    }
+
+    // 將最佳走法移到最前面，其餘走法維持原本順序
+    const int bestIndex = split.bestIndex;
+    std::rotate(rootMoves.begin(), rootMoves.begin() + bestIndex, rootMoves.begin() + bestIndex + 1);
+    std::rotate(rootScores, rootScores + bestIndex, rootScores + bestIndex + 1);
+    return split.alpha.load();
+}
+
+void SearchEngine::searchRootMoves(ChessBoard& board, RootSplit& split)
+{
+    const int count = split.moves->size();
+    for (int index = split.nextIndex.fetch_add(1); index < count; index = split.nextIndex.fetch_add(1)) {
+        const Move move = (*split.moves)[index];
+        const int alpha = split.alpha.load();
+        m_followPv = false;
+
+        board.makeMove(move);
+        int score;
+        if (split.exactScores) {
+            // 降低棋力時需要每個走法的確切分數
+            score = -negamax(board, split.depth - 1, 1, -INFINITE_SCORE, INFINITE_SCORE);
+        } else {
+            // 零窗口驗證是否優於目前最佳走法，失敗高時才以完整窗口重新搜尋
+            score = -negamax(board, split.depth - 1, 1, -alpha - 1, -alpha);
+            if (score > alpha && !m_stopped) {
+                score = -negamax(board, split.depth - 1, 1, -INFINITE_SCORE, -alpha);
+            }
+        }
+        board.unmakeMove();
+        if (m_stopped) return;
+
+        split.scores[index] = score;
+        std::lock_guard<std::mutex> lock(split.mutex);
+        if (!split.owner->m_rootPvs.empty()) {
+            std::vector<Move>& linePv = split.owner->m_rootPvs[index];
+            linePv.assign(1, move);
+            linePv.insert(linePv.end(), m_pv[1] + 1, m_pv[1] + m_pvLength[1]);
+        }
+        if (score > split.alpha.load()) {
+            split.alpha.store(score);
+            split.bestIndex = index;
+            // 主要變例：此走法接上本執行緒在第 1 層得到的變例
+            SearchEngine* owner = split.owner;
+            owner->m_pv[0][0] = move;
+            for (int i = 1; i < m_pvLength[1]; ++i) {
+                owner->m_pv[0][i] = m_pv[1][i];
+            }
+            owner->m_pvLength[0] = std::max(m_pvLength[1], 1);
+        }
+    }
+}
+
+int SearchEngine::negamax(ChessBoard& board, int depth, int ply, int alpha, int beta)
+{
+    m_pvLength[ply] = ply;
+    const bool onPv = m_followPv;
+    m_followPv = false;
+
+    if (board.isFiftyMoveRule() || board.repetitionCount() >= 2 || board.isInsufficientMaterial()) {
+        return 0;
+    }
+    if (ply >= MAX_PLY - 1) return evaluate(board);
+
+    const bool inCheck = board.isInCheck(board.getCurrentPlayer());
+    if (inCheck) ++depth;  // 被將軍時延伸一層，避免在水平線上漏看將殺
+    if (depth <= 0) return quiescence(board, ply, alpha, beta);
+
+    ++m_nodes;
+    if (shouldStop()) return 0;
+
+    // 將殺距離剪枝：已知更短的將殺時不必再搜尋
+    alpha = std::max(alpha, -MATE_SCORE + ply);
+    beta = std::min(beta, MATE_SCORE - ply - 1);
+    if (alpha >= beta) return alpha;
+
+    // 置換表：零窗口節點可直接使用足夠深的結果，主要變例節點只取走法以保留完整的變例
+    const bool pvNode = beta - alpha > 1;
+    const int originalAlpha = alpha;
+    const quint64 key = board.hash();
+    Move tableMove;
+    if (m_tt) {
+        TranspositionTable::Entry entry;
+        if (m_tt->probe(key, entry)) {
+            tableMove = entry.move;
+            if (!pvNode && entry.depth >= depth) {
+                const int tableScore = scoreFromTable(entry.score, ply);
+                if (entry.bound == TranspositionTable::BoundExact
+                    || (entry.bound == TranspositionTable::BoundLower && tableScore >= beta)
+                    || (entry.bound == TranspositionTable::BoundUpper && tableScore <= alpha)) {
+                    return tableScore;
+                }
+            }
+        }
+    }
+
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    if (moves.isEmpty()) {
+        return inCheck ? -MATE_SCORE + ply : 0;
+    }
+
+    const Move pvMove = (onPv && ply < m_previousPvLength) ? m_previousPv[ply] : Move();
+    int scores[MoveList::MAX_MOVES];
+    scoreMoves(board, moves, scores, pvMove.isNull() ? tableMove : pvMove, ply);
+
+    int bestScore = -INFINITE_SCORE;
+    Move bestMove;
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = pickNextMove(moves, scores, i);
+        m_followPv = onPv && move == pvMove;
+
+        board.makeMove(move);
+        int score;
+        if (i == 0) {
+            score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
+        } else {
+            score = -negamax(board, depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta && !m_stopped) {
+                score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
+            }
+        }
+        board.unmakeMove();
+        if (m_stopped) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                updatePv(ply, move);
+                if (alpha >= beta) {
+                    if (!move.isCapture() && !move.isPromotion()) storeKiller(ply, move);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (m_tt) {
+        const TranspositionTable::Bound bound = bestScore >= beta ? TranspositionTable::BoundLower
+            : (bestScore > originalAlpha ? TranspositionTable::BoundExact : TranspositionTable::BoundUpper);
+        m_tt->store(key, bestMove, scoreToTable(bestScore, ply), TranspositionTable::NO_EVAL, depth, bound);
+    }
+    return bestScore;
+}
+
+int SearchEngine::quiescence(ChessBoard& board, int ply, int alpha, int beta)
+{
+    m_pvLength[ply] = ply;
+    ++m_nodes;
+    if (ply > m_selDepth) m_selDepth = ply;
+    if (shouldStop()) return 0;
+    if (ply >= MAX_PLY - 1) return evaluate(board);
+
+    const bool pvNode = beta - alpha > 1;
+    const int originalAlpha = alpha;
+    const quint64 key = board.hash();
+    TranspositionTable::Entry entry;
+    const bool tableHit = m_tt && m_tt->probe(key, entry);
+    if (tableHit && !pvNode) {
+        const int tableScore = scoreFromTable(entry.score, ply);
+        if (entry.bound == TranspositionTable::BoundExact
+            || (entry.bound == TranspositionTable::BoundLower && tableScore >= beta)
+            || (entry.bound == TranspositionTable::BoundUpper && tableScore <= alpha)) {
+            return tableScore;
+        }
+    }
+
+    // 未被將軍時可選擇不吃子（stand pat）；被將軍時必須搜尋所有應將走法
+    const bool inCheck = board.isInCheck(board.getCurrentPlayer());
+    int bestScore = -INFINITE_SCORE;
+    int staticEval = TranspositionTable::NO_EVAL;
+    if (!inCheck) {
+        staticEval = (tableHit && entry.eval != TranspositionTable::NO_EVAL) ? entry.eval : evaluate(board);
+        bestScore = staticEval;
+        if (bestScore >= beta) {
+            if (m_tt && !tableHit) {
+                m_tt->store(key, Move(), scoreToTable(bestScore, ply), staticEval, 0, TranspositionTable::BoundLower);
+            }
+            return bestScore;
+        }
+        if (bestScore > alpha) alpha = bestScore;
+    }
+
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    if (moves.isEmpty()) {
+        return inCheck ? -MATE_SCORE + ply : 0;
+    }
+
+    int scores[MoveList::MAX_MOVES];
+    scoreMoves(board, moves, scores, tableHit ? entry.move : Move(), ply);
+
+    Move bestMove;
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = pickNextMove(moves, scores, i);
+        if (!inCheck) {
+            // 只搜尋吃子與升后
+            bool queenPromotion = move.promotionType() == PieceType::Queen;
+            if (!move.isCapture() && !queenPromotion) continue;
+            if (move.isPromotion() && !queenPromotion) continue;
+        }
+
+        board.makeMove(move);
+        int score = -quiescence(board, ply + 1, -beta, -alpha);
+        board.unmakeMove();
+        if (m_stopped) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+
+    if (m_tt) {
+        const TranspositionTable::Bound bound = bestScore >= beta ? TranspositionTable::BoundLower
+            : (bestScore > originalAlpha ? TranspositionTable::BoundExact : TranspositionTable::BoundUpper);
+        m_tt->store(key, bestMove, scoreToTable(bestScore, ply), staticEval, 0, bound);
+    }
+    return bestScore;
+}
+
+void SearchEngine::scoreMoves(const ChessBoard& board, const MoveList& moves, int* scores, Move pvMove, int ply) const
+{
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = moves[i];
+        int score = 0;
+        if (move == pvMove && !pvMove.isNull()) {
+            score = PV_MOVE_SCORE;
+        } else if (move.isCapture() || move.promotionType() == PieceType::Queen) {
+            // MVV-LVA：先吃價值高的棋子，同一目標以價值低的攻擊方優先
+            score = CAPTURE_SCORE;
+            if (move.isCapture()) {
+                PieceType victim = move.isEnPassant() ? PieceType::Pawn : pieceTypeAt(board, move.to());
+                PieceType attacker = pieceTypeAt(board, move.from());
+                score += PIECE_VALUES[static_cast<int>(victim)] * 8 - ATTACKER_RANK[static_cast<int>(attacker)];
+            }
+            if (move.isPromotion()) {
+                score += PIECE_VALUES[static_cast<int>(PieceType::Queen)] * 8;
+            }
+        } else if (move == m_killers[ply][0]) {
+            score = FIRST_KILLER_SCORE;
+        } else if (move == m_killers[ply][1]) {
+            score = SECOND_KILLER_SCORE;
+        } else if (move.isPromotion()) {
+            score = -1;  // 低升變排在最後
+        }
+        scores[i] = score;
+    }
+}
+
+Move SearchEngine::pickNextMove(MoveList& moves, int* scores, int index)
+{
+    // 選擇排序的一步：找出剩餘走法中分數最高者並交換到 index，剪枝時不必排序整個列表
+    int best = index;
+    for (int i = index + 1; i < moves.size(); ++i) {
+        if (scores[i] > scores[best]) best = i;
+    }
+    if (best != index) {
+        std::swap(moves[index], moves[best]);
+        std::swap(scores[index], scores[best]);
+    }
+    return moves[index];
+}
+
+void SearchEngine::updatePv(int ply, Move move)
+{
+    m_pv[ply][ply] = move;
+    for (int i = ply + 1; i < m_pvLength[ply + 1]; ++i) {
+        m_pv[ply][i] = m_pv[ply + 1][i];
+    }
+    m_pvLength[ply] = std::max(m_pvLength[ply + 1], ply + 1);
+}
+
+void SearchEngine::storeKiller(int ply, Move move)
+{
+    if (m_killers[ply][0] != move) {
+        m_killers[ply][1] = m_killers[ply][0];
+        m_killers[ply][0] = move;
+    }
+}
+
+bool SearchEngine::shouldStop()
+{
+    if (m_stopped) return true;
+    // 每 2048 個節點檢查一次時間與外部停止要求
+    if ((m_nodes & 2047) != 0 || !m_canStop) return false;
+    if (m_stopRequested.load(std::memory_order_relaxed)
+        || (m_parent && m_parent->m_stopRequested.load(std::memory_order_relaxed))
+        || (m_timeLimitMs > 0 && !isPondering() && m_timer.elapsed() >= m_timeLimitMs)) {
+        m_stopped = true;
+    }
+    return m_stopped;
+}
+
+bool SearchEngine::isPondering() const
+{
+    const SearchEngine* root = m_parent ? m_parent : this;
+    return root->m_pondering.load(std::memory_order_relaxed);
+}
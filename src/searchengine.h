@@ -0,0 +1,135 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "chessmove.h"
+
+class ChessBoard;
+class TranspositionTable;
+
+// ===== 內建搜尋引擎 =====
+// 不需外部 UCI 程式的行程內搜尋：反覆加深 + 主要變例搜尋（PVS）的 alpha-beta、
+// 靜態搜尋（quiescence）處理吃子序列，走法以置換表走法、MVV-LVA 與殺手走法排序
+// 只依賴 QtCore 與規則核心，可在工作執行緒上執行；stop() 可從任何執行緒呼叫
+// 多執行緒時採根節點分割：第一個根節點走法由呼叫端執行緒搜尋以建立 alpha，
+// 其餘走法再分給各執行緒（各自持有根局面，每次搜尋同步一次），並共用無鎖置換表
+// 輔助執行緒在 setThreadCount() 時建立，搜尋之間停在條件變數上，每層反覆加深時喚醒
+
+struct SearchLimits {
+    int maxDepth = 1;       // 最大搜尋深度（層）
+    int timeMs = 0;         // 思考時間上限（毫秒），0 表示只受深度限制
+    int optimumTimeMs = 0;  // 目標思考時間（有棋鐘時由 TimeManager 分配），0 表示以 timeMs 為目標
+    int skillLevel = 20;    // 0-20，低於 20 時在根節點加入隨機誤差以降低棋力
+    int multiPv = 1;        // 回報的變例數；大於 1 時每個根節點走法都以完整窗口搜尋
+};
+
+struct SearchLine {
+    int score = 0;
+    std::vector<Move> pv;   // 第一步為此變例的根節點走法
+};
+
+struct SearchResult {
+    Move bestMove;
+    int score = 0;          // 以行棋方角度的分數（百分兵），將殺為 ±(MATE_SCORE - 步數)
+    int depth = 0;          // 已完成的搜尋深度
+    int selDepth = 0;       // 含延伸與靜態搜尋的最大深度
+    quint64 nodes = 0;
+    qint64 elapsedMs = 0;
+    std::vector<Move> pv;   // 主要變例（第一步為 bestMove；降低棋力時可能不同）
+    std::vector<SearchLine> lines;  // multiPv > 1 時依分數排列的前幾條變例，第一條即主要變例
+
+    quint64 nodesPerSecond() const {
+        return elapsedMs > 0 ? nodes * 1000 / static_cast<quint64>(elapsedMs) : nodes;
+    }
+};
+
+class SearchEngine {
+public:
+    static constexpr int MAX_PLY = 64;
+    static constexpr int INFINITE_SCORE = 32500;
+    static constexpr int MATE_SCORE = 32000;
+    static constexpr int MATE_BOUND = MATE_SCORE - MAX_PLY;  // 超過此值的分數代表將殺
+
+    // 每完成一層反覆加深時呼叫（在搜尋執行緒上）
+    using IterationCallback = std::function<void(const SearchResult&)>;
+
+    SearchEngine();
+    ~SearchEngine();
+
+    // 使用外部擁有的置換表（可為 nullptr）；同一張表可由多個 SearchEngine 同時使用
+    void setTranspositionTable(TranspositionTable* table) { m_tt = table; }
+    TranspositionTable* transpositionTable() const { return m_tt; }
+
+    // 搜尋執行緒數（含呼叫 search() 的執行緒）；不可在搜尋進行中呼叫
+    void setThreadCount(int threads);
+    int threadCount() const { return static_cast<int>(m_helpers.size()) + 1; }
+
+    // 搜尋過程中會 makeMove / unmakeMove，返回時棋盤還原為原局面
+    SearchResult search(ChessBoard& board, const SearchLimits& limits,
+                        const IterationCallback& onIteration = IterationCallback());
+    // 停止要求會保留到 clearStop()，因此在搜尋執行緒真正開始前呼叫 stop() 也不會遺失
+    void stop() { m_stopRequested.store(true, std::memory_order_relaxed); }
+    void clearStop() { m_stopRequested.store(false, std::memory_order_relaxed); }
+    // 預測思考：設定後的搜尋不受時間限制（深度限制與 stop() 仍有效），直到 setPondering(false)，
+    // 之後時間仍從搜尋開始時起算。與 stop() 相同可從任何執行緒呼叫，須在搜尋開始前設定
+    void setPondering(bool pondering) { m_pondering.store(pondering, std::memory_order_relaxed); }
+
+    // 靜態評估：子力 + 棋子位置表，王的位置表依剩餘子力在中局與殘局之間內插；以行棋方角度回傳
+    static int evaluate(const ChessBoard& board);
+    static bool isMateScore(int score) { return score > MATE_BOUND || score < -MATE_BOUND; }
+
+    // 置換表中的將殺分數以「距離此局面的步數」儲存，讀寫時依目前步數換算
+    static int scoreToTable(int score, int ply);
+    static int scoreFromTable(int score, int ply);
+
+private:
+    struct RootSplit;
+    struct HelperPool;
+
+    explicit SearchEngine(const SearchEngine* parent);
+    void prepareHelpers(const ChessBoard& board);
+    void stopHelpers();
+    void helperLoop(int index);
+    void searchRootMoves(ChessBoard& board, RootSplit& split);
+    quint64 totalNodes() const;
+    int maxSelDepth() const;
+
+    int searchRoot(ChessBoard& board, MoveList& rootMoves, int* rootScores, int depth, bool exactScores);
+    int negamax(ChessBoard& board, int depth, int ply, int alpha, int beta);
+    int quiescence(ChessBoard& board, int ply, int alpha, int beta);
+
+    void scoreMoves(const ChessBoard& board, const MoveList& moves, int* scores, Move pvMove, int ply) const;
+    static Move pickNextMove(MoveList& moves, int* scores, int index);
+    void updatePv(int ply, Move move);
+    void storeKiller(int ply, Move move);
+    bool shouldStop();
+    bool isPondering() const;
+
+    TranspositionTable* m_tt;
+    const SearchEngine* m_parent;                        // 輔助執行緒的引擎指向主引擎（共用停止要求）
+    std::vector<std::unique_ptr<SearchEngine>> m_helpers;
+    std::unique_ptr<HelperPool> m_pool;                  // 輔助執行緒與其根局面（沒有輔助執行緒時為空）
+    std::atomic<bool> m_stopRequested;
+    std::atomic<bool> m_pondering;                       // 輔助執行緒的引擎讀取主引擎的值
+    bool m_stopped;
+    bool m_canStop;          // 第一層完成前不中斷，確保一定有可用的走法
+    quint64 m_nodes;
+    int m_selDepth;
+    qint64 m_timeLimitMs;
+    QElapsedTimer m_timer;
+
+    Move m_pv[MAX_PLY][MAX_PLY];  // 三角形主要變例表
+    int m_pvLength[MAX_PLY];
+    Move m_previousPv[MAX_PLY];   // 上一層反覆加深的主要變例，本層優先沿著它搜尋
+    int m_previousPvLength;
+    bool m_followPv;
+    Move m_killers[MAX_PLY][2];
+    std::vector<std::vector<Move>> m_rootPvs;  // MultiPV：每個根節點走法各自的主要變例（與根節點走法同序）
+};
+
+#endif // SEARCHENGINE_H
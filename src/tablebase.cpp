@@ -0,0 +1,1064 @@
+#include "tablebase.h"
+#include "chessboard.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+// 座標與棋子編碼沿用 Syzygy 檔案的慣例（與本專案的棋盤不同）：
+// 格子 0 = a1、63 = h8（第 1 橫列在最下方）；棋子 1-6 為白兵、馬、象、車、后、王，黑方再加 8
+
+namespace {
+
+constexpr int TB_PIECES = Tablebase::MAX_PIECES;
+constexpr int MAX_DTZ = 1 << 18;
+
+enum TableFlag : quint8 {
+    FlagStm = 1,
+    FlagMapped = 2,
+    FlagWinPlies = 4,
+    FlagLossPlies = 8,
+    FlagWide = 16,
+    FlagSingleValue = 128
+};
+
+// 檔案第一個位元組
+enum HeaderFlag : quint8 {
+    HeaderSplit = 1,
+    HeaderHasPawns = 2
+};
+
+const uchar WDL_MAGIC[4] = { 0x71, 0xE8, 0x23, 0x5D };
+const uchar DTZ_MAGIC[4] = { 0xD7, 0x66, 0x0C, 0xA5 };
+
+inline int fileOf(int square) { return square & 7; }
+inline int rankOf(int square) { return square >> 3; }
+inline int flipFile(int square) { return square ^ 7; }
+inline int flipRank(int square) { return square ^ 56; }
+// 正數表示在 a1-h8 對角線上方，0 表示在對角線上
+inline int offA1H8(int square) { return rankOf(square) - fileOf(square); }
+inline int signOf(int value) { return (value > 0) - (value < 0); }
+
+// 索引計算用的對照表，第一次使用時建立
+struct EncodingTables {
+    int mapB1H1H7[64];          // 對角線下方的格子 → 0..27
+    int mapA1D1D4[64];          // a1-d1-d4 三角形 → 0..9（對角線上的格子排在最後）
+    int mapKK[10][64];          // 兩個國王的 462 種合法配置
+    int mapPawns[64];           // a2-h7 → 0..47，值越大越靠近邊線與底線
+    quint64 binomial[6][64];    // binomial[k][n] = C(n, k)
+    int leadPawnIdx[6][64];
+    int leadPawnsSize[6][4];
+
+    EncodingTables()
+    {
+        std::fill(&mapB1H1H7[0], &mapB1H1H7[0] + 64, 0);
+        std::fill(&mapA1D1D4[0], &mapA1D1D4[0] + 64, 0);
+        std::fill(&mapKK[0][0], &mapKK[0][0] + 10 * 64, 0);
+        std::fill(&mapPawns[0], &mapPawns[0] + 64, 0);
+        std::fill(&binomial[0][0], &binomial[0][0] + 6 * 64, 0);
+        std::fill(&leadPawnIdx[0][0], &leadPawnIdx[0][0] + 6 * 64, 0);
+        std::fill(&leadPawnsSize[0][0], &leadPawnsSize[0][0] + 6 * 4, 0);
+
+        int code = 0;
+        for (int s = 0; s < 64; ++s) {
+            if (offA1H8(s) < 0) mapB1H1H7[s] = code++;
+        }
+
+        std::vector<int> diagonal;
+        code = 0;
+        for (int s = 0; s <= 27; ++s) {   // a1 .. d4
+            if (offA1H8(s) < 0 && fileOf(s) <= 3) {
+                mapA1D1D4[s] = code++;
+            } else if (offA1H8(s) == 0 && fileOf(s) <= 3) {
+                diagonal.push_back(s);
+            }
+        }
+        for (int s : diagonal) mapA1D1D4[s] = code++;
+
+        // 第一個國王在 a1-d1-d4 三角形；在對角線上時第二個國王不得在對角線上方
+        std::vector<std::pair<int, int>> bothOnDiagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; ++idx) {
+            for (int s1 = 0; s1 <= 27; ++s1) {
+                if (mapA1D1D4[s1] != idx || (idx == 0 && s1 != 1)) continue;   // b1 編碼為 0
+                for (int s2 = 0; s2 < 64; ++s2) {
+                    const bool adjacent = qAbs(fileOf(s1) - fileOf(s2)) <= 1 && qAbs(rankOf(s1) - rankOf(s2)) <= 1;
+                    if (adjacent) continue;
+                    if (offA1H8(s1) == 0 && offA1H8(s2) > 0) continue;
+                    if (offA1H8(s1) == 0 && offA1H8(s2) == 0) {
+                        bothOnDiagonal.emplace_back(idx, s2);
+                    } else {
+                        mapKK[idx][s2] = code++;
+                    }
+                }
+            }
+        }
+        for (const auto& p : bothOnDiagonal) mapKK[p.first][p.second] = code++;
+
+        binomial[0][0] = 1;
+        for (int n = 1; n < 64; ++n) {
+            for (int k = 0; k < 6 && k <= n; ++k) {
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0)
+                               + (k < n ? binomial[k][n - 1] : 0);
+            }
+        }
+
+        // 領頭兵的編碼：同一直行的表格分開儲存，因此每個直行的索引從 0 開始
+        int availableSquares = 47;
+        for (int leadPawnsCnt = 1; leadPawnsCnt <= 5; ++leadPawnsCnt) {
+            for (int f = 0; f < 4; ++f) {
+                int idx = 0;
+                for (int r = 1; r <= 6; ++r) {
+                    const int sq = r * 8 + f;
+                    if (leadPawnsCnt == 1) {
+                        mapPawns[sq] = availableSquares--;
+                        mapPawns[flipFile(sq)] = availableSquares--;
+                    }
+                    leadPawnIdx[leadPawnsCnt][sq] = idx;
+                    idx += static_cast<int>(binomial[leadPawnsCnt - 1][mapPawns[sq]]);
+                }
+                leadPawnsSize[leadPawnsCnt][f] = idx;
+            }
+        }
+    }
+};
+
+const EncodingTables& encoding()
+{
+    static const EncodingTables tables;
+    return tables;
+}
+
+// 子力特徵：每個（顏色、兵種）的數量佔 4 位元；兵種順序為兵、馬、象、車、后、王
+quint64 materialSignature(const int counts[2][6])
+{
+    quint64 signature = 0;
+    for (int color = 0; color < 2; ++color) {
+        for (int type = 0; type < 6; ++type) {
+            signature |= static_cast<quint64>(counts[color][type] & 0xF) << (4 * (color * 6 + type));
+        }
+    }
+    return signature;
+}
+
+quint64 swapColors(quint64 signature)
+{
+    return (signature >> 24) | ((signature & 0xFFFFFF) << 24);
+}
+
+// 檔名中一方的棋子：K、Q、R、B、N、P 依序
+QString sideCode(const int counts[6])
+{
+    static const char letters[] = { 'P', 'N', 'B', 'R', 'Q', 'K' };
+    QString code;
+    for (int type = 5; type >= 0; --type) {
+        for (int i = 0; i < counts[type]; ++i) code += QChar(letters[type]);
+    }
+    return code;
+}
+
+bool parseSideCode(const QString& code, int counts[6])
+{
+    std::fill(counts, counts + 6, 0);
+    for (const QChar c : code) {
+        switch (c.toUpper().toLatin1()) {
+            case 'P': ++counts[0]; break;
+            case 'N': ++counts[1]; break;
+            case 'B': ++counts[2]; break;
+            case 'R': ++counts[3]; break;
+            case 'Q': ++counts[4]; break;
+            case 'K': ++counts[5]; break;
+            default: return false;
+        }
+    }
+    return counts[5] == 1;
+}
+
+int typeIndex(PieceType type)
+{
+    switch (type) {
+        case PieceType::Pawn:   return 0;
+        case PieceType::Knight: return 1;
+        case PieceType::Bishop: return 2;
+        case PieceType::Rook:   return 3;
+        case PieceType::Queen:  return 4;
+        case PieceType::King:   return 5;
+        default:                return -1;
+    }
+}
+
+// 以檔案慣例表示的局面
+struct TbPosition {
+    int pieceOn[64];        // 0 為空格
+    int stm;                // 0 白方、1 黑方
+    int pieceCount;
+    quint64 signature;
+};
+
+void loadPosition(const ChessBoard& board, TbPosition& pos)
+{
+    int counts[2][6] = {};
+    pos.pieceCount = 0;
+    for (int row = 0; row < 8; ++row) {
+        for (int col = 0; col < 8; ++col) {
+            const int square = (7 - row) * 8 + col;
+            const ChessPiece& piece = board.getPiece(row, col);
+            const int type = typeIndex(piece.getType());
+            if (type < 0) {
+                pos.pieceOn[square] = 0;
+                continue;
+            }
+            const int color = piece.getColor() == PieceColor::White ? 0 : 1;
+            pos.pieceOn[square] = (type + 1) + color * 8;
+            ++counts[color][type];
+            ++pos.pieceCount;
+        }
+    }
+    pos.stm = board.getCurrentPlayer() == PieceColor::White ? 0 : 1;
+    pos.signature = materialSignature(counts);
+}
+
+inline quint16 readLe16(const uchar* p) { return qFromLittleEndian<quint16>(p); }
+inline quint32 readLe32(const uchar* p) { return qFromLittleEndian<quint32>(p); }
+inline quint32 readBe32(const uchar* p) { return qFromBigEndian<quint32>(p); }
+inline quint64 readBe64(const uchar* p) { return qFromBigEndian<quint64>(p); }
+
+inline int dtzBeforeZeroing(WdlScore wdl)
+{
+    switch (wdl) {
+        case WdlScore::Win:         return 1;
+        case WdlScore::CursedWin:   return 101;
+        case WdlScore::BlessedLoss: return -101;
+        case WdlScore::Loss:        return -1;
+        default:                    return 0;
+    }
+}
+
+inline WdlScore negate(WdlScore wdl) { return static_cast<WdlScore>(-static_cast<int>(wdl)); }
+
+bool isPawnMove(const ChessBoard& board, Move move)
+{
+    return board.getPiece(move.fromPoint().y(), move.fromPoint().x()).getType() == PieceType::Pawn;
+}
+
+} // namespace
+
+enum class Tablebase::ProbeState {
+    Fail,
+    Ok,
+    ChangeStm,          // DTZ 表只存另一方行棋的局面
+    ZeroingBestMove     // 最佳走法是吃子或兵移動，DTZ 表中的值不可用
+};
+
+// 一組以遞迴配對（Recursive Pairing）+ 正規 Huffman 編碼壓縮的數值
+struct Tablebase::PairsData {
+    quint8 flags = 0;
+    quint64 sizeofBlock = 0;
+    quint64 span = 0;
+    quint32 numBlocks = 0;
+    int maxSymLen = 0;
+    int minSymLen = 0;              // SingleValue 時存放唯一的值
+    const uchar* lowestSym = nullptr;
+    std::vector<quint64> base64;
+    std::vector<quint8> symlen;
+    const uchar* btree = nullptr;   // 每個符號 3 位元組：左右子符號各 12 位元
+    quint64 sparseIndexSize = 0;
+    const uchar* sparseIndex = nullptr;   // 每項 6 位元組：區塊 32 位元、偏移 16 位元
+    quint64 blockLengthSize = 0;
+    const uchar* blockLength = nullptr;
+    const uchar* data = nullptr;
+    int pieces[TB_PIECES] = {};
+    quint64 groupIdx[TB_PIECES + 1] = {};
+    int groupLen[TB_PIECES + 1] = {};
+    quint16 mapIdx[4] = {};         // DTZ：各 WDL 結果的數值對照表位置
+
+    quint16 left(int sym) const {
+        const uchar* lr = btree + 3 * sym;
+        return static_cast<quint16>(((lr[1] & 0xF) << 8) | lr[0]);
+    }
+    quint16 right(int sym) const {
+        const uchar* lr = btree + 3 * sym;
+        return static_cast<quint16>((lr[2] << 4) | (lr[1] >> 4));
+    }
+};
+
+struct Tablebase::TableFile {
+    QFile file;
+    const uchar* base = nullptr;
+    qint64 size = 0;
+    std::atomic<bool> ready{false};     // 已成功映射並解析
+    bool tried = false;                 // 已嘗試開啟（失敗時不再重試）
+    PairsData items[2][4];              // [行棋方][領頭兵直行 a-d]
+    const uchar* dtzMap = nullptr;
+
+    PairsData* get(int stm, int file, bool hasPawns, int sides) {
+        return &items[stm % sides][hasPawns ? file : 0];
+    }
+};
+
+struct Tablebase::Table {
+    QString name;
+    quint64 key = 0;        // 檔名中前一方為白方時的子力特徵
+    quint64 key2 = 0;       // 前一方為黑方時的子力特徵
+    int pieceCount = 0;
+    bool hasPawns = false;
+    bool hasUniquePieces = false;
+    int pawnCount[2] = {};  // [領頭方][另一方]
+    TableFile wdl;
+    TableFile dtz;
+};
+
+namespace {
+
+quint8 setSymlen(Tablebase::PairsData* d, int s, std::vector<bool>& visited)
+{
+    visited[s] = true;   // 配對樹沒有迴圈，可以先標記
+    const int sr = d->right(s);
+    if (sr == 0xFFF) return 0;
+    const int sl = d->left(s);
+    if (sl >= static_cast<int>(d->symlen.size()) || sr >= static_cast<int>(d->symlen.size())) return 0;
+    if (!visited[sl]) d->symlen[sl] = setSymlen(d, sl, visited);
+    if (!visited[sr]) d->symlen[sr] = setSymlen(d, sr, visited);
+    return static_cast<quint8>(d->symlen[sl] + d->symlen[sr] + 1);
+}
+
+const uchar* setSizes(Tablebase::PairsData* d, const uchar* data)
+{
+    d->flags = *data++;
+
+    if (d->flags & FlagSingleValue) {
+        d->numBlocks = 0;
+        d->blockLengthSize = 0;
+        d->span = 0;
+        d->sparseIndexSize = 0;
+        d->minSymLen = *data++;   // 整張表只有這一個值
+        return data;
+    }
+
+    // groupLen[] 以 0 結尾，對應的 groupIdx[] 即為表的大小
+    int groups = 0;
+    while (groups < TB_PIECES && d->groupLen[groups]) ++groups;
+    const quint64 tbSize = d->groupIdx[groups];
+
+    d->sizeofBlock = 1ULL << *data++;
+    d->span = 1ULL << *data++;
+    d->sparseIndexSize = (tbSize + d->span - 1) / d->span;
+    const int padding = *data++;
+    d->numBlocks = readLe32(data);
+    data += 4;
+    d->blockLengthSize = d->numBlocks + padding;   // 補齊，使稀疏索引不會指到範圍外
+    d->maxSymLen = *data++;
+    d->minSymLen = *data++;
+    d->lowestSym = data;
+    d->base64.assign(qMax(0, d->maxSymLen - d->minSymLen + 1), 0);
+
+    // 正規 Huffman 碼：較長的碼數值較小；由 lowestSym 推出每種長度補齊到 64 位元後的下界
+    for (int i = static_cast<int>(d->base64.size()) - 2; i >= 0; --i) {
+        d->base64[i] = (d->base64[i + 1] + readLe16(d->lowestSym + 2 * i)
+                        - readLe16(d->lowestSym + 2 * (i + 1))) / 2;
+    }
+    for (size_t i = 0; i < d->base64.size(); ++i) {
+        d->base64[i] <<= 64 - i - d->minSymLen;
+    }
+
+    data += d->base64.size() * 2;
+    d->symlen.assign(readLe16(data), 0);
+    data += 2;
+    d->btree = data;
+
+    std::vector<bool> visited(d->symlen.size());
+    for (size_t sym = 0; sym < d->symlen.size(); ++sym) {
+        if (!visited[sym]) d->symlen[sym] = setSymlen(d, static_cast<int>(sym), visited);
+    }
+    return data + d->symlen.size() * 3 + (d->symlen.size() & 1);
+}
+
+int decompressPairs(const Tablebase::PairsData* d, quint64 idx)
+{
+    if (d->flags & FlagSingleValue) return d->minSymLen;
+
+    // 稀疏索引第 k 項記錄第 k * span + span / 2 個值所在的區塊與區塊內偏移，
+    // 從最近的一項出發向前或向後逐區塊移動到 idx 所在的區塊
+    const quint64 k = idx / d->span;
+    const uchar* sparse = d->sparseIndex + 6 * k;
+    quint32 block = readLe32(sparse);
+    int offset = readLe16(sparse + 4);
+    offset += static_cast<int>(idx % d->span) - static_cast<int>(d->span / 2);
+
+    while (offset < 0) {
+        offset += readLe16(d->blockLength + 2 * (--block)) + 1;
+    }
+    while (offset > readLe16(d->blockLength + 2 * block)) {
+        offset -= readLe16(d->blockLength + 2 * (block++)) + 1;
+    }
+
+    // 逐一解出區塊中的 Huffman 符號，每個符號展開後代表 symlen + 1 個值
+    const uchar* ptr = d->data + static_cast<quint64>(block) * d->sizeofBlock;
+    quint64 buf64 = readBe64(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    int sym = 0;
+
+    while (true) {
+        int len = 0;
+        while (buf64 < d->base64[len]) ++len;
+
+        sym = static_cast<int>((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+        sym += readLe16(d->lowestSym + 2 * len);
+
+        if (offset < d->symlen[sym] + 1) break;
+
+        offset -= d->symlen[sym] + 1;
+        len += d->minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+        if (buf64Size <= 32) {
+            buf64Size += 32;
+            buf64 |= static_cast<quint64>(readBe32(ptr)) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // 沿配對樹往下走到葉節點；左右子符號在原始序列中相鄰
+    while (d->symlen[sym]) {
+        const int left = d->left(sym);
+        if (offset < d->symlen[left] + 1) {
+            sym = left;
+        } else {
+            offset -= d->symlen[left] + 1;
+            sym = d->right(sym);
+        }
+    }
+    return d->left(sym);
+}
+
+template<typename T>
+void setGroups(const Tablebase::Table& e, Tablebase::PairsData* d, const int order[2], int f)
+{
+    const EncodingTables& tables = encoding();
+    int n = 0;
+    int firstLen = e.hasPawns ? 0 : e.hasUniquePieces ? 3 : 2;
+    d->groupLen[n] = 1;
+
+    // 相同的棋子歸為一組；領頭組為領頭兵，或三個不同的棋子（否則為兩個國王）
+    for (int i = 1; i < e.pieceCount; ++i) {
+        if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1]) {
+            d->groupLen[n]++;
+        } else {
+            d->groupLen[++n] = 1;
+        }
+    }
+    d->groupLen[++n] = 0;
+
+    // 各組的編碼順序由檔案決定：order[0] 為領頭組、order[1] 為另一方的兵
+    const bool pp = e.hasPawns && e.pawnCount[1];
+    int next = pp ? 2 : 1;
+    int freeSquares = 64 - d->groupLen[0] - (pp ? d->groupLen[1] : 0);
+    quint64 idx = 1;
+
+    for (int k = 0; next < n || k == order[0] || k == order[1]; ++k) {
+        if (k == order[0]) {
+            d->groupIdx[0] = idx;
+            idx *= e.hasPawns ? tables.leadPawnsSize[d->groupLen[0]][f]
+                 : e.hasUniquePieces ? 31332 : 462;
+        } else if (k == order[1]) {
+            d->groupIdx[1] = idx;
+            idx *= tables.binomial[d->groupLen[1]][48 - d->groupLen[0]];
+        } else {
+            d->groupIdx[next] = idx;
+            idx *= tables.binomial[d->groupLen[next]][freeSquares];
+            freeSquares -= d->groupLen[next++];
+        }
+    }
+    d->groupIdx[n] = idx;
+}
+
+// 解析檔案標頭之後的內容；超出檔案範圍時回傳 false
+bool parseTable(Tablebase::Table& e, Tablebase::TableFile& tf, bool isDtz)
+{
+    const uchar* data = tf.base + 4;
+    const uchar* end = tf.base + tf.size;
+
+    const bool split = (*data & HeaderSplit) != 0;
+    const bool hasPawns = (*data & HeaderHasPawns) != 0;
+    if (hasPawns != e.hasPawns || (!isDtz && split != (e.key != e.key2))) {
+        return false;
+    }
+    ++data;
+
+    const int sides = !isDtz && e.key != e.key2 ? 2 : 1;
+    const int maxFile = e.hasPawns ? 3 : 0;
+    const bool pp = e.hasPawns && e.pawnCount[1];
+
+    for (int f = 0; f <= maxFile; ++f) {
+        for (int i = 0; i < sides; ++i) {
+            tf.items[i][f] = Tablebase::PairsData();
+        }
+        const int order[2][2] = {
+            { *data & 0xF, pp ? *(data + 1) & 0xF : 0xF },
+            { *data >> 4,  pp ? *(data + 1) >> 4  : 0xF }
+        };
+        data += 1 + pp;
+
+        for (int k = 0; k < e.pieceCount; ++k, ++data) {
+            for (int i = 0; i < sides; ++i) {
+                tf.items[i][f].pieces[k] = i ? *data >> 4 : *data & 0xF;
+            }
+        }
+        for (int i = 0; i < sides; ++i) {
+            setGroups<Tablebase::Table>(e, &tf.items[i][f], order[i], f);
+        }
+        if (data >= end) return false;
+    }
+
+    data += reinterpret_cast<quintptr>(data) & 1;   // 對齊到 2 位元組
+
+    for (int f = 0; f <= maxFile; ++f) {
+        for (int i = 0; i < sides; ++i) {
+            data = setSizes(&tf.items[i][f], data);
+            if (data >= end) return false;
+        }
+    }
+
+    if (isDtz) {
+        tf.dtzMap = data;
+        for (int f = 0; f <= maxFile; ++f) {
+            Tablebase::PairsData& d = tf.items[0][f];
+            if (!(d.flags & FlagMapped)) continue;
+            if (d.flags & FlagWide) {
+                data += reinterpret_cast<quintptr>(data) & 1;
+                for (int i = 0; i < 4; ++i) {
+                    d.mapIdx[i] = static_cast<quint16>((data - tf.dtzMap) / 2 + 1);
+                    data += 2 * readLe16(data) + 2;
+                }
+            } else {
+                for (int i = 0; i < 4; ++i) {
+                    d.mapIdx[i] = static_cast<quint16>(data - tf.dtzMap + 1);
+                    data += *data + 1;
+                }
+            }
+            if (data >= end) return false;
+        }
+        data += reinterpret_cast<quintptr>(data) & 1;
+    }
+
+    for (int f = 0; f <= maxFile; ++f) {
+        for (int i = 0; i < sides; ++i) {
+            tf.items[i][f].sparseIndex = data;
+            data += tf.items[i][f].sparseIndexSize * 6;
+        }
+    }
+    for (int f = 0; f <= maxFile; ++f) {
+        for (int i = 0; i < sides; ++i) {
+            tf.items[i][f].blockLength = data;
+            data += tf.items[i][f].blockLengthSize * 2;
+        }
+    }
+    for (int f = 0; f <= maxFile; ++f) {
+        for (int i = 0; i < sides; ++i) {
+            data = reinterpret_cast<const uchar*>((reinterpret_cast<quintptr>(data) + 0x3F) & ~quintptr(0x3F));
+            tf.items[i][f].data = data;
+            data += static_cast<quint64>(tf.items[i][f].numBlocks) * tf.items[i][f].sizeofBlock;
+        }
+    }
+    return data <= end;
+}
+
+} // namespace
+
+Tablebase::Tablebase()
+    : m_maxPieces(0)
+{
+}
+
+Tablebase::~Tablebase() = default;
+
+QString Tablebase::path() const
+{
+    return m_paths.join(QDir::listSeparator());
+}
+
+void Tablebase::setPath(const QString& paths)
+{
+    QMutexLocker locker(&m_mutex);
+    m_tables.clear();
+    m_wdlFiles.clear();
+    m_dtzFiles.clear();
+    m_maxPieces = 0;
+    m_paths = paths.split(QDir::listSeparator(), Qt::SkipEmptyParts);
+
+    for (const QString& path : m_paths) {
+        QDir dir(path);
+        const QFileInfoList files = dir.entryInfoList(QStringList() << "*.rtbw" << "*.rtbz", QDir::Files);
+        for (const QFileInfo& info : files) {
+            const QString name = info.completeBaseName();
+            const QStringList sides = name.split('v');
+            int counts[2][6];
+            if (sides.size() != 2 || !parseSideCode(sides[0], counts[0]) || !parseSideCode(sides[1], counts[1])) {
+                continue;
+            }
+            if (name.length() - 1 > MAX_PIECES) continue;
+            if (info.suffix().compare("rtbw", Qt::CaseInsensitive) == 0) {
+                if (!m_wdlFiles.contains(name)) m_wdlFiles.insert(name, info.absoluteFilePath());
+                m_maxPieces = qMax(m_maxPieces, name.length() - 1);
+            } else if (!m_dtzFiles.contains(name)) {
+                m_dtzFiles.insert(name, info.absoluteFilePath());
+            }
+        }
+    }
+    qDebug() << "Syzygy tablebases:" << m_wdlFiles.size() << "WDL and" << m_dtzFiles.size()
+             << "DTZ files, up to" << m_maxPieces << "pieces";
+}
+
+bool Tablebase::canProbe(const ChessBoard& board) const
+{
+    if (m_maxPieces == 0 || board.castlingRights() != NoCastling || board.isBombModeEnabled()) {
+        return false;
+    }
+    int pieces = 0;
+    int kings[2] = {};
+    for (int row = 0; row < 8; ++row) {
+        for (int col = 0; col < 8; ++col) {
+            const ChessPiece& piece = board.getPiece(row, col);
+            if (piece.getType() == PieceType::None) continue;
+            ++pieces;
+            if (piece.getType() == PieceType::King) {
+                ++kings[piece.getColor() == PieceColor::White ? 0 : 1];
+            }
+        }
+    }
+    return pieces <= m_maxPieces && kings[0] == 1 && kings[1] == 1;
+}
+
+std::shared_ptr<Tablebase::Table> Tablebase::findTable(quint64 signature) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_tables.constFind(signature);
+    if (it != m_tables.constEnd()) return it.value();
+
+    // 檔名中子力較強的一方在前；兩種排列都試
+    int counts[2][6];
+    for (int color = 0; color < 2; ++color) {
+        for (int type = 0; type < 6; ++type) {
+            counts[color][type] = static_cast<int>((signature >> (4 * (color * 6 + type))) & 0xF);
+        }
+    }
+    const QString whiteFirst = sideCode(counts[0]) + "v" + sideCode(counts[1]);
+    const QString blackFirst = sideCode(counts[1]) + "v" + sideCode(counts[0]);
+
+    std::shared_ptr<Table> table;
+    const QString name = m_wdlFiles.contains(whiteFirst) ? whiteFirst
+                       : m_wdlFiles.contains(blackFirst) ? blackFirst : QString();
+    if (!name.isEmpty()) {
+        table = std::make_shared<Table>();
+        table->name = name;
+        const bool whiteIsFirst = name == whiteFirst;
+        const int* first = whiteIsFirst ? counts[0] : counts[1];
+        const int* second = whiteIsFirst ? counts[1] : counts[0];
+        int ordered[2][6];
+        int swapped[2][6];
+        for (int type = 0; type < 6; ++type) {
+            ordered[0][type] = swapped[1][type] = first[type];
+            ordered[1][type] = swapped[0][type] = second[type];
+            table->pieceCount += first[type] + second[type];
+            if (type < 5 && (first[type] == 1 || second[type] == 1)) table->hasUniquePieces = true;
+        }
+        table->key = materialSignature(ordered);
+        table->key2 = materialSignature(swapped);
+        table->hasPawns = first[0] + second[0] > 0;
+
+        // 雙方都有兵時，兵較少的一方為領頭方（壓縮效果較好）
+        const bool firstLeads = !second[0] || (first[0] && second[0] >= first[0]);
+        table->pawnCount[0] = firstLeads ? first[0] : second[0];
+        table->pawnCount[1] = firstLeads ? second[0] : first[0];
+    }
+
+    m_tables.insert(signature, table);
+    m_tables.insert(swapColors(signature), table);
+    return table;
+}
+
+bool Tablebase::ensureMapped(Table& table, bool dtz) const
+{
+    TableFile& tf = dtz ? table.dtz : table.wdl;
+    if (tf.ready.load(std::memory_order_acquire)) return true;
+
+    QMutexLocker locker(&m_mutex);
+    if (tf.ready.load(std::memory_order_relaxed)) return true;
+    if (tf.tried) return false;
+    tf.tried = true;
+
+    const QString path = (dtz ? m_dtzFiles : m_wdlFiles).value(table.name);
+    if (path.isEmpty()) return false;
+
+    tf.file.setFileName(path);
+    if (!tf.file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Syzygy: cannot open" << path << tf.file.errorString();
+        return false;
+    }
+    // 合法的檔案大小一定是 64 的倍數加上 16
+    tf.size = tf.file.size();
+    if (tf.size % 64 != 16) {
+        qWarning() << "Syzygy: corrupt file size" << path;
+        tf.file.close();
+        return false;
+    }
+    tf.base = tf.file.map(0, tf.size);
+    const uchar* magic = dtz ? DTZ_MAGIC : WDL_MAGIC;
+    if (!tf.base || !std::equal(magic, magic + 4, tf.base) || !parseTable(table, tf, dtz)) {
+        qWarning() << "Syzygy: corrupt table" << path;
+        if (tf.base) tf.file.unmap(const_cast<uchar*>(tf.base));
+        tf.base = nullptr;
+        tf.file.close();
+        return false;
+    }
+
+    tf.ready.store(true, std::memory_order_release);
+    return true;
+}
+
+int Tablebase::probeTable(const ChessBoard& board, bool dtz, WdlScore wdl, ProbeState* state) const
+{
+    const EncodingTables& tables = encoding();
+    TbPosition pos;
+    loadPosition(board, pos);
+
+    if (pos.pieceCount == 2) return 0;   // KvK
+
+    std::shared_ptr<Table> entry = findTable(pos.signature);
+    if (!entry || !ensureMapped(*entry, dtz)) {
+        *state = ProbeState::Fail;
+        return 0;
+    }
+    TableFile& tf = dtz ? entry->dtz : entry->wdl;
+    const int sides = !dtz && entry->key != entry->key2 ? 2 : 1;
+
+    // 雙方子力相同時表格只存白方行棋，黑方行棋時交換顏色；
+    // 表格以檔名中的前一方為白方，黑方較強時同樣交換顏色並上下翻轉棋盤
+    const bool symmetricBlackToMove = entry->key == entry->key2 && pos.stm == 1;
+    const bool blackStronger = pos.signature != entry->key;
+    const bool flip = symmetricBlackToMove || blackStronger;
+    const int flipColor = flip ? 8 : 0;
+    const int flipSquares = flip ? 56 : 0;
+    const int stm = (flip ? 1 : 0) ^ pos.stm;
+
+    int squares[TB_PIECES];
+    int pieces[TB_PIECES];
+    int size = 0;
+    int leadPawnsCnt = 0;
+    int tbFile = 0;
+    quint64 leadPawns = 0;
+    auto pawnsComp = [&tables](int a, int b) { return tables.mapPawns[a] < tables.mapPawns[b]; };
+
+    if (entry->hasPawns) {
+        // 各直行的表格中，棋子序列都以領頭方的兵開始
+        const int pc = tf.items[0][0].pieces[0] ^ flipColor;
+        for (int s = 0; s < 64; ++s) {
+            if (pos.pieceOn[s] == pc) {
+                leadPawns |= 1ULL << s;
+                squares[size++] = s ^ flipSquares;
+            }
+        }
+        leadPawnsCnt = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCnt, pawnsComp));
+        tbFile = qMin(fileOf(squares[0]), 7 - fileOf(squares[0]));
+    }
+
+    // DTZ 表只存一方行棋的局面
+    if (dtz) {
+        const PairsData* d = tf.get(stm, tbFile, entry->hasPawns, sides);
+        if ((d->flags & FlagStm) != stm && !(entry->key == entry->key2 && !entry->hasPawns)) {
+            *state = ProbeState::ChangeStm;
+            return 0;
+        }
+    }
+
+    for (int s = 0; s < 64; ++s) {
+        if (!pos.pieceOn[s] || (leadPawns & (1ULL << s))) continue;
+        if (size >= TB_PIECES) {
+            *state = ProbeState::Fail;
+            return 0;
+        }
+        squares[size] = s ^ flipSquares;
+        pieces[size++] = pos.pieceOn[s] ^ flipColor;
+    }
+
+    PairsData* d = tf.get(stm, tbFile, entry->hasPawns, sides);
+
+    // 依表格的棋子序列重新排列
+    for (int i = leadPawnsCnt; i < size - 1; ++i) {
+        for (int j = i + 1; j < size; ++j) {
+            if (d->pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // 左右翻轉，使領頭棋子在 a-d 直行
+    if (fileOf(squares[0]) > 3) {
+        for (int i = 0; i < size; ++i) squares[i] = flipFile(squares[i]);
+    }
+
+    quint64 idx = 0;
+    if (entry->hasPawns) {
+        idx = tables.leadPawnIdx[leadPawnsCnt][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCnt, pawnsComp);
+        for (int i = 1; i < leadPawnsCnt; ++i) {
+            idx += tables.binomial[i][tables.mapPawns[squares[i]]];
+        }
+    } else {
+        // 沒有兵時再上下翻轉，使領頭棋子在第 1-4 橫列
+        if (rankOf(squares[0]) > 3) {
+            for (int i = 0; i < size; ++i) squares[i] = flipRank(squares[i]);
+        }
+        // 領頭組中第一個不在 a1-h8 對角線上的棋子，須映射到對角線下方
+        for (int i = 0; i < d->groupLen[0]; ++i) {
+            if (!offA1H8(squares[i])) continue;
+            if (offA1H8(squares[i]) > 0) {
+                for (int j = i; j < size; ++j) {
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+            }
+            break;
+        }
+
+        if (entry->hasUniquePieces) {
+            // 三個不同的棋子一起編碼，後面的棋子跳過前面已佔用的格子
+            const int adjust1 = squares[1] > squares[0];
+            const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (offA1H8(squares[0])) {
+                idx = (tables.mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62
+                    + squares[2] - adjust2;
+            } else if (offA1H8(squares[1])) {
+                idx = (6 * 63 + rankOf(squares[0]) * 28 + tables.mapB1H1H7[squares[1]]) * 62
+                    + squares[2] - adjust2;
+            } else if (offA1H8(squares[2])) {
+                idx = 6 * 63 * 62 + 4 * 28 * 62
+                    + rankOf(squares[0]) * 7 * 28
+                    + (rankOf(squares[1]) - adjust1) * 28
+                    + tables.mapB1H1H7[squares[2]];
+            } else {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+                    + rankOf(squares[0]) * 7 * 6
+                    + (rankOf(squares[1]) - adjust1) * 6
+                    + (rankOf(squares[2]) - adjust2);
+            }
+        } else {
+            idx = tables.mapKK[tables.mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // 其餘各組（另一方的兵、其他棋子）依格子由小到大編碼
+    idx *= d->groupIdx[0];
+    int* groupSq = squares + d->groupLen[0];
+    bool remainingPawns = entry->hasPawns && entry->pawnCount[1];
+    int next = 0;
+    while (d->groupLen[++next]) {
+        std::stable_sort(groupSq, groupSq + d->groupLen[next]);
+        quint64 n = 0;
+        for (int i = 0; i < d->groupLen[next]; ++i) {
+            const int adjust = static_cast<int>(std::count_if(squares, groupSq,
+                                                              [&](int s) { return groupSq[i] > s; }));
+            n += tables.binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * d->groupIdx[next];
+        groupSq += d->groupLen[next];
+    }
+
+    const int value = decompressPairs(d, idx);
+    if (!dtz) return value - 2;
+
+    // DTZ：數值可能經過對照表壓縮，並以「步」或「半步」儲存；一律換算成半步
+    static const int WDL_MAP[] = { 1, 3, 0, 2, 0 };
+    const PairsData* d0 = tf.get(0, tbFile, entry->hasPawns, 1);
+    int result = value;
+    if (d0->flags & FlagMapped) {
+        const int offset = d0->mapIdx[WDL_MAP[static_cast<int>(wdl) + 2]] + value;
+        result = (d0->flags & FlagWide) ? readLe16(tf.dtzMap + 2 * offset) : tf.dtzMap[offset];
+    }
+    if ((wdl == WdlScore::Win && !(d0->flags & FlagWinPlies))
+        || (wdl == WdlScore::Loss && !(d0->flags & FlagLossPlies))
+        || wdl == WdlScore::CursedWin || wdl == WdlScore::BlessedLoss) {
+        result *= 2;
+    }
+    return result + 1;
+}
+
+WdlScore Tablebase::search(ChessBoard& board, bool checkZeroingMoves, ProbeState* state) const
+{
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    if (moves.isEmpty()) {
+        // 將死或逼和：結果已確定，不必查表
+        *state = ProbeState::ZeroingBestMove;
+        return board.isInCheck(board.getCurrentPlayer()) ? WdlScore::Loss : WdlScore::Draw;
+    }
+
+    // 殘局庫不儲存「有獲勝吃子」的局面（當作不在乎的值以利壓縮），必須展開吃子；
+    // 吃過路兵的局面也不在表中。DTZ 另外不儲存最佳走法為兵移動的局面
+    WdlScore bestValue = WdlScore::Loss;
+    int moveCount = 0;
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = moves[i];
+        if (!move.isCapture() && (!checkZeroingMoves || !isPawnMove(board, move))) continue;
+
+        ++moveCount;
+        board.makeMove(move);
+        const WdlScore value = negate(search(board, false, state));
+        board.unmakeMove();
+
+        if (*state == ProbeState::Fail) return WdlScore::Draw;
+
+        if (value > bestValue) {
+            bestValue = value;
+            if (value >= WdlScore::Win) {
+                *state = ProbeState::ZeroingBestMove;
+                return value;
+            }
+        }
+    }
+
+    // 所有合法走法都已展開時不查表（表中的值可能是不在乎的值）
+    const bool noMoreMoves = moveCount && moveCount == moves.size();
+    WdlScore value = bestValue;
+    if (!noMoreMoves) {
+        value = static_cast<WdlScore>(probeTable(board, false, WdlScore::Draw, state));
+        if (*state == ProbeState::Fail) return WdlScore::Draw;
+    }
+
+    if (bestValue >= value) {
+        *state = (bestValue > WdlScore::Draw || noMoreMoves) ? ProbeState::ZeroingBestMove : ProbeState::Ok;
+        return bestValue;
+    }
+    *state = ProbeState::Ok;
+    return value;
+}
+
+int Tablebase::searchDtz(ChessBoard& board, ProbeState* state) const
+{
+    *state = ProbeState::Ok;
+    const WdlScore wdl = search(board, true, state);
+    if (*state == ProbeState::Fail || wdl == WdlScore::Draw) return 0;
+
+    // 最佳走法是吃子或兵移動時，表中存的是不在乎的值
+    if (*state == ProbeState::ZeroingBestMove) return dtzBeforeZeroing(wdl);
+
+    int dtz = probeTable(board, true, wdl, state);
+    if (*state == ProbeState::Fail) return 0;
+    if (*state != ProbeState::ChangeStm) {
+        const bool cursed = wdl == WdlScore::BlessedLoss || wdl == WdlScore::CursedWin;
+        return (dtz + 100 * cursed) * signOf(static_cast<int>(wdl));
+    }
+
+    // 表只存對方行棋的局面：展開一層，取保持結果且 DTZ 最小的走法
+    int minDtz = 0xFFFF;
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = moves[i];
+        const bool zeroing = move.isCapture() || isPawnMove(board, move);
+
+        board.makeMove(move);
+        // 歸零的走法取走之前的 DTZ；仍需查詢走完後的局面以得知勝負
+        dtz = zeroing ? -dtzBeforeZeroing(search(board, false, state))
+                      : -searchDtz(board, state);
+
+        if (dtz == 1 && board.isCheckmate(board.getCurrentPlayer())) minDtz = 1;
+        if (!zeroing) dtz += signOf(dtz);
+        if (dtz < minDtz && signOf(dtz) == signOf(static_cast<int>(wdl))) minDtz = dtz;
+        board.unmakeMove();
+
+        if (*state == ProbeState::Fail) return 0;
+    }
+    return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+bool Tablebase::probeWdl(const ChessBoard& board, WdlScore* wdl) const
+{
+    if (!canProbe(board)) return false;
+    ChessBoard copy = board;
+    ProbeState state = ProbeState::Ok;
+    const WdlScore result = search(copy, false, &state);
+    if (state == ProbeState::Fail) return false;
+    if (wdl) *wdl = result;
+    return true;
+}
+
+bool Tablebase::probeDtz(const ChessBoard& board, int* dtz) const
+{
+    if (!canProbe(board)) return false;
+    ChessBoard copy = board;
+    ProbeState state = ProbeState::Ok;
+    const int result = searchDtz(copy, &state);
+    if (state == ProbeState::Fail) return false;
+    if (dtz) *dtz = result;
+    return true;
+}
+
+bool Tablebase::probeRoot(const ChessBoard& board, Move* bestMove, WdlScore* wdl, int* dtz) const
+{
+    if (!canProbe(board)) return false;
+
+    ChessBoard copy = board;
+    ProbeState state = ProbeState::Ok;
+    const int rootDtz = searchDtz(copy, &state);
+    if (state == ProbeState::Fail) return false;
+    state = ProbeState::Ok;
+    const WdlScore rootWdl = search(copy, false, &state);
+    if (state == ProbeState::Fail) return false;
+
+    MoveList moves;
+    copy.generateLegalMoves(moves);
+    if (moves.isEmpty()) return false;
+
+    const int cnt50 = board.getHalfmoveClock();
+    const bool repeated = board.repetitionCount() >= 2;
+    Move best;
+    int bestRank = -2 * MAX_DTZ;
+
+    for (int i = 0; i < moves.size(); ++i) {
+        const Move move = moves[i];
+        copy.makeMove(move);
+
+        // 從目前局面算起的 DTZ
+        int moveDtz = 0;
+        if (copy.getHalfmoveClock() == 0) {
+            moveDtz = dtzBeforeZeroing(negate(search(copy, false, &state)));
+        } else if (copy.isThreefoldRepetition() || copy.isFiftyMoveRule()) {
+            moveDtz = 0;
+        } else {
+            moveDtz = -searchDtz(copy, &state);
+            moveDtz = moveDtz > 0 ? moveDtz + 1 : moveDtz < 0 ? moveDtz - 1 : 0;
+        }
+        if (moveDtz == 2 && copy.isCheckmate(copy.getCurrentPlayer())) moveDtz = 1;
+        copy.unmakeMove();
+
+        if (state == ProbeState::Fail) return false;
+
+        // 五十步內確定獲勝的走法排最前（其中 DTZ 短的優先），其次是受五十步規則影響的勝局、和棋；
+        // 輸棋時撐得越久越好，五十步規則可能救回和棋的走法排在確定輸棋之前
+        const int rank = moveDtz > 0 ? (moveDtz + cnt50 <= 99 && !repeated ? MAX_DTZ - moveDtz : MAX_DTZ / 2 - (moveDtz + cnt50))
+                       : moveDtz < 0 ? (-moveDtz * 2 + cnt50 < 100 ? -MAX_DTZ - moveDtz : -MAX_DTZ / 2 + (-moveDtz + cnt50))
+                       : 0;
+
+        if (rank > bestRank) {
+            bestRank = rank;
+            best = move;
+        }
+    }
+
+    if (best.isNull()) return false;
+    if (bestMove) *bestMove = best;
+    if (wdl) *wdl = rootWdl;
+    if (dtz) *dtz = rootDtz;
+    return true;
+}
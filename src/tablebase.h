@@ -0,0 +1,79 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <memory>
+#include "chessmove.h"
+
+class ChessBoard;
+
+// ===== Syzygy 殘局庫 =====
+// 讀取 Syzygy 格式的 WDL（.rtbw，勝／和／負）與 DTZ（.rtbz，距離五十步計數歸零的步數）檔案。
+// setPath() 只掃描目錄中有哪些檔案；每種子力組合（例如 KRPvKR）第一次被查詢時才開啟並以
+// QFile::map 映射到記憶體，未用到的檔案不佔用任何資源
+// 查詢會在本地棋盤上展開吃子（殘局庫不儲存「有獲勝吃子」的局面），因此傳入的棋盤不會被修改
+// 可從多個執行緒同時查詢；開啟檔案時以互斥鎖保護
+
+// 以行棋方角度的結果；Cursed / Blessed 表示勝負會因五十步規則變成和棋
+enum class WdlScore {
+    Loss = -2,
+    BlessedLoss = -1,
+    Draw = 0,
+    CursedWin = 1,
+    Win = 2
+};
+
+class Tablebase {
+public:
+    static constexpr int MAX_PIECES = 7;
+
+    Tablebase();
+    ~Tablebase();
+
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    // 一個或多個目錄（以 QDir::listSeparator() 分隔）；已開啟的檔案全部關閉
+    void setPath(const QString& paths);
+    QString path() const;
+    // 目錄中 WDL 檔案的最大棋子數（含國王），沒有任何檔案時為 0
+    int maxPieces() const { return m_maxPieces; }
+
+    // 棋子數不超過 maxPieces()、沒有王車易位權且雙方各有一個國王的標準局面才能查詢
+    bool canProbe(const ChessBoard& board) const;
+
+    bool probeWdl(const ChessBoard& board, WdlScore* wdl) const;
+    // 正數為行棋方獲勝，絕對值為到五十步計數歸零（吃子或兵移動）的半步數上界；和棋為 0
+    bool probeDtz(const ChessBoard& board, int* dtz) const;
+    // 選出保持殘局庫結果的最佳走法：獲勝時走 DTZ 最短的走法（考慮五十步規則），
+    // 輸棋時走撐得最久的走法。wdl / dtz 為目前局面的結果
+    bool probeRoot(const ChessBoard& board, Move* bestMove, WdlScore* wdl = nullptr, int* dtz = nullptr) const;
+
+    struct PairsData;
+    struct TableFile;
+    struct Table;
+
+private:
+    enum class ProbeState;
+
+    QStringList m_paths;
+    QHash<QString, QString> m_wdlFiles;     // 子力組合名稱（如 KRvK）→ 檔案路徑
+    QHash<QString, QString> m_dtzFiles;
+    int m_maxPieces;
+
+    mutable QMutex m_mutex;
+    // 以子力特徵索引；同一張表以雙方顏色互換的兩個特徵各登記一次，查無檔案時記錄為空指標
+    mutable QHash<quint64, std::shared_ptr<Table>> m_tables;
+
+    std::shared_ptr<Table> findTable(quint64 signature) const;
+    bool ensureMapped(Table& table, bool dtz) const;
+
+    int probeTable(const ChessBoard& board, bool dtz, WdlScore wdl, ProbeState* state) const;
+    WdlScore search(ChessBoard& board, bool checkZeroingMoves, ProbeState* state) const;
+    int searchDtz(ChessBoard& board, ProbeState* state) const;
+};
+
+#endif // TABLEBASE_H
@@ -0,0 +1,22 @@
+#include "timemanager.h"
+#include <climits>
+
+TimeBudget TimeManager::allocate(qint64 remainingMs, qint64 incrementMs, int fullmoveNumber, int movesToGo)
+{
+    // 先扣掉通訊與計時誤差，時間快用完時至少保留 1ms 讓搜尋完成第一層
+    const qint64 available = qMax<qint64>(1, remainingMs - MOVE_OVERHEAD_MS);
+    const int expectedMoves = movesToGo > 0
+        ? qMin(movesToGo, MAX_EXPECTED_MOVES)
+        : qMax(MIN_EXPECTED_MOVES, MAX_EXPECTED_MOVES - fullmoveNumber / 2);
+
+    // 剩餘時間平均分配給預估的步數；加秒在走完後才加上，先使用其中的四分之三
+    qint64 optimum = available / expectedMoves + incrementMs * 3 / 4;
+    // 上限不超過剩餘時間的固定比例，快棋中剩下幾秒、加秒又比剩餘時間多時也不會超時
+    const qint64 maximum = qMax<qint64>(1, qMin(optimum * MAXIMUM_RATIO, available * MAX_REMAINING_PERMILLE / 1000));
+    optimum = qBound<qint64>(1, optimum, maximum);
+
+    TimeBudget budget;
+    budget.optimumMs = static_cast<int>(qMin<qint64>(optimum, INT_MAX));
+    budget.maximumMs = static_cast<int>(qMin<qint64>(maximum, INT_MAX));
+    return budget;
+}
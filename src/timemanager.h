@@ -0,0 +1,33 @@
+#ifndef TIMEMANAGER_H
+#define TIMEMANAGER_H
+
+#include <QtGlobal>
+
+// ===== 有棋鐘時的思考時間分配 =====
+// 依行棋方剩餘時間、每步加秒與回合數估計這一步可用的時間：
+// optimumMs 是目標時間（搜尋超過後不再開始新的一層），maximumMs 是無論如何都要停止的上限。
+// 內建搜尋與對戰工具共用；外部引擎則直接收到 go wtime/btime/winc/binc 自行分配
+
+struct TimeBudget {
+    int optimumMs = 0;
+    int maximumMs = 0;
+};
+
+namespace TimeManager {
+
+// 每步保留給事件迴圈、程序通訊與棋鐘 100ms 刻度誤差的時間
+constexpr int MOVE_OVERHEAD_MS = 50;
+// 未指定 movesToGo 時，假設棋局還要再走的步數：開局時 40 步，逐漸減少到 20 步
+constexpr int MAX_EXPECTED_MOVES = 40;
+constexpr int MIN_EXPECTED_MOVES = 20;
+// 目標時間的幾倍可作為上限（難以決定的局面可多用一些），以及上限最多佔剩餘時間的比例（千分比）
+constexpr int MAXIMUM_RATIO = 3;
+constexpr int MAX_REMAINING_PERMILLE = 800;
+
+// remainingMs：行棋方剩餘時間；incrementMs：這一步走完後加的時間；
+// movesToGo：到下一個時間控制的步數（0 表示整局只有一個時間控制）
+TimeBudget allocate(qint64 remainingMs, qint64 incrementMs, int fullmoveNumber, int movesToGo = 0);
+
+} // namespace TimeManager
+
+#endif // TIMEMANAGER_H
@@ -0,0 +1,110 @@
+#include "transpositiontable.h"
+
+TranspositionTable::TranspositionTable(int megabytes)
+    : m_bucketMask(0)
+    , m_sizeMb(0)
+    , m_generation(0)
+{
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(int megabytes)
+{
+    megabytes = qBound(1, megabytes, MAX_SIZE_MB);
+    quint64 bucketCount = 1;
+    const quint64 maxBuckets = static_cast<quint64>(megabytes) * 1024 * 1024 / sizeof(Bucket);
+    while (bucketCount * 2 <= maxBuckets) {
+        bucketCount *= 2;
+    }
+
+    // C++17 的 new 會依 alignas(64) 對齊，每個桶都落在快取線邊界上
+    m_buckets.reset(new Bucket[bucketCount]);
+    m_bucketMask = bucketCount - 1;
+    m_sizeMb = megabytes;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (quint64 i = 0; i <= m_bucketMask; ++i) {
+        for (Slot& slot : m_buckets[i].slots) {
+            slot.keyXorData.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    m_generation = 0;
+}
+
+quint64 TranspositionTable::pack(Move move, int score, int eval, int depth, Bound bound, quint8 generation)
+{
+    return static_cast<quint64>(move.raw())
+         | (static_cast<quint64>(static_cast<quint16>(score)) << 16)
+         | (static_cast<quint64>(static_cast<quint16>(eval)) << 32)
+         | (static_cast<quint64>(qBound(0, depth, 255)) << 48)
+         | (static_cast<quint64>(bound & 3) << 56)
+         | (static_cast<quint64>(generation & GENERATION_MASK) << 58);
+}
+
+bool TranspositionTable::probe(quint64 key, Entry& entry, bool currentGenerationOnly) const
+{
+    const Bucket& bucket = bucketFor(key);
+    for (const Slot& slot : bucket.slots) {
+        const quint64 data = slot.data.load(std::memory_order_relaxed);
+        if ((slot.keyXorData.load(std::memory_order_relaxed) ^ data) != key || data == 0) continue;
+        if (currentGenerationOnly && relativeAge(data) != 0) return false;
+
+        entry.move = Move::fromRaw(static_cast<quint16>(data));
+        entry.score = static_cast<qint16>(data >> 16);
+        entry.eval = static_cast<qint16>(data >> 32);
+        entry.depth = depthOf(data);
+        entry.bound = static_cast<Bound>((data >> 56) & 3);
+        return true;
+    }
+    return false;
+}
+
+void TranspositionTable::store(quint64 key, Move move, int score, int eval, int depth, Bound bound)
+{
+    Bucket& bucket = bucketFor(key);
+    Slot* target = nullptr;
+    int worstValue = 0;
+
+    for (Slot& slot : bucket.slots) {
+        const quint64 data = slot.data.load(std::memory_order_relaxed);
+        const quint64 slotKey = slot.keyXorData.load(std::memory_order_relaxed) ^ data;
+
+        if (data == 0 || slotKey == key) {
+            if (data != 0) {
+                // 同一局面：保留較深的同世代結果與原本的走法
+                if (bound != BoundExact && relativeAge(data) == 0 && depth + 2 < depthOf(data)) return;
+                if (move.isNull()) move = Move::fromRaw(static_cast<quint16>(data));
+            }
+            target = &slot;
+            break;
+        }
+
+        // 替換價值：深度越淺、世代越舊越優先被替換
+        const int value = depthOf(data) - 8 * relativeAge(data);
+        if (!target || value < worstValue) {
+            target = &slot;
+            worstValue = value;
+        }
+    }
+
+    const quint64 data = pack(move, score, eval, depth, bound, m_generation);
+    target->data.store(data, std::memory_order_relaxed);
+    target->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    const quint64 sampleBuckets = qMin<quint64>(250, m_bucketMask + 1);
+    int used = 0;
+    for (quint64 i = 0; i < sampleBuckets; ++i) {
+        for (const Slot& slot : m_buckets[i].slots) {
+            const quint64 data = slot.data.load(std::memory_order_relaxed);
+            if (data != 0 && relativeAge(data) == 0) ++used;
+        }
+    }
+    return static_cast<int>(used * 1000 / (sampleBuckets * 4));
+}
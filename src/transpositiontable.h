@@ -0,0 +1,81 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include "chessmove.h"
+
+// ===== 置換表（Transposition Table）=====
+// 以 64 位元 Zobrist 局面鍵索引的固定大小快取，記錄已搜尋局面的最佳走法、分數、深度與邊界類型
+// 每個桶（bucket）含 4 個 16 位元組的項目，恰好佔一條 64 位元組快取線，一次查詢只觸及一條快取線
+// 無鎖：每個項目存放 data 與 key ^ data 兩個原子字組，讀取時重新 XOR 驗證，
+// 多個執行緒同時寫入造成的撕裂項目會因鍵不符而被視為未命中，不需要任何鎖
+
+class TranspositionTable {
+public:
+    enum Bound : quint8 {
+        BoundNone = 0,   // 只有走法（例如外部引擎的 bestmove），分數不可用於剪枝
+        BoundUpper = 1,  // 分數 <= score（所有走法都低於 alpha）
+        BoundLower = 2,  // 分數 >= score（發生 beta 剪枝）
+        BoundExact = 3
+    };
+
+    static constexpr int NO_EVAL = -32768;  // 尚未計算靜態評估
+    static constexpr int DEFAULT_SIZE_MB = 16;
+    static constexpr int MAX_SIZE_MB = 1024;
+
+    struct Entry {
+        Move move;
+        int score = 0;
+        int eval = NO_EVAL;
+        int depth = 0;
+        Bound bound = BoundNone;
+    };
+
+    explicit TranspositionTable(int megabytes = DEFAULT_SIZE_MB);
+
+    // 重新配置並清空；桶數取不超過指定大小的 2 的冪次。不可與 probe/store 同時呼叫
+    void resize(int megabytes);
+    int sizeMb() const { return m_sizeMb; }
+    void clear();
+
+    // 新棋局時遞增世代；替換時優先淘汰舊世代的項目，舊項目仍可命中
+    void newGeneration() { m_generation = static_cast<quint8>((m_generation + 1) & GENERATION_MASK); }
+
+    // currentGenerationOnly 為 true 時忽略舊世代（先前棋局）的項目
+    bool probe(quint64 key, Entry& entry, bool currentGenerationOnly = false) const;
+    // 同一局面時，新走法為空走法則保留原走法；同一世代中較淺的非精確結果不覆蓋較深的結果
+    void store(quint64 key, Move move, int score, int eval, int depth, Bound bound);
+
+    // 目前世代項目的千分比（取前 1000 個項目估計，與 UCI 的 hashfull 相同）
+    int hashfull() const;
+
+private:
+    // data 的位元配置：0-15 走法、16-31 分數、32-47 靜態評估、48-55 深度、56-57 邊界、58-63 世代
+    struct Slot {
+        std::atomic<quint64> keyXorData;
+        std::atomic<quint64> data;
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[4];
+    };
+    static_assert(sizeof(Bucket) == 64, "每個桶必須恰好佔一條快取線");
+
+    static constexpr quint8 GENERATION_MASK = 0x3F;
+
+    static quint64 pack(Move move, int score, int eval, int depth, Bound bound, quint8 generation);
+    static int depthOf(quint64 data) { return static_cast<int>((data >> 48) & 0xFF); }
+    static quint8 generationOf(quint64 data) { return static_cast<quint8>(data >> 58); }
+    int relativeAge(quint64 data) const { return (m_generation - generationOf(data)) & GENERATION_MASK; }
+
+    Bucket& bucketFor(quint64 key) const { return m_buckets[key & m_bucketMask]; }
+
+    std::unique_ptr<Bucket[]> m_buckets;
+    quint64 m_bucketMask;
+    int m_sizeMb;
+    quint8 m_generation;
+};
+
+#endif // TRANSPOSITIONTABLE_H
@@ -0,0 +1,130 @@
+#include "uciinfo.h"
+#include "searchengine.h"
+
+QStringView UciInfo::pv() const
+{
+    if (!hasPv()) return QStringView();
+    return QStringView(source).mid(pvOffset);
+}
+
+QStringList UciInfo::pvMoves() const
+{
+    if (!hasPv()) return QStringList();
+    return pv().toString().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+}
+
+int UciInfo::searchScore() const
+{
+    if (!isMate) return qBound(-SearchEngine::MATE_BOUND, score, SearchEngine::MATE_BOUND);
+    // mate 以己方走步數計：將殺對方需 2n-1 層，被將殺則為 2n 層
+    const int limit = (SearchEngine::MAX_PLY - 1) / 2;
+    const int moves = qBound(-limit, score, limit);
+    return moves > 0 ? SearchEngine::MATE_SCORE - (2 * moves - 1)
+                     : -(SearchEngine::MATE_SCORE - 2 * (-moves));
+}
+
+void UciInfo::setSearchScore(int searchScore)
+{
+    hasScore = true;
+    if (SearchEngine::isMateScore(searchScore)) {
+        const int plies = SearchEngine::MATE_SCORE - qAbs(searchScore);
+        isMate = true;
+        score = searchScore > 0 ? (plies + 1) / 2 : -(plies / 2);
+    } else {
+        isMate = false;
+        score = searchScore;
+    }
+}
+
+bool UciInfo::parse(const QString& line, UciInfo& info)
+{
+    info = UciInfo();
+    const QStringView text(line);
+    const int length = static_cast<int>(text.size());
+    int pos = 0;
+    int tokenStart = 0;
+    int tokenLength = 0;
+
+    // 取下一個以空白分隔的欄位（只記錄起點與長度，不建立字串）
+    auto nextToken = [&]() {
+        while (pos < length && text[pos] == QLatin1Char(' ')) ++pos;
+        tokenStart = pos;
+        while (pos < length && text[pos] != QLatin1Char(' ')) ++pos;
+        tokenLength = pos - tokenStart;
+        return tokenLength > 0;
+    };
+    auto tokenIs = [&](const char* keyword) {
+        int i = 0;
+        for (; i < tokenLength; ++i) {
+            if (keyword[i] == '\0' || text[tokenStart + i].toLatin1() != keyword[i]) return false;
+        }
+        return keyword[i] == '\0';
+    };
+    // 讀取下一個欄位的整數（可帶負號）；欄位缺少或不是數字時回傳 false
+    auto nextNumber = [&](qint64& value) {
+        if (!nextToken()) return false;
+        int i = 0;
+        bool negative = false;
+        if (text[tokenStart] == QLatin1Char('-')) {
+            negative = true;
+            ++i;
+        }
+        if (i >= tokenLength) return false;
+        qint64 result = 0;
+        for (; i < tokenLength; ++i) {
+            const char c = text[tokenStart + i].toLatin1();
+            if (c < '0' || c > '9') return false;
+            result = result * 10 + (c - '0');
+        }
+        value = negative ? -result : result;
+        return true;
+    };
+
+    if (!nextToken() || !tokenIs("info")) return false;
+
+    qint64 value = 0;
+    while (nextToken()) {
+        if (tokenIs("depth")) {
+            if (nextNumber(value)) info.depth = static_cast<int>(value);
+        } else if (tokenIs("seldepth")) {
+            if (nextNumber(value)) info.selDepth = static_cast<int>(value);
+        } else if (tokenIs("multipv")) {
+            if (nextNumber(value)) info.multiPv = qMax(1, static_cast<int>(value));
+        } else if (tokenIs("score")) {
+            // score cp <x> | mate <y>，後面可能接 lowerbound / upperbound
+            if (!nextToken()) break;
+            const bool mate = tokenIs("mate");
+            if ((mate || tokenIs("cp")) && nextNumber(value)) {
+                info.hasScore = true;
+                info.isMate = mate;
+                info.score = static_cast<int>(value);
+            }
+        } else if (tokenIs("lowerbound")) {
+            info.bound = BoundLower;
+        } else if (tokenIs("upperbound")) {
+            info.bound = BoundUpper;
+        } else if (tokenIs("nodes")) {
+            if (nextNumber(value)) info.nodes = static_cast<quint64>(qMax<qint64>(0, value));
+        } else if (tokenIs("nps")) {
+            if (nextNumber(value)) info.nodesPerSecond = static_cast<quint64>(qMax<qint64>(0, value));
+        } else if (tokenIs("time")) {
+            if (nextNumber(value)) info.timeMs = value;
+        } else if (tokenIs("hashfull")) {
+            if (nextNumber(value)) info.hashfull = static_cast<int>(value);
+        } else if (tokenIs("pv")) {
+            // pv 之後到行尾都是走法
+            while (pos < length && text[pos] == QLatin1Char(' ')) ++pos;
+            if (pos < length) {
+                info.source = line;
+                info.pvOffset = pos;
+            }
+            break;
+        } else if (tokenIs("string") || tokenIs("refutation") || tokenIs("currline")) {
+            // 之後到行尾都是自由格式，不再解析
+            break;
+        }
+        // 其他欄位（currmove、tbhits、wdl 等）的數值會在下一輪被當成未知欄位略過
+    }
+
+    return info.depth > 0 && info.hasScore;
+}
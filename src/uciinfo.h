@@ -0,0 +1,48 @@
+#ifndef UCIINFO_H
+#define UCIINFO_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QtGlobal>
+
+// ===== UCI info 行的解析結果 =====
+// 引擎在高 NPS 下每秒可輸出上千行 info，因此 parse() 以索引逐字掃描，不使用 QString::split，
+// 主要變例只記錄在原始行中的位置（QString 隱式共享，不額外配置），需要時才以 pvMoves() 拆開
+
+struct UciInfo {
+    enum ScoreBound : quint8 {
+        BoundExact = 0,
+        BoundLower,     // lowerbound：實際分數 >= score
+        BoundUpper      // upperbound：實際分數 <= score
+    };
+
+    int depth = 0;
+    int selDepth = 0;
+    int multiPv = 1;            // 第幾條變例（1 起算）
+    bool hasScore = false;
+    bool isMate = false;        // true 時 score 為將殺步數（負數表示行棋方被將殺），否則為百分兵
+    int score = 0;              // 以行棋方角度
+    ScoreBound bound = BoundExact;
+    quint64 nodes = 0;
+    quint64 nodesPerSecond = 0;
+    qint64 timeMs = 0;
+    int hashfull = -1;          // 千分比，-1 表示引擎未回報
+
+    QString source;             // 主要變例所在的字串（解析時即為引擎輸出的那一行）
+    int pvOffset = -1;          // 主要變例在 source 中的起點，-1 表示沒有主要變例
+
+    bool hasPv() const { return pvOffset >= 0 && pvOffset < source.size(); }
+    QStringView pv() const;     // 以空白分隔的 UCI 走法
+    QStringList pvMoves() const;
+
+    // 與 SearchEngine 分數（將殺為 ±(MATE_SCORE - 層數)）互相轉換，讓兩種引擎的分數可以直接比較與存入置換表
+    int searchScore() const;
+    void setSearchScore(int searchScore);
+
+    // 解析一行 "info ..."；只有同時包含 depth 與 score 的行（可顯示的搜尋進度）回傳 true，
+    // "info string"、"info currmove" 等行回傳 false
+    static bool parse(const QString& line, UciInfo& info);
+};
+
+#endif // UCIINFO_H
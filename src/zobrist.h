@@ -0,0 +1,53 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <QtGlobal>
+
+// ===== Zobrist 雜湊鍵 =====
+// 每個（棋子、格子）、行棋方、王車易位權組合、吃過路兵直行與地雷格各對應一個 64 位元亂數，
+// 局面鍵為所有成立項目的 XOR，因此每次落子只需 XOR 變動的項目即可增量更新
+// 亂數於編譯期以 splitmix64 產生，每次建置結果固定，可安全地寫入檔案或跨程序比對
+
+namespace Zobrist {
+    struct Keys {
+        quint64 pieces[12][64];   // [pieceIndex][square]
+        quint64 castling[16];     // [王車易位權位元組合]
+        quint64 enPassant[8];     // [吃過路兵目標格的直行]
+        quint64 mines[64];        // [地雷格]
+        quint64 blackToMove;
+    };
+
+    constexpr quint64 splitMix64(quint64& state) {
+        quint64 z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    constexpr Keys generateKeys() {
+        Keys keys{};
+        quint64 state = 0x51C3E5B0D2A9F781ULL;
+        for (int piece = 0; piece < 12; ++piece) {
+            for (int square = 0; square < 64; ++square) {
+                keys.pieces[piece][square] = splitMix64(state);
+            }
+        }
+        // 無任何易位權時鍵值為 0，使沒有易位權的局面不受影響
+        keys.castling[0] = 0;
+        for (int rights = 1; rights < 16; ++rights) {
+            keys.castling[rights] = splitMix64(state);
+        }
+        for (int file = 0; file < 8; ++file) {
+            keys.enPassant[file] = splitMix64(state);
+        }
+        for (int square = 0; square < 64; ++square) {
+            keys.mines[square] = splitMix64(state);
+        }
+        keys.blackToMove = splitMix64(state);
+        return keys;
+    }
+
+    inline constexpr Keys KEYS = generateKeys();
+}
+
+#endif // ZOBRIST_H
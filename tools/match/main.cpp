@@ -0,0 +1,750 @@
+#include "chessboard.h"
+#include "chessengine.h"
+#include "difficulty.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <cmath>
+#include <functional>
+
+// ===== qt_chess_match：無介面的引擎對戰工具 =====
+// 以 ChessEngine（內建搜尋或外部 UCI 引擎）與 ChessBoard 同時進行多局對弈，輸出 PGN 與勝率／Elo 統計，
+// 用來校準 ChessEngine::setDifficulty() 各等級的實際棋力。
+// 用法：
+//   qt_chess_match --levels 0,5,10,15,20 --rounds 10 --tc 10+0.1
+//   qt_chess_match --engine name=L5,level=5 --engine name=SF,cmd=/usr/bin/stockfish,level=3 --openings suite.epd
+// 每一對引擎以每個開局局面各下兩局（交換先後手）；所有引擎兩兩對戰（循環賽）。
+// 每局由兩個全新的 ChessEngine 進行（不共用置換表與走法快取），同時進行的局數預設為
+// 可同時執行的硬體執行緒數，每局同一時間只有行棋方在搜尋，因此剛好用滿所有核心
+
+namespace {
+
+const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// 引擎沒有在時限內回應時，超過時限多久判負
+constexpr int RESPONSE_GRACE_MS = 1000;
+constexpr int PGN_LINE_LENGTH = 80;
+
+struct EngineSpec {
+    QString name;
+    QString command = ChessEngine::BUILTIN_ENGINE;
+    int level = ChessEngine::MAX_SKILL_LEVEL;
+    int depth = 0;          // 0：依等級（與 Qt_Chess 相同）
+    int moveTimeMs = 0;     // 0：依等級或時間控制
+    int threads = 1;
+    int hashMb = 16;
+};
+
+// 以 "key=value,key=value" 描述一個引擎，例如 name=L5,level=5 或 cmd=/usr/bin/stockfish,level=3,threads=2
+bool parseEngineSpec(const QString& text, EngineSpec* spec, QString* error) {
+    for (const QString& field : text.split(',', Qt::SkipEmptyParts)) {
+        const int equals = field.indexOf('=');
+        const QString key = field.left(equals).trimmed();
+        const QString value = equals >= 0 ? field.mid(equals + 1).trimmed() : QString();
+        bool ok = true;
+        if (key == "name") {
+            spec->name = value;
+        } else if (key == "cmd") {
+            spec->command = value;
+        } else if (key == "level") {
+            spec->level = value.toInt(&ok);
+            ok = ok && spec->level >= 0 && spec->level <= ChessEngine::MAX_SKILL_LEVEL;
+        } else if (key == "depth") {
+            spec->depth = value.toInt(&ok);
+            ok = ok && spec->depth >= 1;
+        } else if (key == "movetime") {
+            spec->moveTimeMs = value.toInt(&ok);
+            ok = ok && spec->moveTimeMs >= 1;
+        } else if (key == "threads") {
+            spec->threads = value.toInt(&ok);
+            ok = ok && spec->threads >= 1;
+        } else if (key == "hash") {
+            spec->hashMb = value.toInt(&ok);
+            ok = ok && spec->hashMb >= 1;
+        } else {
+            *error = QString("unknown engine option '%1'").arg(key);
+            return false;
+        }
+        if (!ok) {
+            *error = QString("invalid value for %1: %2").arg(key, value);
+            return false;
+        }
+    }
+    if (spec->name.isEmpty()) {
+        spec->name = spec->command == ChessEngine::BUILTIN_ENGINE
+                   ? QString("Level %1").arg(spec->level) : spec->command.section('/', -1);
+    }
+    return true;
+}
+
+// 基本時間加每步加秒，例如 "60+0.5"（秒）
+struct TimeControl {
+    bool enabled = false;
+    qint64 baseMs = 0;
+    qint64 incrementMs = 0;
+
+    static bool parse(const QString& text, TimeControl* tc) {
+        const QStringList parts = text.split('+');
+        bool baseOk = false;
+        bool incrementOk = true;
+        const double base = parts.value(0).toDouble(&baseOk);
+        const double increment = parts.size() > 1 ? parts[1].toDouble(&incrementOk) : 0.0;
+        if (parts.size() > 2 || !baseOk || !incrementOk || base <= 0 || increment < 0) return false;
+        tc->enabled = true;
+        tc->baseMs = qRound64(base * 1000);
+        tc->incrementMs = qRound64(increment * 1000);
+        return true;
+    }
+
+    QString toPgn() const {
+        QString text = QString::number(baseMs / 1000.0, 'g', 6);
+        if (incrementMs > 0) text += "+" + QString::number(incrementMs / 1000.0, 'g', 6);
+        return text;
+    }
+};
+
+struct Opening {
+    QString fen;            // 空字串為初始局面
+    QString name;
+};
+
+// 每行一個 FEN（6 個欄位）或 EPD（4 個欄位加上操作碼，例如 id "..."）；空行與 # 開頭的行略過
+bool loadOpenings(const QString& path, QVector<Opening>* openings, QTextStream& err) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        err << "Cannot open opening suite: " << path << "\n";
+        return false;
+    }
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        const QStringList fields = line.split(' ', Qt::SkipEmptyParts);
+        if (fields.size() < 4) {
+            err << path << ":" << lineNumber << ": not a FEN/EPD line\n";
+            continue;
+        }
+        Opening opening;
+        bool isFen = false;
+        if (fields.size() >= 6) {
+            fields[4].toInt(&isFen);
+        }
+        if (isFen) {
+            opening.fen = fields.mid(0, 6).join(' ');
+        } else {
+            opening.fen = fields.mid(0, 4).join(' ') + " 0 1";
+            const int id = line.indexOf("id \"");
+            if (id >= 0) {
+                opening.name = line.mid(id + 4).section('"', 0, 0);
+            }
+        }
+
+        ChessBoard board;
+        if (!board.setFromFEN(opening.fen)) {
+            err << path << ":" << lineNumber << ": invalid position\n";
+            continue;
+        }
+        openings->append(opening);
+    }
+    return true;
+}
+
+struct Score {
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+
+    int games() const { return wins + draws + losses; }
+    double points() const { return wins + draws * 0.5; }
+    double ratio() const { return games() > 0 ? points() / games() : 0.0; }
+};
+
+double eloFromScore(double score) {
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+QString formatElo(double elo) {
+    if (std::isinf(elo)) return elo > 0 ? "+inf" : "-inf";
+    return QString("%1%2").arg(elo >= 0 ? "+" : "").arg(elo, 0, 'f', 1);
+}
+
+// 95% 信賴區間的半寬（以每局得分的標準差估計），全勝或全負時無法估計
+QString eloError(const Score& score) {
+    const int n = score.games();
+    const double mu = score.ratio();
+    if (n == 0 || mu <= 0.0 || mu >= 1.0) return "-";
+    const double variance = (score.wins * std::pow(1.0 - mu, 2)
+                             + score.draws * std::pow(0.5 - mu, 2)
+                             + score.losses * std::pow(0.0 - mu, 2)) / n;
+    const double deviation = std::sqrt(variance / n);
+    const double low = qMax(1e-6, mu - 1.959964 * deviation);
+    const double high = qMin(1.0 - 1e-6, mu + 1.959964 * deviation);
+    return QString::number((eloFromScore(high) - eloFromScore(low)) / 2.0, 'f', 1);
+}
+
+// 較強的機率（Likelihood of Superiority）：和棋不提供資訊，只看勝負局數
+double likelihoodOfSuperiority(const Score& score) {
+    if (score.wins + score.losses == 0) return 0.5;
+    return 0.5 * (1.0 + std::erf((score.wins - score.losses) / std::sqrt(2.0 * (score.wins + score.losses))));
+}
+
+struct GameTask {
+    int number = 0;
+    int round = 0;
+    int white = 0;          // 引擎編號
+    int black = 0;
+    Opening opening;
+};
+
+struct GameResult {
+    QString result;         // "1-0"、"0-1"、"1/2-1/2"
+    QString termination;    // PGN Termination 標頭
+    QString reason;         // 結束原因（寫在棋譜最後的註解）
+};
+
+// 一局進行中的對局：兩個引擎各自負責一方，棋盤與棋鐘由這裡維護
+class MatchGame : public QObject {
+public:
+    MatchGame(const GameTask& task, const EngineSpec& white, const EngineSpec& black,
+              const TimeControl& tc, int maxPlies, QObject* parent)
+        : QObject(parent)
+        , m_task(task)
+        , m_tc(tc)
+        , m_maxPlies(maxPlies)
+        , m_finished(false)
+        , m_moveTimer(new QTimer(this))
+    {
+        m_specs[0] = white;
+        m_specs[1] = black;
+        m_clockMs[0] = m_clockMs[1] = tc.baseMs;
+        m_moveTimer->setSingleShot(true);
+        connect(m_moveTimer, &QTimer::timeout, this, [this]() {
+            const int side = sideToMove();
+            finish(side == 0 ? "0-1" : "1-0", "time forfeit",
+                   QString("%1 did not move in time").arg(m_specs[side].name));
+        });
+    }
+
+    std::function<void(MatchGame*)> onFinished;
+
+    const GameTask& task() const { return m_task; }
+    const GameResult& result() const { return m_result; }
+
+    void start() {
+        if (!m_task.opening.fen.isEmpty()) {
+            m_board.setFromFEN(m_task.opening.fen);
+        } else {
+            m_board.initializeBoard();
+        }
+
+        for (int side = 0; side < 2; ++side) {
+            const EngineSpec& spec = m_specs[side];
+            ChessEngine* engine = new ChessEngine(this);
+            m_engines[side] = engine;
+            engine->setHashSize(spec.hashMb);
+            engine->setThreadCount(spec.threads);
+            engine->setDifficulty(spec.level);
+            engine->setSearchDepth(spec.depth > 0 ? spec.depth : Difficulty::searchDepth(spec.level));
+            engine->setThinkingTime(spec.moveTimeMs > 0 ? spec.moveTimeMs : Difficulty::thinkingTimeMs(spec.level));
+
+            connect(engine, &ChessEngine::engineReady, this, [this, side]() {
+                // 外部引擎每次 readyok 都會發出 engineReady，只在雙方第一次就緒時開始
+                if (m_ready[side]) return;
+                m_ready[side] = true;
+                if (m_ready[0] && m_ready[1]) requestMove();
+            });
+            connect(engine, &ChessEngine::bestMoveFound, this, [this, side](const QString& move) {
+                onBestMove(side, move);
+            });
+            connect(engine, &ChessEngine::engineError, this, [this, side](const QString& error) {
+                finish(side == 0 ? "0-1" : "1-0", "rules infraction",
+                       QString("%1: %2").arg(m_specs[side].name, error));
+            });
+            if (!engine->startEngine(spec.command)) {
+                return;   // engineError 已判負
+            }
+        }
+    }
+
+    // 產生這一局的 PGN（標頭、SAN 棋譜、結束原因）
+    QString pgn(const QString& event, const TimeControl& tc) const {
+        QString text;
+        text += QString("[Event \"%1\"]\n").arg(event);
+        text += "[Site \"Qt_Chess\"]\n";
+        text += QString("[Date \"%1\"]\n").arg(QDate::currentDate().toString("yyyy.MM.dd"));
+        text += QString("[Round \"%1\"]\n").arg(m_task.round);
+        text += QString("[White \"%1\"]\n").arg(m_specs[0].name);
+        text += QString("[Black \"%1\"]\n").arg(m_specs[1].name);
+        text += QString("[Result \"%1\"]\n").arg(m_result.result);
+        if (!m_task.opening.fen.isEmpty()) {
+            text += "[SetUp \"1\"]\n";
+            text += QString("[FEN \"%1\"]\n").arg(m_task.opening.fen);
+        }
+        if (!m_task.opening.name.isEmpty()) {
+            text += QString("[Opening \"%1\"]\n").arg(m_task.opening.name);
+        }
+        text += QString("[PlyCount \"%1\"]\n").arg(static_cast<int>(m_board.getMoveHistory().size()));
+        text += QString("[TimeControl \"%1\"]\n").arg(tc.enabled ? tc.toPgn() : QString("-"));
+        text += QString("[Termination \"%1\"]\n\n").arg(m_result.termination);
+
+        // 棋譜從開局局面的回合數與行棋方開始編號
+        ChessBoard start;
+        if (!m_task.opening.fen.isEmpty()) start.setFromFEN(m_task.opening.fen);
+        int moveNumber = start.getFullmoveNumber();
+        bool whiteToMove = start.getCurrentPlayer() == PieceColor::White;
+
+        QStringList tokens;
+        const int plies = static_cast<int>(m_board.getMoveHistory().size());
+        for (int i = 0; i < plies; ++i) {
+            if (whiteToMove) {
+                tokens << QString("%1.").arg(moveNumber);
+            } else if (i == 0) {
+                tokens << QString("%1...").arg(moveNumber);
+            }
+            tokens << m_board.getMoveNotation(i);
+            if (!whiteToMove) ++moveNumber;
+            whiteToMove = !whiteToMove;
+        }
+        tokens << QString("{%1}").arg(m_result.reason) << m_result.result;
+
+        QString line;
+        for (const QString& token : tokens) {
+            if (!line.isEmpty() && line.size() + 1 + token.size() > PGN_LINE_LENGTH) {
+                text += line + "\n";
+                line.clear();
+            }
+            if (!line.isEmpty()) line += " ";
+            line += token;
+        }
+        text += line + "\n\n";
+        return text;
+    }
+
+private:
+    GameTask m_task;
+    EngineSpec m_specs[2];
+    ChessEngine* m_engines[2] = { nullptr, nullptr };
+    TimeControl m_tc;
+    int m_maxPlies;
+    qint64 m_clockMs[2];
+    bool m_ready[2] = { false, false };
+    bool m_finished;
+    ChessBoard m_board;
+    QStringList m_uciMoves;
+    QElapsedTimer m_thinkTimer;
+    QTimer* m_moveTimer;
+    GameResult m_result;
+
+    int sideToMove() const { return m_board.getCurrentPlayer() == PieceColor::White ? 0 : 1; }
+
+    void requestMove() {
+        if (m_finished) return;
+        const int side = sideToMove();
+        const EngineSpec& spec = m_specs[side];
+        ChessEngine* engine = m_engines[side];
+
+        // 有時間控制時引擎收到雙方棋鐘（wtime/btime/winc/binc）自行分配；指定 movetime 的引擎不受棋鐘影響
+        const bool useClock = m_tc.enabled && spec.moveTimeMs == 0;
+        if (useClock) {
+            engine->setClock(static_cast<int>(m_clockMs[0]), static_cast<int>(m_clockMs[1]),
+                             static_cast<int>(m_tc.incrementMs), static_cast<int>(m_tc.incrementMs));
+        } else {
+            engine->clearClock();
+        }
+
+        engine->setPositionFromMoves(m_uciMoves, m_task.opening.fen);
+        m_thinkTimer.start();
+        const qint64 limitMs = m_tc.enabled ? m_clockMs[side] : engine->getThinkingTime();
+        m_moveTimer->start(static_cast<int>(limitMs + RESPONSE_GRACE_MS));
+        engine->requestMove();
+    }
+
+    void onBestMove(int side, const QString& uci) {
+        if (m_finished || side != sideToMove()) return;
+        m_moveTimer->stop();
+        const qint64 elapsed = m_thinkTimer.elapsed();
+
+        const QString winner = side == 0 ? "0-1" : "1-0";
+        if (m_tc.enabled) {
+            m_clockMs[side] -= elapsed;
+            if (m_clockMs[side] < 0) {
+                finish(winner, "time forfeit", QString("%1 loses on time").arg(m_specs[side].name));
+                return;
+            }
+            m_clockMs[side] += m_tc.incrementMs;
+        }
+
+        const Move move = ChessEngine::uciToBoardMove(m_board, uci);
+        if (move.isNull() || !m_board.movePiece(move.fromPoint(), move.toPoint())) {
+            finish(winner, "rules infraction", QString("%1 played an illegal move %2").arg(m_specs[side].name, uci));
+            return;
+        }
+        if (move.isPromotion()) {
+            m_board.promotePawn(move.toPoint(), move.promotionType());
+        }
+        m_uciMoves << uci;
+
+        if (!checkGameEnd()) {
+            requestMove();
+        }
+    }
+
+    // 與 Qt_Chess::updateStatus() 相同的判定順序
+    bool checkGameEnd() {
+        const PieceColor player = m_board.getCurrentPlayer();
+        if (m_board.isCheckmate(player)) {
+            finish(player == PieceColor::White ? "0-1" : "1-0", "normal",
+                   QString("%1 mates").arg(player == PieceColor::White ? "Black" : "White"));
+        } else if (m_board.isStalemate(player)) {
+            finish("1/2-1/2", "normal", "Stalemate");
+        } else if (m_board.isInsufficientMaterial()) {
+            finish("1/2-1/2", "normal", "Insufficient material");
+        } else if (m_board.isThreefoldRepetition()) {
+            finish("1/2-1/2", "normal", "Threefold repetition");
+        } else if (m_board.isFiftyMoveRule()) {
+            finish("1/2-1/2", "normal", "Fifty-move rule");
+        } else if (m_maxPlies > 0 && static_cast<int>(m_uciMoves.size()) >= m_maxPlies) {
+            finish("1/2-1/2", "adjudication", "Maximum game length reached");
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void finish(const QString& result, const QString& termination, const QString& reason) {
+        if (m_finished) return;
+        m_finished = true;
+        m_moveTimer->stop();
+        m_result.result = result;
+        m_result.termination = termination;
+        m_result.reason = reason;
+        for (ChessEngine* engine : m_engines) {
+            if (engine) engine->stopEngine();
+        }
+        // 引擎的信號可能仍在呼叫堆疊上，回到事件迴圈後才通知
+        QTimer::singleShot(0, this, [this]() {
+            if (onFinished) onFinished(this);
+        });
+    }
+};
+
+// 排程所有對局，維持固定數量的同時對局，並累計統計
+class MatchRunner : public QObject {
+public:
+    MatchRunner(const QVector<EngineSpec>& engines, const QVector<GameTask>& tasks, const TimeControl& tc,
+                int concurrency, int maxPlies, const QString& event, QFile* pgnFile, QTextStream& out)
+        : m_engines(engines)
+        , m_tasks(tasks)
+        , m_tc(tc)
+        , m_concurrency(concurrency)
+        , m_maxPlies(maxPlies)
+        , m_event(event)
+        , m_pgnFile(pgnFile)
+        , m_out(out)
+        , m_nextTask(0)
+        , m_running(0)
+        , m_completed(0)
+        , m_totals(engines.size())
+    {
+    }
+
+    void start() {
+        m_timer.start();
+        m_out << "Playing " << m_tasks.size() << " games between " << m_engines.size()
+              << " engines, " << m_concurrency << " at a time\n";
+        m_out.flush();
+        fill();
+    }
+
+    void printSummary(int anchorIndex, double anchorElo) const {
+        m_out << "\nFinished " << m_completed << " games in "
+              << QString::number(m_timer.elapsed() / 1000.0, 'f', 1) << " s\n\n";
+
+        for (auto it = m_pairScores.constBegin(); it != m_pairScores.constEnd(); ++it) {
+            const int first = it.key() >> 16;
+            const int second = it.key() & 0xFFFF;
+            const Score& score = it.value();
+            m_out << m_engines[first].name << " vs " << m_engines[second].name << ": "
+                  << "+" << score.wins << " =" << score.draws << " -" << score.losses
+                  << "  score " << QString::number(score.ratio() * 100.0, 'f', 1) << "%"
+                  << "  Elo " << formatElo(eloFromScore(score.ratio())) << " +/- " << eloError(score)
+                  << "  LOS " << QString::number(likelihoodOfSuperiority(score) * 100.0, 'f', 1) << "%\n";
+        }
+
+        const QVector<double> ratings = estimateRatings(anchorIndex, anchorElo);
+        m_out << "\nRatings (" << m_engines[anchorIndex].name << " anchored at " << anchorElo << "):\n";
+        for (int i = 0; i < m_engines.size(); ++i) {
+            const Score& score = m_totals[i];
+            m_out << "  " << m_engines[i].name.leftJustified(16)
+                  << " Elo " << QString::number(ratings[i], 'f', 0).rightJustified(6)
+                  << "  games " << QString::number(score.games()).rightJustified(5)
+                  << "  score " << QString::number(score.ratio() * 100.0, 'f', 1).rightJustified(5) << "%";
+            if (m_engines[i].command == ChessEngine::BUILTIN_ENGINE) {
+                m_out << "  nominal " << Difficulty::nominalElo(m_engines[i].level);
+            }
+            m_out << "\n";
+        }
+        m_out.flush();
+    }
+
+    std::function<void()> onFinished;
+
+private:
+    QVector<EngineSpec> m_engines;
+    QVector<GameTask> m_tasks;
+    TimeControl m_tc;
+    int m_concurrency;
+    int m_maxPlies;
+    QString m_event;
+    QFile* m_pgnFile;
+    QTextStream& m_out;
+    int m_nextTask;
+    int m_running;
+    int m_completed;
+    QElapsedTimer m_timer;
+    QVector<Score> m_totals;
+    QMap<int, Score> m_pairScores;             // (較小的引擎編號 << 16 | 較大的編號) → 以前者角度的成績
+    QHash<int, QHash<int, Score>> m_matrix;    // m_matrix[i][j]：i 對 j 的成績（估計 Elo 用）
+
+    void fill() {
+        while (m_running < m_concurrency && m_nextTask < m_tasks.size()) {
+            const GameTask& task = m_tasks[m_nextTask++];
+            MatchGame* game = new MatchGame(task, m_engines[task.white], m_engines[task.black],
+                                            m_tc, m_maxPlies, this);
+            game->onFinished = [this](MatchGame* finished) { onGameFinished(finished); };
+            ++m_running;
+            game->start();
+        }
+        if (m_running == 0 && onFinished) {
+            onFinished();
+        }
+    }
+
+    void onGameFinished(MatchGame* game) {
+        --m_running;
+        ++m_completed;
+        const GameTask& task = game->task();
+        const GameResult& result = game->result();
+
+        const double whitePoints = result.result == "1-0" ? 1.0 : result.result == "0-1" ? 0.0 : 0.5;
+        record(task.white, task.black, whitePoints);
+        record(task.black, task.white, 1.0 - whitePoints);
+
+        if (m_pgnFile) {
+            m_pgnFile->write(game->pgn(m_event, m_tc).toUtf8());
+            m_pgnFile->flush();
+        }
+
+        const Score& total = m_totals[0];
+        m_out << "Game " << task.number << "/" << m_tasks.size() << " (" << m_completed << " done): "
+              << m_engines[task.white].name << " - " << m_engines[task.black].name << " "
+              << result.result << " {" << result.reason << "}  "
+              << m_engines[0].name << ": +" << total.wins << " =" << total.draws << " -" << total.losses << "\n";
+        m_out.flush();
+
+        game->deleteLater();
+        fill();
+    }
+
+    void record(int engine, int opponent, double points) {
+        auto add = [points](Score& score) {
+            if (points > 0.75) ++score.wins;
+            else if (points < 0.25) ++score.losses;
+            else ++score.draws;
+        };
+        add(m_totals[engine]);
+        add(m_matrix[engine][opponent]);
+        if (engine < opponent) {
+            add(m_pairScores[(engine << 16) | opponent]);
+        }
+    }
+
+    // 以所有對局估計各引擎的 Elo（Bradley-Terry 模型的反覆修正），並平移使指定的引擎為 anchorElo
+    QVector<double> estimateRatings(int anchorIndex, double anchorElo) const {
+        const int count = m_engines.size();
+        QVector<double> ratings(count, 0.0);
+        for (int iteration = 0; iteration < 500; ++iteration) {
+            for (int i = 0; i < count; ++i) {
+                double expected = 0.0;
+                double actual = 0.0;
+                int games = 0;
+                const QHash<int, Score> opponents = m_matrix.value(i);
+                for (auto it = opponents.constBegin(); it != opponents.constEnd(); ++it) {
+                    const Score& score = it.value();
+                    expected += score.games() / (1.0 + std::pow(10.0, (ratings[it.key()] - ratings[i]) / 400.0));
+                    actual += score.points();
+                    games += score.games();
+                }
+                if (games == 0) continue;
+                // 全勝或全負時 Elo 沒有上下限，以半局修正
+                actual = qBound(0.5, actual, games - 0.5);
+                ratings[i] += 400.0 * std::log10(actual / expected);
+            }
+        }
+        const double shift = anchorElo - ratings[anchorIndex];
+        for (double& rating : ratings) rating += shift;
+        return ratings;
+    }
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("qt_chess_match");
+    Bitboards::initSliderAttacks();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless engine-vs-engine match runner for Qt_Chess");
+    parser.addHelpOption();
+    QCommandLineOption engineOption("engine", "Add an engine: name=...,cmd=<path|builtin>,level=0-20,depth=N,movetime=ms,threads=N,hash=MB.", "spec");
+    QCommandLineOption levelsOption("levels", "Add built-in engines at these difficulty levels, e.g. 0,5,10,15,20.", "levels");
+    QCommandLineOption openingsOption("openings", "Opening suite (one FEN or EPD per line; default: initial position).", "file");
+    QCommandLineOption roundsOption("rounds", "Times each pairing plays every opening with both colours (default: 1).", "n", "1");
+    QCommandLineOption tcOption("tc", "Time control base+increment in seconds, e.g. 10+0.1 (default: per-level move time).", "tc");
+    QCommandLineOption concurrencyOption("concurrency", "Games played at the same time (default: ideal thread count / engine threads).", "n");
+    QCommandLineOption maxMovesOption("max-moves", "Adjudicate a draw after this many full moves (default: no limit).", "n", "0");
+    QCommandLineOption pgnOption("pgn", "PGN output file (default: match.pgn).", "file", "match.pgn");
+    QCommandLineOption eventOption("event", "PGN Event tag (default: Qt_Chess match).", "name", "Qt_Chess match");
+    QCommandLineOption anchorOption("anchor-elo", "Rating of the first engine in the summary (default: its nominal level Elo, or 0).", "elo");
+    parser.addOption(engineOption);
+    parser.addOption(levelsOption);
+    parser.addOption(openingsOption);
+    parser.addOption(roundsOption);
+    parser.addOption(tcOption);
+    parser.addOption(concurrencyOption);
+    parser.addOption(maxMovesOption);
+    parser.addOption(pgnOption);
+    parser.addOption(eventOption);
+    parser.addOption(anchorOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QVector<EngineSpec> engines;
+    for (const QString& text : parser.values(engineOption)) {
+        EngineSpec spec;
+        QString error;
+        if (!parseEngineSpec(text, &spec, &error)) {
+            err << "Invalid engine '" << text << "': " << error << "\n";
+            return 2;
+        }
+        engines.append(spec);
+    }
+    if (parser.isSet(levelsOption)) {
+        for (const QString& text : parser.value(levelsOption).split(',', Qt::SkipEmptyParts)) {
+            EngineSpec spec;
+            QString error;
+            if (!parseEngineSpec("level=" + text.trimmed(), &spec, &error)) {
+                err << "Invalid level '" << text << "': " << error << "\n";
+                return 2;
+            }
+            engines.append(spec);
+        }
+    }
+    if (engines.size() < 2) {
+        err << "At least two engines are needed (--engine or --levels)\n";
+        return 2;
+    }
+
+    QVector<Opening> openings;
+    if (parser.isSet(openingsOption)) {
+        if (!loadOpenings(parser.value(openingsOption), &openings, err)) return 2;
+        if (openings.isEmpty()) {
+            err << "The opening suite has no valid positions\n";
+            return 2;
+        }
+    } else {
+        openings.append(Opening());
+    }
+
+    bool ok = false;
+    const int rounds = parser.value(roundsOption).toInt(&ok);
+    if (!ok || rounds < 1) {
+        err << "Invalid round count: " << parser.value(roundsOption) << "\n";
+        return 2;
+    }
+    const int maxMoves = parser.value(maxMovesOption).toInt(&ok);
+    if (!ok || maxMoves < 0) {
+        err << "Invalid move limit: " << parser.value(maxMovesOption) << "\n";
+        return 2;
+    }
+
+    TimeControl tc;
+    if (parser.isSet(tcOption) && !TimeControl::parse(parser.value(tcOption), &tc)) {
+        err << "Invalid time control: " << parser.value(tcOption) << "\n";
+        return 2;
+    }
+
+    // 每局同一時間只有一方在搜尋，同時進行的局數 × 每個引擎的執行緒數 = 硬體執行緒數
+    int maxThreads = 1;
+    for (const EngineSpec& spec : engines) maxThreads = qMax(maxThreads, spec.threads);
+    int concurrency = qMax(1, QThread::idealThreadCount() / maxThreads);
+    if (parser.isSet(concurrencyOption)) {
+        concurrency = parser.value(concurrencyOption).toInt(&ok);
+        if (!ok || concurrency < 1) {
+            err << "Invalid concurrency: " << parser.value(concurrencyOption) << "\n";
+            return 2;
+        }
+    }
+
+    // 循環賽：每一對引擎、每一輪、每個開局各下兩局並交換先後手
+    QVector<GameTask> tasks;
+    for (int round = 1; round <= rounds; ++round) {
+        for (int first = 0; first < engines.size(); ++first) {
+            for (int second = first + 1; second < engines.size(); ++second) {
+                for (const Opening& opening : openings) {
+                    for (int swap = 0; swap < 2; ++swap) {
+                        GameTask task;
+                        task.number = tasks.size() + 1;
+                        task.round = round;
+                        task.white = swap ? second : first;
+                        task.black = swap ? first : second;
+                        task.opening = opening;
+                        tasks.append(task);
+                    }
+                }
+            }
+        }
+    }
+
+    QFile pgnFile(parser.value(pgnOption));
+    if (!pgnFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err << "Cannot write PGN file: " << pgnFile.fileName() << "\n";
+        return 2;
+    }
+
+    double anchorElo = engines[0].command == ChessEngine::BUILTIN_ENGINE ? Difficulty::nominalElo(engines[0].level) : 0.0;
+    if (parser.isSet(anchorOption)) {
+        anchorElo = parser.value(anchorOption).toDouble(&ok);
+        if (!ok) {
+            err << "Invalid anchor rating: " << parser.value(anchorOption) << "\n";
+            return 2;
+        }
+    }
+
+    MatchRunner runner(engines, tasks, tc, concurrency, maxMoves * 2, parser.value(eventOption), &pgnFile, out);
+    runner.onFinished = [&]() {
+        runner.printSummary(0, anchorElo);
+        out << "PGN written to " << pgnFile.fileName() << "\n";
+        out.flush();
+        QCoreApplication::quit();
+    };
+    QTimer::singleShot(0, &runner, [&runner]() { runner.start(); });
+    return app.exec();
+}
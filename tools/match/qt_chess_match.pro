@@ -0,0 +1,40 @@
+# 無介面的對戰工具：只依賴 QtCore，以 ChessEngine / ChessBoard 同時進行多局引擎對弈，
+# 輸出 PGN 與勝率／Elo 統計，用來校準各難度等級
+QT       = core
+CONFIG  += c++17 console
+CONFIG  -= app_bundle
+
+TARGET = qt_chess_match
+
+INCLUDEPATH += $$PWD/../../src
+
+# 與主程式相同：CONFIG+=pext 時使用 PEXT 查詢滑動棋子攻擊
+pext {
+    DEFINES += QT_CHESS_USE_PEXT
+    gcc|clang: QMAKE_CXXFLAGS += -mbmi2
+    msvc: QMAKE_CXXFLAGS += /arch:AVX2
+}
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../src/bitboard.cpp \
+    $$PWD/../../src/chesspiece.cpp \
+    $$PWD/../../src/chessboard.cpp \
+    $$PWD/../../src/transpositiontable.cpp \
+    $$PWD/../../src/searchengine.cpp \
+    $$PWD/../../src/timemanager.cpp \
+    $$PWD/../../src/uciinfo.cpp \
+    $$PWD/../../src/chessengine.cpp
+
+HEADERS += \
+    $$PWD/../../src/bitboard.h \
+    $$PWD/../../src/chesspiece.h \
+    $$PWD/../../src/chessmove.h \
+    $$PWD/../../src/zobrist.h \
+    $$PWD/../../src/chessboard.h \
+    $$PWD/../../src/transpositiontable.h \
+    $$PWD/../../src/searchengine.h \
+    $$PWD/../../src/timemanager.h \
+    $$PWD/../../src/uciinfo.h \
+    $$PWD/../../src/chessengine.h \
+    $$PWD/../../src/difficulty.h
@@ -0,0 +1,575 @@
+#include "chessboard.h"
+#include "searchengine.h"
+#include "transpositiontable.h"
+#include "tablebase.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+
+// ===== qt_chess_perft：規則核心的 perft 驗證與效能量測工具 =====
+// 用法：
+//   qt_chess_perft [--fen <FEN>] [--depth <N>] [--divide]   從指定局面計算 perft
+//   qt_chess_perft --suite                                  執行內建的標準 perft 測試組與重複局面檢查（失敗時回傳非零）
+//   加上 --verify-hash 時，在每個節點比對增量 Zobrist 鍵與重新計算的結果
+//   qt_chess_perft --search-bench [--depth <N>] [--threads <N>]  以 1、2、4…個執行緒搜尋固定局面，列出加速比
+//   qt_chess_perft --tablebase-check <目錄>                  以逆向分析的結果驗證 KQvK / KRvK 的 Syzygy 查詢
+
+namespace {
+
+const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct PerftCase {
+    const char* name;
+    const char* fen;
+    int depth;
+    quint64 nodes;
+};
+
+// 標準 perft 測試局面（數值取自公開的 perft 結果表）
+const PerftCase PERFT_SUITE[] = {
+    { "initial",              START_FEN, 5, 4865609ULL },
+    { "kiwipete",             "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603ULL },
+    { "position3",            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624ULL },
+    { "position4",            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333ULL },
+    { "position4-mirrored",   "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 4, 422333ULL },
+    { "position5",            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487ULL },
+    { "position6",            "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594ULL },
+    { "illegal-ep-1",         "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888ULL },
+    { "illegal-ep-2",         "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133ULL },
+    { "ep-capture-checks",    "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467ULL },
+    { "short-castling-check", "5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072ULL },
+    { "long-castling-check",  "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711ULL },
+    { "castle-rights",        "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206ULL },
+    { "castling-prevented",   "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476ULL },
+    { "promote-out-of-check", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001ULL },
+    { "discovered-check",     "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658ULL },
+    { "promote-give-check",   "4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342ULL },
+    { "under-promote-check",  "8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683ULL },
+    { "self-stalemate",       "K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217ULL },
+    { "stalemate-checkmate",  "8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584ULL },
+    { "double-check",         "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527ULL },
+};
+
+QString moveToUCI(const Move& move) {
+    static const char promotionChars[] = { 'n', 'b', 'r', 'q' };
+    QPoint from = move.fromPoint();
+    QPoint to = move.toPoint();
+    QString uci = QString("%1%2%3%4")
+        .arg(QChar('a' + from.x())).arg(8 - from.y())
+        .arg(QChar('a' + to.x())).arg(8 - to.y());
+    if (move.isPromotion()) {
+        uci += QChar(promotionChars[move.flags() & 3]);
+    }
+    return uci;
+}
+
+quint64 perft(ChessBoard& board, int depth) {
+    if (depth <= 0) return 1;
+
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    // 最後一層直接計算走法數量，不需實際執行
+    if (depth == 1) return static_cast<quint64>(moves.size());
+
+    quint64 nodes = 0;
+    for (const Move& move : moves) {
+        board.makeMove(move);
+        nodes += perft(board, depth - 1);
+        board.unmakeMove();
+    }
+    return nodes;
+}
+
+// 與 perft 相同，但在每個節點檢查增量雜湊是否與重新計算的結果一致、unmakeMove 是否還原雜湊
+quint64 perftVerifyHash(ChessBoard& board, int depth, quint64& hashErrors) {
+    if (board.hash() != board.computeHash()) ++hashErrors;
+    if (depth <= 0) return 1;
+
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    quint64 nodes = 0;
+    for (const Move& move : moves) {
+        quint64 key = board.hash();
+        board.makeMove(move);
+        nodes += perftVerifyHash(board, depth - 1, hashErrors);
+        board.unmakeMove();
+        if (board.hash() != key) ++hashErrors;
+    }
+    return nodes;
+}
+
+// 分別列出每一個根節點走法的節點數（與其他引擎比對時用來定位錯誤）
+quint64 divide(ChessBoard& board, int depth, QTextStream& out) {
+    MoveList moves;
+    board.generateLegalMoves(moves);
+
+    quint64 total = 0;
+    for (const Move& move : moves) {
+        board.makeMove(move);
+        quint64 nodes = perft(board, depth - 1);
+        board.unmakeMove();
+        out << moveToUCI(move) << ": " << nodes << "\n";
+        total += nodes;
+    }
+    out << "\n";
+    return total;
+}
+
+qint64 nodesPerSecond(quint64 nodes, qint64 elapsedNs) {
+    return elapsedNs > 0 ? static_cast<qint64>(nodes * 1e9 / elapsedNs) : 0;
+}
+
+// 重複局面計數：兵升變後的局面反覆出現時必須計入（升變在 movePiece 之後由 promotePawn 完成，
+// 與主視窗相同），並與不經升變、直接從同一局面開始的結果比對
+struct RepetitionCase {
+    const char* name;
+    const char* fen;
+    const char* promotionFrom;   // 空字串表示不先升變
+    const char* promotionTo;
+};
+
+const RepetitionCase REPETITION_SUITE[] = {
+    { "repetition",                   "Q7/8/8/8/7k/8/8/4K3 b - - 0 1", "", "" },
+    { "repetition-after-promotion",   "8/P7/8/8/7k/8/8/4K3 w - - 0 1", "a7", "a8" },
+};
+
+// 兩次來回 Kh5 Ke2 Kh4 Ke1 之後，升變後（或起始）的局面應分別出現 2 次與 3 次
+const char* const REPETITION_SHUFFLE[] = { "h4", "h5", "e1", "e2", "h5", "h4", "e2", "e1" };
+
+QPoint squareFromName(const char* name) {
+    return QPoint(name[0] - 'a', '8' - name[1]);
+}
+
+int runRepetitionChecks(QTextStream& out) {
+    int failures = 0;
+    for (const RepetitionCase& test : REPETITION_SUITE) {
+        ChessBoard board;
+        bool passed = board.setFromFEN(QString::fromLatin1(test.fen));
+        if (passed && test.promotionFrom[0]) {
+            passed = board.movePiece(squareFromName(test.promotionFrom), squareFromName(test.promotionTo));
+            board.promotePawn(squareFromName(test.promotionTo), PieceType::Queen);
+        }
+
+        QString counts;
+        for (int cycle = 1; passed && cycle <= 2; ++cycle) {
+            for (int i = 0; passed && i < 8; i += 2) {
+                passed = board.movePiece(squareFromName(REPETITION_SHUFFLE[i]), squareFromName(REPETITION_SHUFFLE[i + 1]));
+            }
+            const int count = board.repetitionCount();
+            counts += QString(" %1").arg(count);
+            passed = passed && count == cycle + 1;
+        }
+        passed = passed && board.isThreefoldRepetition();
+
+        if (!passed) ++failures;
+        out << (passed ? "ok   " : "FAIL ") << test.name << " repetition counts" << counts << " (expected 2 3)\n";
+        out.flush();
+    }
+    return failures;
+}
+
+int runSuite(QTextStream& out, bool verifyHash) {
+    int failures = 0;
+    quint64 totalNodes = 0;
+    qint64 totalNs = 0;
+
+    for (const PerftCase& test : PERFT_SUITE) {
+        ChessBoard board;
+        if (!board.setFromFEN(QString::fromLatin1(test.fen))) {
+            out << "FAIL " << test.name << ": invalid FEN\n";
+            ++failures;
+            continue;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        quint64 hashErrors = 0;
+        quint64 nodes = verifyHash ? perftVerifyHash(board, test.depth, hashErrors) : perft(board, test.depth);
+        qint64 elapsedNs = timer.nsecsElapsed();
+        totalNodes += nodes;
+        totalNs += elapsedNs;
+
+        bool passed = (nodes == test.nodes && hashErrors == 0);
+        if (!passed) ++failures;
+        out << (passed ? "ok   " : "FAIL ") << test.name
+            << " depth " << test.depth
+            << " nodes " << nodes;
+        if (nodes != test.nodes) out << " (expected " << test.nodes << ")";
+        if (hashErrors > 0) out << " (" << hashErrors << " hash mismatches)";
+        out << " " << elapsedNs / 1000000 << " ms "
+            << nodesPerSecond(nodes, elapsedNs) << " nps\n";
+        out.flush();
+    }
+
+    const int repetitionFailures = runRepetitionChecks(out);
+
+    int count = static_cast<int>(sizeof(PERFT_SUITE) / sizeof(PERFT_SUITE[0]));
+    out << "\n" << (count - failures) << "/" << count << " passed, "
+        << totalNodes << " nodes, " << totalNs / 1000000 << " ms, "
+        << nodesPerSecond(totalNodes, totalNs) << " nps\n";
+    return failures == 0 && repetitionFailures == 0 ? 0 : 1;
+}
+
+// 內建搜尋的多執行緒加速量測局面（開局、中局、殘局各取幾個）
+const char* const SEARCH_BENCH_FENS[] = {
+    START_FEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+// 每個執行緒數都使用全新的置換表搜尋同一組局面，加速比 = 單執行緒時間 / N 執行緒時間
+int runSearchBench(QTextStream& out, int depth, int maxThreads) {
+    QVector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.append(threads);
+    }
+    threadCounts.append(maxThreads);
+
+    out << "search bench: depth " << depth << ", up to " << maxThreads << " threads\n\n";
+    qint64 singleThreadNs = 0;
+    for (int threads : threadCounts) {
+        TranspositionTable table;
+        SearchEngine engine;
+        engine.setTranspositionTable(&table);
+        engine.setThreadCount(threads);
+
+        SearchLimits limits;
+        limits.maxDepth = depth;
+
+        quint64 nodes = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (const char* fen : SEARCH_BENCH_FENS) {
+            ChessBoard board;
+            board.setFromFEN(QString::fromLatin1(fen));
+            table.clear();
+            nodes += engine.search(board, limits).nodes;
+        }
+        qint64 elapsedNs = timer.nsecsElapsed();
+        if (threads == 1) singleThreadNs = elapsedNs;
+
+        out << threads << " threads: " << elapsedNs / 1000000 << " ms "
+            << nodes << " nodes " << nodesPerSecond(nodes, elapsedNs) << " nps speedup "
+            << QString::number(elapsedNs > 0 ? static_cast<double>(singleThreadNs) / elapsedNs : 0.0, 'f', 2)
+            << "\n";
+        out.flush();
+    }
+    return 0;
+}
+
+// ===== Syzygy 查詢驗證 =====
+// KQvK 與 KRvK 沒有兵，弱方唯一的歸零走法是吃掉強方的棋子（成為 KvK 和棋），將殺在 100 個半步以內，
+// 因此逆向分析得到的將殺距離（DTM）同時就是 DTZ。每個合法局面都與殘局庫的 WDL / DTZ 比對，
+// 並以顏色互換、上下翻轉的局面再查一次（殘局庫以同一張表處理兩種顏色）
+struct TablebaseCase {
+    const char* name;
+    char piece;        // 強方棋子的 FEN 字元（白方）
+};
+
+const TablebaseCase TABLEBASE_CASES[] = {
+    { "KQvK", 'Q' },
+    { "KRvK", 'R' },
+};
+
+constexpr int TB_SQUARES = 64;
+constexpr int TB_POSITIONS = 2 * TB_SQUARES * TB_SQUARES * TB_SQUARES;
+constexpr int TB_UNKNOWN = -1;
+
+// 索引：行棋方（0 白、1 黑）、白王、黑王、強方棋子；格子索引 0 為 a8，與 ChessBoard 相同
+int tablebaseIndex(int blackToMove, int whiteKing, int blackKing, int piece) {
+    return ((blackToMove * TB_SQUARES + whiteKing) * TB_SQUARES + blackKing) * TB_SQUARES + piece;
+}
+
+// mirrored 為 true 時顏色互換並上下翻轉：強方為黑方，行棋方也互換
+QString tablebaseFen(char piece, int blackToMove, int whiteKing, int blackKing, int pieceSquare, bool mirrored) {
+    char squares[TB_SQUARES] = {};
+    const int flip = mirrored ? 56 : 0;
+    squares[whiteKing ^ flip] = mirrored ? 'k' : 'K';
+    squares[blackKing ^ flip] = mirrored ? 'K' : 'k';
+    squares[pieceSquare ^ flip] = mirrored ? static_cast<char>(piece + ('a' - 'A')) : piece;
+
+    QString fen;
+    for (int row = 0; row < 8; ++row) {
+        int empty = 0;
+        for (int col = 0; col < 8; ++col) {
+            const char c = squares[row * 8 + col];
+            if (!c) {
+                ++empty;
+                continue;
+            }
+            if (empty) fen += QString::number(empty);
+            empty = 0;
+            fen += QChar(c);
+        }
+        if (empty) fen += QString::number(empty);
+        if (row < 7) fen += '/';
+    }
+    const bool whiteToMove = (blackToMove == 0) != mirrored;
+    fen += whiteToMove ? " w - - 0 1" : " b - - 0 1";
+    return fen;
+}
+
+bool kingsAdjacent(int a, int b) {
+    return qAbs(Bitboards::rowOf(a) - Bitboards::rowOf(b)) <= 1 && qAbs(Bitboards::colOf(a) - Bitboards::colOf(b)) <= 1;
+}
+
+// 逆向分析：dtm[i] 為行棋方被將死或將死對方的半步數，TB_UNKNOWN 為和棋或不合法的局面
+QVector<int> solveTablebaseCase(char piece, QVector<bool>& legal) {
+    const PieceType pieceType = piece == 'Q' ? PieceType::Queen : PieceType::Rook;
+    legal.fill(false, TB_POSITIONS);
+    QVector<int> dtm(TB_POSITIONS, TB_UNKNOWN);
+    // 每個局面的後繼局面索引；吃掉強方棋子（和棋）記為 TB_UNKNOWN
+    std::vector<std::vector<int>> successors(TB_POSITIONS);
+
+    ChessBoard board;
+    for (int index = 0; index < TB_POSITIONS; ++index) {
+        const int pieceSquare = index % TB_SQUARES;
+        const int blackKing = index / TB_SQUARES % TB_SQUARES;
+        const int whiteKing = index / (TB_SQUARES * TB_SQUARES) % TB_SQUARES;
+        const int blackToMove = index / (TB_SQUARES * TB_SQUARES * TB_SQUARES);
+        if (whiteKing == blackKing || pieceSquare == whiteKing || pieceSquare == blackKing) continue;
+        if (kingsAdjacent(whiteKing, blackKing)) continue;
+        if (!board.setFromFEN(tablebaseFen(piece, blackToMove, whiteKing, blackKing, pieceSquare, false))) continue;
+        // 沒有輪到的一方不可被將軍
+        if (board.isInCheck(blackToMove ? PieceColor::White : PieceColor::Black)) continue;
+        legal[index] = true;
+
+        MoveList moves;
+        board.generateLegalMoves(moves);
+        if (moves.isEmpty()) {
+            if (board.isInCheck(board.getCurrentPlayer())) dtm[index] = 0;  // 被將死
+            continue;
+        }
+        for (const Move& move : moves) {
+            board.makeMove(move);
+            const Bitboard pieces = board.pieceBitboard(pieceType, PieceColor::White);
+            successors[index].push_back(pieces
+                ? tablebaseIndex(1 - blackToMove, board.kingSquare(PieceColor::White),
+                                 board.kingSquare(PieceColor::Black), Bitboards::lsb(pieces))
+                : TB_UNKNOWN);
+            board.unmakeMove();
+        }
+    }
+
+    // 第 n 輪：白方只要有一步走到 n-1 步被將死的局面即獲勝；黑方所有走法都走到白方獲勝的局面時落敗
+    for (int ply = 1; ; ++ply) {
+        int resolved = 0;
+        for (int index = 0; index < TB_POSITIONS; ++index) {
+            if (!legal[index] || dtm[index] != TB_UNKNOWN || successors[index].empty()) continue;
+            const bool whiteToMove = index < TB_POSITIONS / 2;
+            bool done = !whiteToMove;
+            int longest = 0;
+            for (int next : successors[index]) {
+                const int value = next == TB_UNKNOWN ? TB_UNKNOWN : dtm[next];
+                if (whiteToMove && value == ply - 1 && value % 2 == 0) {
+                    done = true;
+                    break;
+                }
+                if (!whiteToMove) {
+                    if (value == TB_UNKNOWN || value >= ply) {
+                        done = false;
+                        break;
+                    }
+                    longest = qMax(longest, value);
+                }
+            }
+            if (done && (whiteToMove || longest == ply - 1)) {
+                dtm[index] = ply;
+                ++resolved;
+            }
+        }
+        if (resolved == 0 && ply > 1) break;
+    }
+    return dtm;
+}
+
+// 從局面開始雙方都走 probeRoot() 的走法，回傳強方將死對方所用的半步數（100 個半步內沒有將死時為 -1）
+int playOutTablebase(const Tablebase& tablebase, ChessBoard board) {
+    for (int ply = 0; ply < 100; ++ply) {
+        if (board.isCheckmate(board.getCurrentPlayer())) return ply;
+        Move move;
+        if (!tablebase.probeRoot(board, &move)) return -1;
+        board.makeMove(move);
+    }
+    return -1;
+}
+
+int runTablebaseCheck(QTextStream& out, const QString& path) {
+    Tablebase tablebase;
+    tablebase.setPath(path);
+    if (tablebase.maxPieces() < 3) {
+        QTextStream(stderr) << "No Syzygy tables found in " << path << "\n";
+        return 2;
+    }
+
+    int failures = 0;
+    for (const TablebaseCase& test : TABLEBASE_CASES) {
+        QElapsedTimer timer;
+        timer.start();
+        QVector<bool> legal;
+        const QVector<int> dtm = solveTablebaseCase(test.piece, legal);
+
+        int positions = 0;
+        int wdlErrors = 0;
+        int dtzErrors = 0;
+        int probeErrors = 0;
+        int playouts = 0;
+        int playoutErrors = 0;
+        int maxDtm = 0;
+        ChessBoard board;
+        for (int index = 0; index < TB_POSITIONS; ++index) {
+            if (!legal[index]) continue;
+            const int pieceSquare = index % TB_SQUARES;
+            const int blackKing = index / TB_SQUARES % TB_SQUARES;
+            const int whiteKing = index / (TB_SQUARES * TB_SQUARES) % TB_SQUARES;
+            const int blackToMove = index / (TB_SQUARES * TB_SQUARES * TB_SQUARES);
+
+            // 白方行棋時解出的是勝，黑方行棋時是負；DTZ 的大小即 DTM（被將死的局面為 1）
+            const WdlScore expectedWdl = dtm[index] == TB_UNKNOWN ? WdlScore::Draw
+                                       : blackToMove ? WdlScore::Loss : WdlScore::Win;
+            const int expectedDtz = dtm[index] == TB_UNKNOWN ? 0 : qMax(1, dtm[index]);
+            maxDtm = qMax(maxDtm, dtm[index]);
+
+            for (bool mirrored : { false, true }) {
+                const QString fen = tablebaseFen(test.piece, blackToMove, whiteKing, blackKing, pieceSquare, mirrored);
+                board.setFromFEN(fen);
+                ++positions;
+                WdlScore wdl = WdlScore::Draw;
+                int dtz = 0;
+                if (!tablebase.probeWdl(board, &wdl) || !tablebase.probeDtz(board, &dtz)) {
+                    if (++probeErrors <= 5) out << "  probe failed: " << fen << "\n";
+                    continue;
+                }
+                if (wdl != expectedWdl) {
+                    if (++wdlErrors <= 5) {
+                        out << "  wdl " << static_cast<int>(wdl) << " (expected " << static_cast<int>(expectedWdl)
+                            << "): " << fen << "\n";
+                    }
+                }
+                // Syzygy 以「步」儲存 DTZ 的表可能多算一個半步
+                const bool signOk = (dtz > 0) == (expectedWdl == WdlScore::Win) && (dtz < 0) == (expectedWdl == WdlScore::Loss);
+                if (!signOk || qAbs(dtz) < expectedDtz || qAbs(dtz) > expectedDtz + 1) {
+                    if (++dtzErrors <= 5) {
+                        out << "  dtz " << dtz << " (expected " << (blackToMove ? -expectedDtz : expectedDtz)
+                            << "): " << fen << "\n";
+                    }
+                }
+
+                // 抽樣的勝局以 probeRoot() 下完，必須在五十步內將死
+                if (expectedWdl == WdlScore::Win && index % 61 == 0) {
+                    ++playouts;
+                    const int plies = playOutTablebase(tablebase, board);
+                    if (plies < 0) {
+                        if (++playoutErrors <= 5) {
+                            out << "  playout " << plies << " plies (dtm " << dtm[index] << "): " << fen << "\n";
+                        }
+                    }
+                }
+            }
+        }
+
+        const bool passed = wdlErrors == 0 && dtzErrors == 0 && probeErrors == 0 && playoutErrors == 0;
+        if (!passed) ++failures;
+        out << (passed ? "ok   " : "FAIL ") << test.name
+            << " positions " << positions << " max dtm " << maxDtm
+            << " wdl errors " << wdlErrors << " dtz errors " << dtzErrors
+            << " probe errors " << probeErrors
+            << " playouts " << playouts << " failed " << playoutErrors
+            << " " << timer.elapsed() << " ms\n";
+        out.flush();
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("qt_chess_perft");
+    Bitboards::initSliderAttacks();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Perft move-generation test for the Qt_Chess rules core");
+    parser.addHelpOption();
+    QCommandLineOption fenOption("fen", "Position to search (default: initial position).", "fen", START_FEN);
+    QCommandLineOption depthOption({ "d", "depth" }, "Search depth (default: 5).", "depth", "5");
+    QCommandLineOption divideOption("divide", "Print node counts for each root move.");
+    QCommandLineOption suiteOption("suite", "Run the bundled perft suite; exit code 1 on any mismatch.");
+    QCommandLineOption verifyHashOption("verify-hash", "Check the incremental Zobrist key against a full recomputation at every node.");
+    QCommandLineOption searchBenchOption("search-bench", "Time the built-in search with 1, 2, 4... threads and print the speedup (default depth: 8).");
+    QCommandLineOption threadsOption("threads", "Maximum thread count for --search-bench (default: ideal thread count).", "threads");
+    QCommandLineOption tablebaseCheckOption("tablebase-check", "Check Syzygy WDL/DTZ probes for KQvK and KRvK against a retrograde solution; exit code 1 on any mismatch.", "directory");
+    parser.addOption(fenOption);
+    parser.addOption(depthOption);
+    parser.addOption(divideOption);
+    parser.addOption(suiteOption);
+    parser.addOption(verifyHashOption);
+    parser.addOption(searchBenchOption);
+    parser.addOption(threadsOption);
+    parser.addOption(tablebaseCheckOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    if (parser.isSet(suiteOption)) {
+        return runSuite(out, parser.isSet(verifyHashOption));
+    }
+    if (parser.isSet(tablebaseCheckOption)) {
+        return runTablebaseCheck(out, parser.value(tablebaseCheckOption));
+    }
+
+    bool depthOk = false;
+    int depth = parser.value(depthOption).toInt(&depthOk);
+    if (!depthOk || depth < 1) {
+        QTextStream(stderr) << "Invalid depth: " << parser.value(depthOption) << "\n";
+        return 2;
+    }
+
+    if (parser.isSet(searchBenchOption)) {
+        int maxThreads = qMax(1, QThread::idealThreadCount());
+        if (parser.isSet(threadsOption)) {
+            bool threadsOk = false;
+            maxThreads = parser.value(threadsOption).toInt(&threadsOk);
+            if (!threadsOk || maxThreads < 1) {
+                QTextStream(stderr) << "Invalid thread count: " << parser.value(threadsOption) << "\n";
+                return 2;
+            }
+        }
+        return runSearchBench(out, parser.isSet(depthOption) ? depth : 8, maxThreads);
+    }
+
+    ChessBoard board;
+    if (!board.setFromFEN(parser.value(fenOption))) {
+        QTextStream(stderr) << "Invalid FEN: " << parser.value(fenOption) << "\n";
+        return 2;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    quint64 hashErrors = 0;
+    quint64 nodes;
+    if (parser.isSet(verifyHashOption)) {
+        nodes = perftVerifyHash(board, depth, hashErrors);
+    } else if (parser.isSet(divideOption)) {
+        nodes = divide(board, depth, out);
+    } else {
+        nodes = perft(board, depth);
+    }
+    qint64 elapsedNs = timer.nsecsElapsed();
+
+    out << "Nodes: " << nodes << "\n"
+        << "Time: " << elapsedNs / 1000000 << " ms\n"
+        << "NPS: " << nodesPerSecond(nodes, elapsedNs) << "\n";
+    if (parser.isSet(verifyHashOption)) {
+        out << "Hash mismatches: " << hashErrors << "\n";
+        return hashErrors == 0 ? 0 : 1;
+    }
+    return 0;
+}
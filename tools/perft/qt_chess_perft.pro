@@ -0,0 +1,35 @@
+# 無介面的 perft 工具：只依賴 QtCore，用來驗證與量測規則核心（ChessPiece / ChessBoard）的走法產生，
+# 以及內建搜尋（SearchEngine）的多執行緒加速比與 Syzygy 殘局庫（Tablebase）的查詢結果
+QT       = core
+CONFIG  += c++17 console
+CONFIG  -= app_bundle
+
+TARGET = qt_chess_perft
+
+INCLUDEPATH += $$PWD/../../src
+
+# 與主程式相同：CONFIG+=pext 時使用 PEXT 查詢滑動棋子攻擊
+pext {
+    DEFINES += QT_CHESS_USE_PEXT
+    gcc|clang: QMAKE_CXXFLAGS += -mbmi2
+    msvc: QMAKE_CXXFLAGS += /arch:AVX2
+}
+
+SOURCES += \
+    main.cpp \
+    $$PWD/../../src/bitboard.cpp \
+    $$PWD/../../src/chesspiece.cpp \
+    $$PWD/../../src/chessboard.cpp \
+    $$PWD/../../src/transpositiontable.cpp \
+    $$PWD/../../src/searchengine.cpp \
+    $$PWD/../../src/tablebase.cpp
+
+HEADERS += \
+    $$PWD/../../src/bitboard.h \
+    $$PWD/../../src/chesspiece.h \
+    $$PWD/../../src/chessmove.h \
+    $$PWD/../../src/zobrist.h \
+    $$PWD/../../src/chessboard.h \
+    $$PWD/../../src/transpositiontable.h \
+    $$PWD/../../src/searchengine.h \
+    $$PWD/../../src/tablebase.h